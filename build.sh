@@ -6,20 +6,51 @@ command -v g++ > /dev/null 2>&1 || { echo >&2 "The command g++ (c++ compiler) co
 
 OUT_DIR=out
 
-COMPILER_ARGS="$(root-config --cflags --libs) -Wall -Wextra -std=c++17"
+COMPILER_ARGS="$(root-config --cflags --libs) -Wall -Wextra -std=c++17 -pthread -O2 -march=native"
 
 SRC_FILES="\
 	src/particle_type.cpp \
 	src/resonance_type.cpp \
 	src/util.cpp \
-	src/particle.cpp"
+	src/particle_table.cpp \
+	src/alias_table.cpp \
+	src/particle.cpp \
+	src/particle_batch.cpp \
+	src/fast_math.cpp \
+	src/kinematics.cpp \
+	src/decay_batch.cpp \
+	src/decay_arena.cpp \
+	src/pair_categories.cpp \
+	src/pair_config.cpp \
+	src/histo_accumulator.cpp \
+	src/simulation_histos.cpp \
+	src/pair_filler.cpp \
+	src/event_mixing.cpp \
+	src/particle_catalogue.cpp \
+	src/event_simulation.cpp \
+	src/instrumentation.cpp \
+	src/event_store.cpp \
+	src/event_replay.cpp \
+	src/least_squares.cpp \
+	src/histo_store.cpp \
+	src/checkpoint.cpp \
+	src/histo_comparison.cpp \
+	src/reference_simulation.cpp"
 SIMULATION=src/simulation.cpp
 ANALYSIS=src/analysis.cpp
 TEST=src/test.cpp
+BENCH=src/bench.cpp
+REPLAY=src/replay.cpp
+MERGE=src/merge.cpp
+VALIDATE=src/validate.cpp
 
 TEST_BIN=$OUT_DIR/test
 SIMULATION_BIN=$OUT_DIR/simulation
 ANALYSIS_BIN=$OUT_DIR/analysis
+BENCH_BIN=$OUT_DIR/bench
+REPLAY_BIN=$OUT_DIR/replay
+MERGE_BIN=$OUT_DIR/merge
+VALIDATE_BIN=$OUT_DIR/validate
 
 build_simulation() {
 	g++ -o $SIMULATION_BIN $SRC_FILES $SIMULATION $COMPILER_ARGS
@@ -33,28 +64,68 @@ build_test() {
 	g++ -o $TEST_BIN $SRC_FILES $TEST $COMPILER_ARGS
 }
 
+build_bench() {
+	g++ -o $BENCH_BIN $SRC_FILES $BENCH $COMPILER_ARGS
+}
+
+build_replay() {
+	g++ -o $REPLAY_BIN $SRC_FILES $REPLAY $COMPILER_ARGS
+}
+
+build_merge() {
+	g++ -o $MERGE_BIN $SRC_FILES $MERGE $COMPILER_ARGS
+}
+
+build_validate() {
+	g++ -o $VALIDATE_BIN $SRC_FILES $VALIDATE $COMPILER_ARGS
+}
+
 simulation() {
-	$(build_simulation) && ./${SIMULATION_BIN}
+	$(build_simulation) && ./${SIMULATION_BIN} "$@"
 }
 
 analysis() {
-	$(build_analysis) && ./${ANALYSIS_BIN}
+	$(build_analysis) && ./${ANALYSIS_BIN} "$@"
 }
 
 test() {
 	$(build_test) && ./${TEST_BIN}
 }
 
+bench() {
+	$(build_bench) && ./${BENCH_BIN} "$@"
+}
+
+replay() {
+	$(build_replay) && ./${REPLAY_BIN} "$@"
+}
+
+merge() {
+	$(build_merge) && ./${MERGE_BIN} "$@"
+}
+
+validate() {
+	$(build_validate) && ./${VALIDATE_BIN} "$@"
+}
+
 print_help() {
-	echo 'Synthax: ./build.sh [analysis|simulation|test|build_analysis|build_simulation|build_test]'
+	echo 'Synthax: ./build.sh [analysis|simulation|test|bench|replay|merge|validate|build_analysis|build_simulation|build_test|build_bench|build_replay|build_merge|build_validate]'
 	echo ''
 	echo '*no argumets* - Build and run simulation and analysis'
-	echo 'analysis - Build and run analysis'
+	echo 'analysis [--fast-fits] [--threads N] [--bootstrap B] [--plots LIST] [--plot-workers N] - Build and run analysis'
 	echo 'build_analysis - Build analysis'
-	echo 'simulation - Build and run simulation'
+	echo 'simulation [--threads N] [--seed S] [--shard I/N] - Build and run simulation'
 	echo 'build_simulation - Build main program'
 	echo 'test - Build and run tests'
 	echo 'build_test - Build tests'
+	echo 'bench [--reps R] [--json PATH] [--csv PATH] - Build and run benchmarks'
+	echo 'build_bench - Build benchmarks'
+	echo 'replay PATH [--output FILE] [--mix-depth K] - Build and refill the histograms from an event file'
+	echo 'build_replay - Build replay'
+	echo 'merge [--threads N] [--output FILE] FILE... - Build and add up the histograms of shards'
+	echo 'build_merge - Build merge'
+	echo 'validate [--n-events N] [--seed S] [--threads N] [--alpha A] [--pair-precision P] - Build and check the engine against the reference simulation'
+	echo 'build_validate - Build validate'
 }
 
 # Make sure out directory exists
@@ -66,17 +137,33 @@ fi
 if [ $# -eq 0 ]; then
 	simulation && analysis
 elif [ "$1" == "analysis" ] || [ $# -eq 0 ]; then
-	analysis
+	analysis "${@:2}"
 elif [ "$1" == "build_analysis" ]; then
 	build_analysis
 elif [ "$1" == "simulation" ]; then
-	simulation
+	simulation "${@:2}"
 elif [ "$1" == "build_simulation" ]; then
 	build_simulation
 elif [ "$1" == "test" ]; then
 	test
 elif [ "$1" == "build_test" ]; then
 	build_test
+elif [ "$1" == "bench" ]; then
+	bench "${@:2}"
+elif [ "$1" == "build_bench" ]; then
+	build_bench
+elif [ "$1" == "replay" ]; then
+	replay "${@:2}"
+elif [ "$1" == "build_replay" ]; then
+	build_replay
+elif [ "$1" == "merge" ]; then
+	merge "${@:2}"
+elif [ "$1" == "build_merge" ]; then
+	build_merge
+elif [ "$1" == "validate" ]; then
+	validate "${@:2}"
+elif [ "$1" == "build_validate" ]; then
+	build_validate
 else
 	print_help
 fi
\ No newline at end of file
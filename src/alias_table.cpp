@@ -0,0 +1,56 @@
+#include "alias_table.hpp"
+
+#include <stdexcept>
+
+AliasTable::AliasTable(std::vector<double> const& weights)
+    : fColumns(weights.size()) {
+  const int n = weights.size();
+  double total = 0.;
+  for (double weight : weights) {
+    if (!(weight >= 0.)) {
+      throw std::invalid_argument("alias table weights must be non negative");
+    }
+    total += weight;
+  }
+  if (n == 0 || !(total > 0.)) {
+    throw std::invalid_argument("alias table weights must have positive sum");
+  }
+  // scaled so that the average column holds exactly 1
+  std::vector<double> scaled(n);
+  std::vector<int> small, large;
+  for (int i = 0; i < n; i++) {
+    scaled[i] = weights[i] * n / total;
+    (scaled[i] < 1. ? small : large).push_back(i);
+  }
+  // every small column is topped up by a large one, which then may become
+  // small itself
+  while (!small.empty() && !large.empty()) {
+    const int s = small.back();
+    const int l = large.back();
+    small.pop_back();
+    fColumns[s] = {scaled[s], l};
+    scaled[l] -= 1. - scaled[s];
+    if (scaled[l] < 1.) {
+      large.pop_back();
+      small.push_back(l);
+    }
+  }
+  // what is left is 1 up to rounding errors
+  for (int i : large) fColumns[i] = {1., i};
+  for (int i : small) fColumns[i] = {1., i};
+}
+
+int AliasTable::Size() const {
+  return fColumns.size();
+}
+
+double AliasTable::Probability(int i) const {
+  const int n = fColumns.size();
+  double probability = fColumns[i].fKeep;
+  for (int c = 0; c < n; c++) {
+    if (c != i && fColumns[c].fAlias == i) {
+      probability += 1. - fColumns[c].fKeep;
+    }
+  }
+  return probability / n;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "rng.hpp"
+
+// Walker alias table (Vose, "A linear algorithm for generating random
+// numbers with a given distribution"): samples outcome i with probability
+// proportional to weights[i] using one uniform draw and one comparison,
+// whatever the number of outcomes.
+class AliasTable {
+ private:
+  // probability of keeping column i, and the outcome taken otherwise; kept
+  // together so that a draw reads a single entry
+  struct Column {
+    double fKeep;
+    int fAlias;
+  };
+  std::vector<Column> fColumns;
+
+ public:
+  AliasTable() = default;
+  // weights must be non negative with a positive sum, throws
+  // std::invalid_argument otherwise
+  explicit AliasTable(std::vector<double> const& weights);
+  int Size() const;
+  // probability of outcome i implied by the table
+  double Probability(int i) const;
+
+  int Sample(Rng& rng) const {
+    const int n = fColumns.size();
+    // the integer part picks the column, the fraction is the second draw
+    const double u = rng.Rndm() * n;
+    const int i = std::min(static_cast<int>(u), n - 1);
+    return u - i < fColumns[i].fKeep ? i : fColumns[i].fAlias;
+  }
+};
@@ -4,207 +4,551 @@
 #include <TFitResult.h>
 #include <TFitResultPtr.h>
 #include <TH1D.h>
+#include <TMath.h>
+#include <TROOT.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <filesystem>
 #include <iostream>
 #include <memory>
+#include <new>
+#include <sstream>
 #include <stdexcept>
 #include <string>
-#include <unordered_map>
+#include <thread>
+#include <vector>
 
 #include "constants.hpp"
+#include "histo_store.hpp"
+#include "least_squares.hpp"
+#include "parallel_for.hpp"
+#include "particle_catalogue.hpp"
+#include "rng.hpp"
 #include "table.hpp"
 #include "util.hpp"
 
-std::unordered_map<const char*, TH1D*> histos{
-    {"particle-types", nullptr},
-    {"zenith", nullptr},
-    {"azimuth", nullptr},
-    {"pulse", nullptr},
-    {"traverse-pulse", nullptr},
-    {"particle-energy", nullptr},
-    {"inv-mass", nullptr},
-    {"inv-mass-discordant", nullptr},
-    {"inv-mass-concordant", nullptr},
-    {"inv-mass-discordant-pk", nullptr},
-    {"inv-mass-concordant-pk", nullptr},
-    {"inv-mass-siblings", nullptr}};
-
-TF1 fit(TH1D* dist, const char* fitFunc, double xMin, double xMax);
-void loadHistos(TFile& file);
-void checkHistosEntries();
-void checkParticleTypesDistribution();
-void extractKStar();
-void saveToPdf();
-
-enum ParticleIndex : int {
-  INVALID_PARTICLE,
-  PIONE_P,
-  PIONE_N,
-  KAONE_P,
-  KAONE_N,
-  PROTONE_P,
-  PROTONE_N,
-  K_STAR
+// the mixed-event background is normalized to the same-event pairs outside
+// of this window around the k* peak, the peak is fitted inside it
+const double PEAK_WINDOW_MIN = 0.6;
+const double PEAK_WINDOW_MAX = 1.2;
+
+struct AnalysisOptions {
+  int nThreads = 1;
+  bool fastFits = false;
+  int nBootstrap = 0;
+  uint64_t seed = 0;
+  std::string plots = "all";
+  int nPlotWorkers = 1;
+};
+
+// Fit of a histogram in [xMin, xMax], independent of the others
+struct FitJob {
+  const char* title;
+  TH1D* dist;
+  FitModel model;
+  double xMin, xMax;
+  FitResult result;
 };
 
-int main() {
+// bin centers, contents and errors of the bins of dist in [xMin, xMax]
+struct BinnedData {
+  std::vector<double> x, y, e;
+};
+
+bool parseArgs(int argc, char** argv, AnalysisOptions& options);
+FitResult fit(TH1D* dist, FitModel model, double xMin, double xMax);
+FitResult fastFit(TH1D* dist, FitModel model, double xMin, double xMax);
+void printFit(FitModel model, FitResult const& result);
+BinnedData binnedData(TH1D* dist, double xMin, double xMax);
+std::vector<std::string> selectPlots(std::string const& selection,
+                                     HistoStore const& histos);
+void checkHistosEntries(HistoStore& histos);
+void checkParticleTypesDistribution(HistoStore& histos);
+void extractKStar(FitResult const& discConc, FitResult const& pkDiscConc,
+                  AnalysisOptions const& options, HistoStore& histos);
+TH1D* subtractMixed(TH1D* same, TH1D* mixed, const char* name);
+void extractKStarMixed(FitResult const& disc, FitResult const& pkDisc);
+void savePlots(std::vector<std::string> const& plots, int nWorkers);
+bool drawPlots(std::vector<std::string> const& plots, std::atomic<int>& next);
+
+int main(int argc, char** argv) {
+  AnalysisOptions options;
+  if (!parseArgs(argc, argv, options)) {
+    std::cout << "Usage: analysis [--fast-fits] [--threads N] "
+                 "[--bootstrap B] [--seed S]\n"
+                 "                [--plots LIST] [--plot-workers N]\n";
+    std::cout << "  --fast-fits    use the built-in least squares fits instead "
+                 "of ROOT\n";
+    std::cout << "  --threads N    threads running the fits (default 1)\n";
+    std::cout << "  --bootstrap B  K* uncertainties from B bootstrap "
+                 "replicas\n";
+    std::cout << "  --seed S       seed of the bootstrap replicas (default "
+                 "0)\n";
+    std::cout << "  --plots LIST   comma separated histograms to save as PDF, "
+                 "all or none\n"
+                 "                 (default all)\n";
+    std::cout << "  --plot-workers N  processes drawing the plots, 0 to use "
+                 "all cores (default 1)\n";
+    return EXIT_FAILURE;
+  }
+  if (options.nPlotWorkers == 0) {
+    options.nPlotWorkers = std::max(1u, std::thread::hardware_concurrency());
+  }
+  // plots are only saved to files, never shown
+  gROOT->SetBatch(kTRUE);
   TFile file(SAVE_FILE);
+  section("Loading histograms");
+  std::unique_ptr<HistoStore> store;
+  std::vector<std::string> plots;
+  try {
+    store = std::make_unique<HistoStore>(file);
+    plots = selectPlots(options.plots, *store);
+  } catch (std::runtime_error const& error) {
+    std::cout << error.what() << "\n";
+    return EXIT_FAILURE;
+  }
+  HistoStore& histos = *store;
+  std::cout << "Found " << histos.Names().size() << " histograms in "
+            << SAVE_FILE << ", read when first used\n";
   TCanvas canvas("canvas", "", 400, 400);
-  loadHistos(file);
-  checkHistosEntries();
-  checkParticleTypesDistribution();
-  section("Zenith fit");
-  fit(histos["zenith"], "pol0", 0, M_PI);
-  section("Azimuth fit");
-  fit(histos["azimuth"], "pol0", 0, M_PI * 2);
-  section("Pulse fit");
-  fit(histos["pulse"], "expo", 0, 7);
-  extractKStar();
-  saveToPdf();
-  file.Close();
-}
+  checkHistosEntries(histos);
+  checkParticleTypesDistribution(histos);
 
-void loadHistos(TFile& file) {
-  section("Loading histograms");
-  if (!file.IsOpen()) {
-    throw std::runtime_error("Unable to open histograms file");
+  // the k* peak is found in the difference of discordant and concordant
+  // charge pairs
+  TH1D* diffDiscConc = (TH1D*)histos.Get("inv-mass-discordant")
+                           ->Clone("diff-inv-mass-discordant-concordant");
+  diffDiscConc->Add(histos.Get("inv-mass-concordant"), -1);
+  TH1D* diffPKDiscConc = (TH1D*)histos.Get("inv-mass-discordant-pk")
+                             ->Clone("diff-inv-mass-pk-discordant-concordant");
+  diffPKDiscConc->Add(histos.Get("inv-mass-concordant-pk"), -1);
+
+  std::vector<FitJob> jobs{
+      {"Zenith fit", histos.Get("zenith"), FitModel::POL0, 0, M_PI, {}},
+      {"Azimuth fit", histos.Get("azimuth"), FitModel::POL0, 0, M_PI * 2, {}},
+      {"Pulse fit", histos.Get("pulse"), FitModel::EXPO, 0, 7, {}},
+      {"Fit difference inv. mass discordant concordant", diffDiscConc,
+       FitModel::GAUS, 0, 10, {}},
+      {"Fit difference inv. mass discordant concordant pione-kaone pairs",
+       diffPKDiscConc, FitModel::GAUS, 0, 10, {}}};
+  // with event mixing the peak is also found over the mixed-event background,
+  // which has no k* daughters and far less fluctuations than the concordant
+  // pairs
+  // files written before event mixing have no mixed-event histograms
+  TH1D* mixed = histos.Find("inv-mass-mixed-discordant");
+  TH1D* pkMixed = histos.Find("inv-mass-mixed-discordant-pk");
+  const bool hasMixing = mixed && pkMixed && mixed->GetEntries() > 0 &&
+                         pkMixed->GetEntries() > 0;
+  if (hasMixing) {
+    jobs.push_back(
+        {"Fit inv. mass discordant minus mixed-event background",
+         subtractMixed(histos.Get("inv-mass-discordant"), mixed,
+                       "diff-inv-mass-discordant-mixed"),
+         FitModel::GAUS, PEAK_WINDOW_MIN, PEAK_WINDOW_MAX, {}});
+    jobs.push_back(
+        {"Fit inv. mass discordant minus mixed-event background pione-kaone "
+         "pairs",
+         subtractMixed(histos.Get("inv-mass-discordant-pk"), pkMixed,
+                       "diff-inv-mass-pk-discordant-mixed"),
+         FitModel::GAUS, PEAK_WINDOW_MIN, PEAK_WINDOW_MAX, {}});
   }
-  for (auto& histo : histos) {
-    std::cout << "Loading " << histo.first << "\n";
-    histo.second = (TH1D*)file.Get(histo.first);
+  if (options.fastFits) {
+    parallelFor(jobs.size(), options.nThreads, [&](int i) {
+      jobs[i].result =
+          fastFit(jobs[i].dist, jobs[i].model, jobs[i].xMin, jobs[i].xMax);
+    });
+  } else {
+    // ROOT fits share global state, they run one at a time
+    for (auto& job : jobs) {
+      job.result = fit(job.dist, job.model, job.xMin, job.xMax);
+    }
   }
+  for (auto const& job : jobs) {
+    section(job.title);
+    printFit(job.model, job.result);
+  }
+
+  extractKStar(jobs[3].result, jobs[4].result, options, histos);
+  if (hasMixing) extractKStarMixed(jobs[5].result, jobs[6].result);
+  savePlots(plots, options.nPlotWorkers);
+  file.Close();
 }
 
-void checkHistosEntries() {
-  const int expectedParticlesTotal = N_EVENTS * N_PARTICLES;
+bool parseArgs(int argc, char** argv, AnalysisOptions& options) {
+  try {
+    for (int i = 1; i < argc; i++) {
+      if (std::strcmp(argv[i], "--fast-fits") == 0) {
+        options.fastFits = true;
+      } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+        options.nThreads = std::stoi(argv[++i]);
+        if (options.nThreads < 1) return false;
+      } else if (std::strcmp(argv[i], "--bootstrap") == 0 && i + 1 < argc) {
+        options.nBootstrap = std::stoi(argv[++i]);
+        if (options.nBootstrap < 0) return false;
+      } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+        options.seed = std::stoull(argv[++i]);
+      } else if (std::strcmp(argv[i], "--plots") == 0 && i + 1 < argc) {
+        options.plots = argv[++i];
+      } else if (std::strcmp(argv[i], "--plot-workers") == 0 &&
+                 i + 1 < argc) {
+        options.nPlotWorkers = std::stoi(argv[++i]);
+        if (options.nPlotWorkers < 0) return false;
+      } else {
+        return false;
+      }
+    }
+  } catch (std::exception const&) {
+    return false;
+  }
+  return true;
+}
 
-  double invMassEntries = 0.0;
-  for (int i = 0; i <= N_PARTICLES; i++) {
-    invMassEntries += N_PARTICLES - i;
+std::vector<std::string> selectPlots(std::string const& selection,
+                                     HistoStore const& histos) {
+  if (selection == "all") return histos.Names();
+  std::vector<std::string> plots;
+  if (selection == "none") return plots;
+  std::istringstream names(selection);
+  std::string name;
+  while (std::getline(names, name, ',')) {
+    if (!histos.Has(name)) {
+      throw std::runtime_error(concat("No histogram named ", name, " in ",
+                                      SAVE_FILE, " to plot"));
+    }
+    plots.push_back(name);
   }
-  invMassEntries *= N_EVENTS;
+  return plots;
+}
 
-  const int expectedKP =
-      (N_PARTICLES * N_PARTICLES / 2) * (0.8 + 0.01) * (0.1 + 0.01) * N_EVENTS;
+void checkHistosEntries(HistoStore& histos) {
+  // the run size comes from the file: the events histogram holds the events
+  // and the sum of the multiplicity they were generated with
+  double nEvents = N_EVENTS;
+  double nParticles = N_PARTICLES;
+  TH1D* events = histos.Find("events");
+  if (events && events->GetNbinsX() == 2) {
+    nEvents = events->GetBinContent(1);
+    nParticles = nEvents > 0 ? events->GetBinContent(2) / nEvents : 0.;
+  } else {
+    std::cout << "No events histogram, expecting " << N_EVENTS
+              << " events of " << N_PARTICLES << " particles\n";
+  }
+  const double expectedParticlesTotal = nEvents * nParticles;
+  const double invMassEntries = nEvents * nParticles * (nParticles + 1) / 2;
+  const double expectedKP =
+      (nParticles * nParticles / 2) * (0.8 + 0.01) * (0.1 + 0.01) * nEvents;
 
   section("Histograms entries");
-  Table<const char*, int, int>()
-      .headers({"HISTOGRAM", "EXPECTED", "ACTUAL"})
-      .row("particle-types",        //
-           expectedParticlesTotal,  //
-           histos["particle-types"]->GetEntries())
-      .row("zenith",                //
-           expectedParticlesTotal,  //
-           histos["zenith"]->GetEntries())
-      .row("azimuth",               //
-           expectedParticlesTotal,  //
-           histos["azimuth"]->GetEntries())
-      .row("pulse",                 //
-           expectedParticlesTotal,  //
-           histos["pulse"]->GetEntries())
-      .row("traverse-pulse",        //
-           expectedParticlesTotal,  //
-           histos["traverse-pulse"]->GetEntries())
-      .row("particle-energy",       //
-           expectedParticlesTotal,  //
-           histos["particle-energy"]->GetEntries())
-      .row("invariant-mass",  //
-           invMassEntries,    //
-           histos["inv-mass"]->GetEntries())
-      .row("invariant-mass-discordant-charge",  //
-           invMassEntries / 2,                  //
-           histos["inv-mass-discordant"]->GetEntries())
-      .row("invariant-mass-concordant-charge",  //
-           invMassEntries / 2,                  //
-           histos["inv-mass-concordant"]->GetEntries())
-      .row("invariant-mass-pione-kaone-discordant-charge",  //
-           expectedKP,                                      //
-           histos["inv-mass-discordant-pk"]->GetEntries())
-      .row("invariant-mass-pione-kaone-concordant-charge",  //
-           expectedKP,                                      //
-           histos["inv-mass-concordant-pk"]->GetEntries())
-      .row("invariant-mass-decay-siblings",  //
-           expectedParticlesTotal * 0.01,    //
-           histos["inv-mass-siblings"]->GetEntries())
-      .spacing(7)
-      .print();
+  // the pair histograms of a run that sampled pairs are weighted: their sum
+  // of weights estimates the pairs, and their effective entries are the
+  // statistics they actually hold
+  // pair counts of large runs do not fit in an int
+  auto table = Table<const char*, long long, long long, long long>();
+  table.headers({"HISTOGRAM", "EXPECTED", "ACTUAL", "EFFECTIVE"});
+  auto row = [&](const char* label, const char* name, double expected) {
+    TH1D* histo = histos.Get(name);
+    table.row(label, std::llround(expected),
+              std::llround(histo->Integral(0, histo->GetNbinsX() + 1)),
+              std::llround(histo->GetEffectiveEntries()));
+  };
+  row("particle-types", "particle-types", expectedParticlesTotal);
+  row("zenith", "zenith", expectedParticlesTotal);
+  row("azimuth", "azimuth", expectedParticlesTotal);
+  row("pulse", "pulse", expectedParticlesTotal);
+  row("traverse-pulse", "traverse-pulse", expectedParticlesTotal);
+  row("particle-energy", "particle-energy", expectedParticlesTotal);
+  row("invariant-mass", "inv-mass", invMassEntries);
+  row("invariant-mass-discordant-charge", "inv-mass-discordant",
+      invMassEntries / 2);
+  row("invariant-mass-concordant-charge", "inv-mass-concordant",
+      invMassEntries / 2);
+  row("invariant-mass-pione-kaone-discordant-charge",
+      "inv-mass-discordant-pk", expectedKP);
+  row("invariant-mass-pione-kaone-concordant-charge",
+      "inv-mass-concordant-pk", expectedKP);
+  row("invariant-mass-decay-siblings", "inv-mass-siblings",
+      expectedParticlesTotal * 0.01);
+  table.spacing(7).print();
 }
 
-void checkParticleTypesDistribution() {
+void checkParticleTypesDistribution(HistoStore& histos) {
   section("Particle types distributions");
   const auto computeBinPercentage = [](int binIndex, TH1D* dist) {
     return dist->GetBinContent(binIndex) / dist->GetEntries() * 100;
   };
-  auto histo = histos["particle-types"];
-  Table<const char*, double, double>()
-      .headers({"PARTICLE", "EXPECTED (%)", "ACTUAL (%)"})
-      .row("PIONE+", 40, computeBinPercentage(PIONE_P, histo))
-      .row("PIONE-", 40, computeBinPercentage(PIONE_N, histo))
-      .row("KAONE+", 5, computeBinPercentage(KAONE_P, histo))
-      .row("KAONE-", 5, computeBinPercentage(KAONE_N, histo))
-      .row("PROTONE+", 4.5, computeBinPercentage(PROTONE_P, histo))
-      .row("PROTONE-", 4.5, computeBinPercentage(PROTONE_N, histo))
-      .row("K*", 1, computeBinPercentage(K_STAR, histo))
-      .spacing(7)
-      .print();
+  // one bin per particle type, named after it: the expected fraction of
+  // every type comes from the abundances of the species catalogue
+  auto histo = histos.Get("particle-types");
+  auto table = Table<const char*, double, double>();
+  table.headers({"PARTICLE", "EXPECTED (%)", "ACTUAL (%)"});
+  for (int bin = 1; bin <= histo->GetNbinsX(); bin++) {
+    const char* name = histo->GetXaxis()->GetBinLabel(bin);
+    table.row(name, speciesFraction(name) * 100,
+              computeBinPercentage(bin, histo));
+  }
+  table.spacing(7).print();
 }
 
-TF1 fit(TH1D* dist, const char* fitFormula, double xMin, double xMax) {
+FitResult fit(TH1D* dist, FitModel model, double xMin, double xMax) {
   auto fitFuncName = concat(dist->GetName(), "-fit");
-  TF1 fitFunc(fitFuncName.c_str(), fitFormula, xMin, xMax);
-  dist->Fit(fitFuncName.c_str(), "Q");
-  std::cout << "Function\t\t" << fitFormula << "\n";
+  TF1 fitFunc(fitFuncName.c_str(), formulaName(model), xMin, xMax);
+  // a non zero status means minuit did not converge
+  const int status = dist->Fit(fitFuncName.c_str(), "Q");
+  FitResult result{{}, {}, fitFunc.GetChisquare(), fitFunc.GetNDF(),
+                   status == 0};
+  for (int i = 0; i < nParameters(model); i++) {
+    result.fParameters.push_back(fitFunc.GetParameter(i));
+    result.fErrors.push_back(fitFunc.GetParError(i));
+  }
+  return result;
+}
+
+FitResult fastFit(TH1D* dist, FitModel model, double xMin, double xMax) {
+  const BinnedData data = binnedData(dist, xMin, xMax);
+  return fitLeastSquares(model, data.x.size(), data.x.data(), data.y.data(),
+                         data.e.data());
+}
+
+void printFit(FitModel model, FitResult const& result) {
+  std::cout << "Function\t\t" << formulaName(model) << "\n";
   std::cout << "Parameters:\n";
-  for (int i = 0; i < fitFunc.GetNpar(); i++) {
-    std::cout << "\t" << fitFunc.GetParName(i) << ": "
-              << fitFunc.GetParameter(i) << "\n";
-  }
-  std::cout << "Reduced chi squared\t"
-            << (fitFunc.GetChisquare() / fitFunc.GetNDF()) << "\n";
-  std::cout << "Fit probability\t\t" << fitFunc.GetProb() << "\n";
-  return fitFunc;
+  for (int i = 0; i < nParameters(model); i++) {
+    std::cout << "\t" << parameterName(model, i) << ": "
+              << result.fParameters[i] << "\n";
+  }
+  std::cout << "Reduced chi squared\t" << (result.fChi2 / result.fNdf)
+            << "\n";
+  std::cout << "Fit probability\t\t" << TMath::Prob(result.fChi2, result.fNdf)
+            << "\n";
+  if (!result.fValid) {
+    std::cout << "Fit did not converge\n";
+  }
+}
+
+BinnedData binnedData(TH1D* dist, double xMin, double xMax) {
+  BinnedData data;
+  const int first = std::max(1, dist->GetXaxis()->FindBin(xMin));
+  const int last = std::min(dist->GetNbinsX(), dist->GetXaxis()->FindBin(xMax));
+  for (int bin = first; bin <= last; bin++) {
+    data.x.push_back(dist->GetBinCenter(bin));
+    data.y.push_back(dist->GetBinContent(bin));
+    data.e.push_back(dist->GetBinError(bin));
+  }
+  return data;
 }
 
-void extractKStar() {
+void extractKStar(FitResult const& discConc, FitResult const& pkDiscConc,
+                  AnalysisOptions const& options, HistoStore& histos) {
   section("Extract k*");
-  TH1D* diffDiscConc = (TH1D*)histos["inv-mass-discordant"]->Clone(
-      "diff-inv-mass-discordant-concordant");
-  diffDiscConc->Add(histos["inv-mass-concordant"], -1);
-  TH1D* diffPKDiscConc = (TH1D*)histos["inv-mass-discordant-pk"]->Clone(
-      "diff-inv-mass-pk-discordant-concordant");
-  diffPKDiscConc->Add(histos["inv-mass-concordant-pk"], -1);
-  std::cout << "\n-- Fit difference inv. mass discordant concordant\n";
-  TF1 fitDiscConc = fit(diffDiscConc, "gaus", 0, 10);
-  std::cout
-      << "\n-- Fit difference inv. mass discordant concordant pione-kaone "
-         "pairs\n";
-  TF1 fitPKDiscConc = fit(diffPKDiscConc, "gaus", 0, 10);
+  const int MEAN = 1, SIGMA = 2;
   auto avgMass =
-      (fitDiscConc.GetParameter("Mean") + fitPKDiscConc.GetParameter("Mean")) /
-      2.;
-  auto avgWidth = (fitDiscConc.GetParameter("Sigma") +
-                   fitPKDiscConc.GetParameter("Sigma")) /
-                  2.;
+      (discConc.fParameters[MEAN] + pkDiscConc.fParameters[MEAN]) / 2.;
+  auto avgWidth =
+      (discConc.fParameters[SIGMA] + pkDiscConc.fParameters[SIGMA]) / 2.;
   std::cout << "\n-- Average K* values\n";
-  Table<const char*, double, double>()
-      .headers({"", "EXPECTED", "FOUND"})
-      .row("Mass", 0.89166, avgMass)
-      .row("Width", 0.05, avgWidth)
+  if (options.nBootstrap == 0) {
+    Table<const char*, double, double>()
+        .headers({"", "EXPECTED", "FOUND"})
+        .row("Mass", 0.89166, avgMass)
+        .row("Width", 0.05, avgWidth)
+        .spacing(7)
+        .print();
+    return;
+  }
+
+  // every replica resamples the four pair histograms bin by bin with the
+  // variance of the bin (GetBinError squared) and fits both differences again
+  const double xMin = 0, xMax = 10;
+  const BinnedData disc =
+      binnedData(histos.Get("inv-mass-discordant"), xMin, xMax);
+  const BinnedData conc =
+      binnedData(histos.Get("inv-mass-concordant"), xMin, xMax);
+  const BinnedData pkDisc =
+      binnedData(histos.Get("inv-mass-discordant-pk"), xMin, xMax);
+  const BinnedData pkConc =
+      binnedData(histos.Get("inv-mass-concordant-pk"), xMin, xMax);
+  std::vector<double> masses(options.nBootstrap), widths(options.nBootstrap);
+  std::vector<char> valid(options.nBootstrap);
+  parallelFor(options.nBootstrap, options.nThreads, [&](int replica) {
+    // one stream per replica: results do not depend on the threads
+    Rng rng(options.seed, replica);
+    // a bin with content c and error e holds c^2 / e^2 effective entries of
+    // weight e^2 / c: scaling a Poisson draw of the entries keeps both the
+    // content and the variance, and gives plain Poisson on unweighted bins
+    auto resample = [&rng](double content, double error, double& variance) {
+      if (error == 0.) {
+        variance = 0.;
+        return content;
+      }
+      if (content <= 0.) {
+        variance = error * error;
+        return rng.Gaus(content, error);
+      }
+      const double weight = error * error / content;
+      const double value = weight * rng.Poisson(content / weight);
+      variance = weight * value;
+      return value;
+    };
+    auto resampledFit = [&resample](BinnedData const& a, BinnedData const& b) {
+      const int n = a.x.size();
+      std::vector<double> y(n), e(n);
+      for (int i = 0; i < n; i++) {
+        double varianceA, varianceB;
+        y[i] = resample(a.y[i], a.e[i], varianceA) -
+               resample(b.y[i], b.e[i], varianceB);
+        e[i] = std::sqrt(varianceA + varianceB);
+      }
+      return fitLeastSquares(FitModel::GAUS, n, a.x.data(), y.data(),
+                             e.data());
+    };
+    const FitResult first = resampledFit(disc, conc);
+    const FitResult second = resampledFit(pkDisc, pkConc);
+    valid[replica] = first.fValid && second.fValid;
+    masses[replica] = (first.fParameters[MEAN] + second.fParameters[MEAN]) / 2.;
+    widths[replica] =
+        (first.fParameters[SIGMA] + second.fParameters[SIGMA]) / 2.;
+  });
+
+  double massSum = 0., massSum2 = 0., widthSum = 0., widthSum2 = 0.;
+  int nValid = 0;
+  for (int r = 0; r < options.nBootstrap; r++) {
+    if (!valid[r]) continue;
+    nValid++;
+    massSum += masses[r];
+    massSum2 += masses[r] * masses[r];
+    widthSum += widths[r];
+    widthSum2 += widths[r] * widths[r];
+  }
+  const double massMean = nValid ? massSum / nValid : 0.;
+  const double widthMean = nValid ? widthSum / nValid : 0.;
+  const auto spread = [nValid](double sum2, double mean) {
+    return nValid > 1 ? std::sqrt(std::max(
+                            (sum2 - nValid * mean * mean) / (nValid - 1), 0.))
+                      : 0.;
+  };
+  Table<const char*, double, double, double, double>()
+      .headers({"", "EXPECTED", "FOUND", "BOOTSTRAP MEAN", "BOOTSTRAP STD"})
+      .row("Mass", 0.89166, avgMass, massMean, spread(massSum2, massMean))
+      .row("Width", 0.05, avgWidth, widthMean, spread(widthSum2, widthMean))
       .spacing(7)
       .print();
+  std::cout << nValid << " of " << options.nBootstrap
+            << " bootstrap replicas converged\n";
 }
 
-void saveToPdf() {
-  section("Saving histograms to PDF");
+TH1D* subtractMixed(TH1D* same, TH1D* mixed, const char* name) {
+  double sameSideband = 0., mixedSideband = 0.;
+  for (int bin = 1; bin <= same->GetNbinsX(); bin++) {
+    const double x = same->GetBinCenter(bin);
+    if (x >= PEAK_WINDOW_MIN && x <= PEAK_WINDOW_MAX) continue;
+    sameSideband += same->GetBinContent(bin);
+    mixedSideband += mixed->GetBinContent(bin);
+  }
+  TH1D* diff = (TH1D*)same->Clone(name);
+  if (mixedSideband > 0.) diff->Add(mixed, -sameSideband / mixedSideband);
+  return diff;
+}
+
+void extractKStarMixed(FitResult const& disc, FitResult const& pkDisc) {
+  section("Extract k* over the mixed-event background");
+  const int MEAN = 1, SIGMA = 2;
+  const auto average = [](double a, double b) { return (a + b) / 2.; };
+  const auto averageError = [](double a, double b) {
+    return std::sqrt(a * a + b * b) / 2.;
+  };
+  Table<const char*, double, double, double>()
+      .headers({"", "EXPECTED", "FOUND", "ERROR"})
+      .row("Mass", 0.89166,
+           average(disc.fParameters[MEAN], pkDisc.fParameters[MEAN]),
+           averageError(disc.fErrors[MEAN], pkDisc.fErrors[MEAN]))
+      .row("Width", 0.05,
+           average(disc.fParameters[SIGMA], pkDisc.fParameters[SIGMA]),
+           averageError(disc.fErrors[SIGMA], pkDisc.fErrors[SIGMA]))
+      .spacing(7)
+      .print();
+}
 
+// Saves every plot to histos/NAME.pdf. With more than one worker the plots
+// are drawn by forked processes in batch mode, each with its own file and
+// canvas, so that ROOT never draws from two threads; they take the next
+// plot from a counter shared between them until none is left.
+void savePlots(std::vector<std::string> const& plots, int nWorkers) {
+  section("Saving histograms to PDF");
+  if (plots.empty()) {
+    std::cout << "No plots selected\n";
+    return;
+  }
   if (!std::filesystem::exists("histos")) {
     std::filesystem::create_directory("histos");
   }
+  const auto start = std::chrono::steady_clock::now();
+  nWorkers = std::min<int>(nWorkers, plots.size());
+  bool saved = true;
+  if (nWorkers == 1) {
+    std::atomic<int> next{0};
+    saved = drawPlots(plots, next);
+  } else {
+    void* shared = mmap(nullptr, sizeof(std::atomic<int>),
+                        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1,
+                        0);
+    if (shared == MAP_FAILED) {
+      std::cout << "Unable to share memory with the plot workers\n";
+      return;
+    }
+    auto* next = new (shared) std::atomic<int>{0};
+    // buffered output would be written again by every worker
+    std::cout.flush();
+    std::fflush(stdout);
+    std::vector<pid_t> workers;
+    for (int w = 0; w < nWorkers; w++) {
+      const pid_t pid = fork();
+      if (pid == 0) {
+        _exit(drawPlots(plots, *next) ? EXIT_SUCCESS : EXIT_FAILURE);
+      }
+      if (pid < 0) {
+        saved = false;
+        break;
+      }
+      workers.push_back(pid);
+    }
+    for (pid_t pid : workers) {
+      int status;
+      saved &= waitpid(pid, &status, 0) == pid && WIFEXITED(status) &&
+               WEXITSTATUS(status) == EXIT_SUCCESS;
+    }
+    munmap(shared, sizeof(std::atomic<int>));
+  }
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  if (!saved) {
+    std::cout << "Some plots could not be saved\n";
+    return;
+  }
+  std::cout << "Saved " << plots.size() << " plots in " << seconds << "s with "
+            << nWorkers << " worker(s)\n";
+}
 
+// draws the plots whose indices are taken from next, reading them from a
+// file of its own; false if the file or one of the plots is missing
+bool drawPlots(std::vector<std::string> const& plots, std::atomic<int>& next) {
+  TFile file(SAVE_FILE);
+  if (!file.IsOpen()) return false;
+  HistoStore histos(file);
   TCanvas canvas("pdf-canvas", "", 700, 700);
-  for (auto& histo : histos) {
-    histo.second->Draw("HIST");
-    canvas.SaveAs(concat("histos/", histo.first, ".pdf").c_str(), "Q");
+  for (int i = next++; i < (int)plots.size(); i = next++) {
+    TH1D* histo = histos.Find(plots[i]);
+    if (!histo) return false;
+    histo->Draw("HIST");
+    canvas.SaveAs(concat("histos/", plots[i], ".pdf").c_str(), "Q");
   }
+  return true;
 }
@@ -0,0 +1,462 @@
+#include <TH1D.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "constants.hpp"
+#include "decay_batch.hpp"
+#include "event_mixing.hpp"
+#include "histo_accumulator.hpp"
+#include "kinematics.hpp"
+#include "pair_categories.hpp"
+#include "pair_filler.hpp"
+#include "particle.hpp"
+#include "particle_batch.hpp"
+#include "particle_catalogue.hpp"
+#include "rng.hpp"
+#include "simulation_histos.hpp"
+#include "table.hpp"
+#include "util.hpp"
+
+struct BenchOptions {
+  int warmup = 2;
+  int repetitions = 10;
+  std::string jsonPath;
+  std::string csvPath;
+};
+
+struct BenchResult {
+  std::string name;
+  // what an operation is: a call, a pair, an event...
+  std::string unit;
+  long opsPerRepetition;
+  int repetitions;
+  double meanNs, stddevNs, minNs;  // per operation
+  // operations in an event, 0 if it is not an event based benchmark
+  long opsPerEvent = 0;
+};
+
+// keeps the compiler from optimizing away a computed value
+template <class T>
+inline void doNotOptimize(T const& value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Runs body (which performs opsPerRepetition operations) warmup times
+// untimed, then repetitions times timed
+template <class F>
+BenchResult runBench(BenchOptions const& options, std::string name,
+                     std::string unit, long opsPerRepetition, F&& body) {
+  for (int r = 0; r < options.warmup; r++) {
+    body();
+  }
+  std::vector<double> nsPerOp(options.repetitions);
+  for (int r = 0; r < options.repetitions; r++) {
+    const auto start = std::chrono::steady_clock::now();
+    body();
+    const auto stop = std::chrono::steady_clock::now();
+    const std::chrono::duration<double, std::nano> elapsed = stop - start;
+    nsPerOp[r] = elapsed.count() / opsPerRepetition;
+  }
+  double mean = 0.;
+  for (double ns : nsPerOp) mean += ns;
+  mean /= options.repetitions;
+  double variance = 0.;
+  for (double ns : nsPerOp) variance += (ns - mean) * (ns - mean);
+  variance /= std::max(options.repetitions - 1, 1);
+  BenchResult result;
+  result.name = name;
+  result.unit = unit;
+  result.opsPerRepetition = opsPerRepetition;
+  result.repetitions = options.repetitions;
+  result.meanNs = mean;
+  result.stddevNs = std::sqrt(variance);
+  result.minNs = *std::min_element(nsPerOp.begin(), nsPerOp.end());
+  return result;
+}
+
+std::string format(double value, const char* fmt) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof buffer, fmt, value);
+  return buffer;
+}
+
+// random primaries as generated by the simulation
+std::vector<Particle> makeEvent(ParticleIds const& ids, int multiplicity,
+                                uint64_t event) {
+  Rng rng(0xBE4C4, event);
+  std::vector<Particle> particles;
+  particles.reserve(multiplicity);
+  for (int i = 0; i < multiplicity; i++) {
+    const double phi = rng.Uniform(0., 2. * M_PI);
+    const double theta = rng.Uniform(0., M_PI);
+    const double p = rng.Exp(1.);
+    particles.emplace_back(determineParticleType(ids, rng),
+                           p * std::sin(theta) * std::cos(phi),
+                           p * std::sin(theta) * std::sin(phi),
+                           p * std::cos(theta));
+  }
+  return particles;
+}
+
+std::vector<BenchResult> runBenches(BenchOptions const& options,
+                                    ParticleIds const& ids,
+                                    PairCategoryTable const& categories) {
+  std::vector<BenchResult> results;
+  const int n = 1 << 12;
+  const std::vector<Particle> particles = makeEvent(ids, n, 0);
+
+  results.push_back(runBench(options, "Particle::InvMass", "call", n, [&] {
+    for (int i = 0; i < n; i++) {
+      doNotOptimize(particles[i].InvMass(particles[(i + 1) % n]));
+    }
+  }));
+
+  results.push_back(runBench(options, "Particle::TotalEnergy", "call", n, [&] {
+    for (int i = 0; i < n; i++) {
+      doNotOptimize(particles[i].TotalEnergy());
+    }
+  }));
+
+  std::vector<Particle> boosted = particles;
+  int boostRep = 0;
+  results.push_back(runBench(options, "Particle::Boost", "call", n, [&] {
+    // every particle is boosted back by the next repetition, so the momenta
+    // stay bounded
+    const double sign = (boostRep++ & 1) ? 1. : -1.;
+    for (int i = 0; i < n; i++) {
+      boosted[i].Boost(sign * 0.1, sign * 0.2, sign * 0.3);
+    }
+    doNotOptimize(boosted.data());
+  }));
+
+  Particle kStar(ids.kStar, 0.3, -0.2, 0.5);
+  Particle dau1(ids.pioneP), dau2(ids.kaoneN);
+  Rng decayRng(0xBE4C4, 1);
+  results.push_back(runBench(options, "Particle::Decay2body", "call", n, [&] {
+    for (int i = 0; i < n; i++) {
+      kStar.Decay2body(dau1, dau2, decayRng);
+      doNotOptimize(dau1.GetFourMomentum());
+    }
+  }));
+
+  DecayBatch decays;
+  results.push_back(runBench(options, "DecayBatch::Decay", "decay", n, [&] {
+    decays.Clear();
+    for (int i = 0; i < n; i++) {
+      decays.Add(kStar, ids.pioneP, ids.kaoneN, decayRng);
+    }
+    decays.Decay();
+    doNotOptimize(decays.GetDau1(0));
+  }));
+
+  Rng typeRng(0xBE4C4, 2);
+  results.push_back(runBench(options, "determineParticleType", "call", n, [&] {
+    for (int i = 0; i < n; i++) {
+      doNotOptimize(determineParticleType(ids, typeRng));
+    }
+  }));
+
+  // primary kinematics, scalar as before and in bulk as in the simulation
+  std::vector<TypeId> kinematicsTypes(n);
+  for (int i = 0; i < n; i++) {
+    kinematicsTypes[i] = particles[i].GetParticleType();
+  }
+  ParticleTable const& table = Particle::GetParticleTable();
+  Rng kinematicsRng(0xBE4C4, 5);
+  results.push_back(runBench(options, "scalar kinematics", "particle", n, [&] {
+    for (int i = 0; i < n; i++) {
+      const double phi = kinematicsRng.Uniform(0., 2. * M_PI);
+      const double theta = kinematicsRng.Uniform(0., M_PI);
+      const double p = kinematicsRng.Exp(1.);
+      doNotOptimize(makeFourMomentum(
+          p * std::sin(theta) * std::cos(phi),
+          p * std::sin(theta) * std::sin(phi), p * std::cos(theta),
+          table[kinematicsTypes[i]].fMass2));
+    }
+  }));
+  KinematicsBatch kinematics;
+  results.push_back(
+      runBench(options, "KinematicsBatch::Generate", "particle", n, [&] {
+        kinematics.Clear();
+        kinematics.Add(kinematicsRng, kinematicsTypes.data(), n);
+        kinematics.Generate(table);
+        doNotOptimize(kinematics.GetFourMomentum(n - 1));
+      }));
+
+  // invariant masses of a row of pairs alone, in both precisions
+  ParticleBatch rowBatch;
+  for (Particle const& particle : particles) {
+    rowBatch.Push(particle);
+  }
+  std::vector<double> rowMasses(n);
+  const PairPrecision precisions[] = {PairPrecision::DOUBLE,
+                                      PairPrecision::FLOAT};
+  for (PairPrecision precision : precisions) {
+    results.push_back(runBench(
+        options, concat("invMassRow ", pairPrecisionName(precision)), "pair",
+        n - 1, [&] {
+          invMassRow(rowBatch, 0, 1, n, rowMasses.data(), precision);
+          doNotOptimize(rowMasses.data());
+        }));
+  }
+
+  // full event pair loop, all pairs plus the category histograms, with the
+  // reference double arithmetic, with float, sampling a tenth of the pairs
+  // and sharing the tiles of large events between all the cores; the rate
+  // is of the pairs of the events, sampled or not
+  SimulationHistos histos;
+  SimulationAccumulators accumulators(histos);
+  Rng pairRng(0xBE4C4, 6);
+  auto benchPairFiller = [&](PairFiller& filler, std::string const& suffix) {
+    for (int multiplicity : {100, 200, 500, 1000, 5000}) {
+      const std::vector<Particle> event = makeEvent(ids, multiplicity, 3);
+      const long pairs =
+          static_cast<long>(multiplicity) * (multiplicity - 1) / 2;
+      const long events = std::max(1L, (1L << 22) / pairs);
+      BenchResult result = runBench(
+          options,
+          concat("PairFiller::Fill", suffix, " (", multiplicity, " particles)"),
+          "pair", pairs * events, [&] {
+            for (long e = 0; e < events; e++) {
+              filler.Fill(event, &pairRng);
+            }
+          });
+      result.opsPerEvent = pairs;
+      results.push_back(result);
+    }
+  };
+  for (PairPrecision precision : precisions) {
+    PairFiller filler(categories, accumulators.invMassDist,
+                      accumulators.PairCategoryHistos(), {precision});
+    benchPairFiller(filler,
+                    precision == PairPrecision::DOUBLE ? "" : " float");
+  }
+  PairFiller sampledFiller(categories, accumulators.invMassDist,
+                           accumulators.PairCategoryHistos(),
+                           {PairPrecision::DOUBLE, 0.1});
+  benchPairFiller(sampledFiller, " 10%");
+  const int nCores = std::max(1u, std::thread::hardware_concurrency());
+  PairFiller threadedFiller(categories, accumulators.invMassDist,
+                            accumulators.PairCategoryHistos(),
+                            {PairPrecision::DOUBLE, 1., nCores});
+  benchPairFiller(threadedFiller, concat(" ", nCores, " threads"));
+
+  // event mixing with a full pool, discordant pairs only like the simulation
+  EventMixer mixer(categories,
+                   {&accumulators.invMassMixedDiscordantDist, nullptr,
+                    &accumulators.invMassMixedPioneKaoneDiscordantDist,
+                    nullptr});
+  // the pool holds copies of the event, so it does not change when the
+  // event is pushed again at every repetition
+  const int MIX_DEPTH = 10;
+  const std::vector<Particle> mixEvent = makeEvent(ids, 100, 4);
+  EventPool pool(MIX_DEPTH, Particle::GetParticleTable().Size(), 1 << 24);
+  Rng mixRng(0xBE4C4, 7);
+  for (int e = 0; e < MIX_DEPTH; e++) {
+    pool.Push(mixEvent, mixRng);
+  }
+  const long mixPairs = mixer.Fill(mixEvent, pool, mixRng);
+  BenchResult mixResult = runBench(
+      options, concat("EventMixer::Fill (depth ", MIX_DEPTH, ")"), "pair",
+      mixPairs, [&] { doNotOptimize(mixer.Fill(mixEvent, pool, mixRng)); });
+  mixResult.opsPerEvent = mixPairs;
+  results.push_back(mixResult);
+
+  // histogram filling
+  std::vector<double> values(n);
+  Rng valueRng(0xBE4C4, 4);
+  valueRng.Uniform(values.data(), n, 0., 10.);
+  TH1D histo("bench-histo", "Bench", 1000, 0, 10);
+  results.push_back(runBench(options, "TH1D::Fill", "fill", n, [&] {
+    for (double x : values) {
+      histo.Fill(x);
+    }
+  }));
+  HistoAccumulator accumulator(histo);
+  results.push_back(runBench(options, "HistoAccumulator::Fill", "fill", n, [&] {
+    for (double x : values) {
+      accumulator.Fill(x);
+    }
+  }));
+  results.push_back(runBench(options, "HistoAccumulator::FillN", "fill", n,
+                             [&] { accumulator.FillN(n, values.data()); }));
+
+  return results;
+}
+
+// Measures how far the float pair kernel is from the double one on the
+// pairs of PRECISION_EVENTS events: the largest error of the invariant mass
+// and the number of pairs that end up in another bin of the pair histograms.
+// Float can only be trusted where the largest error is below the bin width,
+// so that a pair can at most move to the next bin.
+void printPairPrecision(ParticleIds const& ids) {
+  const int PRECISION_EVENTS = 1000;
+  SimulationHistos histos;
+  TAxis const& axis = *histos.invMassDist.GetXaxis();
+  const double binWidth = axis.GetBinWidth(1);
+  long nPairs = 0, nMigrations = 0, nInvalid = 0;
+  double maxError = 0., maxRelativeError = 0., meanError = 0.;
+  ParticleBatch batch;
+  std::vector<double> reference, single;
+  for (int e = 0; e < PRECISION_EVENTS; e++) {
+    const std::vector<Particle> event = makeEvent(ids, N_PARTICLES, 100 + e);
+    batch.Clear();
+    for (Particle const& particle : event) {
+      batch.Push(particle);
+    }
+    const int n = batch.Size();
+    reference.resize(n);
+    single.resize(n);
+    for (int i = 0; i < n - 1; i++) {
+      invMassRow(batch, i, i + 1, n, reference.data(), PairPrecision::DOUBLE);
+      invMassRow(batch, i, i + 1, n, single.data(), PairPrecision::FLOAT);
+      for (int j = 0; j < n - i - 1; j++) {
+        nPairs++;
+        if (!std::isfinite(single[j])) {
+          nInvalid++;
+          continue;
+        }
+        const double error = std::abs(single[j] - reference[j]);
+        maxError = std::max(maxError, error);
+        maxRelativeError = std::max(maxRelativeError, error / reference[j]);
+        meanError += error;
+        nMigrations += axis.FindFixBin(single[j]) !=
+                       axis.FindFixBin(reference[j]);
+      }
+    }
+  }
+  meanError /= nPairs - nInvalid;
+
+  section("Pair precision");
+  Table<const char*, std::string>()
+      .headers({"FLOAT AGAINST DOUBLE", "VALUE"})
+      .row("pairs", format(nPairs, "%.0f"))
+      .row("max error (GeV)", format(maxError, "%.3e"))
+      .row("mean error (GeV)", format(meanError, "%.3e"))
+      .row("max relative error", format(maxRelativeError, "%.3e"))
+      .row("bin width (GeV)", format(binWidth, "%.3e"))
+      .row("max error / bin width", format(maxError / binWidth, "%.3e"))
+      .row("bin migrations", format(nMigrations, "%.0f"))
+      .row("migrated fraction", format(double(nMigrations) / nPairs, "%.3e"))
+      .row("invalid masses", format(nInvalid, "%.0f"))
+      .print();
+  const bool safe = nInvalid == 0 && maxError < binWidth;
+  std::cout << "Float pair masses "
+            << (safe ? "stay within one bin of double"
+                     : "can move pairs by more than one bin")
+            << "\n";
+}
+
+void writeJson(std::string const& path,
+               std::vector<BenchResult> const& results) {
+  std::ofstream out(path);
+  out << "[\n";
+  for (size_t i = 0; i < results.size(); i++) {
+    BenchResult const& r = results[i];
+    out << "  {\"name\": \"" << r.name << "\", \"unit\": \"" << r.unit
+        << "\", \"ops_per_repetition\": " << r.opsPerRepetition
+        << ", \"repetitions\": " << r.repetitions
+        << ", \"mean_ns\": " << r.meanNs << ", \"stddev_ns\": " << r.stddevNs
+        << ", \"min_ns\": " << r.minNs
+        << ", \"ops_per_second\": " << 1e9 / r.meanNs;
+    if (r.opsPerEvent > 0) {
+      out << ", \"events_per_second\": " << 1e9 / r.meanNs / r.opsPerEvent;
+    }
+    out << "}"
+        << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "]\n";
+}
+
+void writeCsv(std::string const& path,
+              std::vector<BenchResult> const& results) {
+  std::ofstream out(path);
+  out << "name,unit,ops_per_repetition,repetitions,mean_ns,stddev_ns,min_ns,"
+         "ops_per_second,events_per_second\n";
+  for (BenchResult const& r : results) {
+    out << "\"" << r.name << "\"," << r.unit << "," << r.opsPerRepetition
+        << "," << r.repetitions << "," << r.meanNs << "," << r.stddevNs << ","
+        << r.minNs << "," << 1e9 / r.meanNs << ",";
+    if (r.opsPerEvent > 0) {
+      out << 1e9 / r.meanNs / r.opsPerEvent;
+    }
+    out << "\n";
+  }
+}
+
+bool parseArgs(int argc, char** argv, BenchOptions& options) {
+  try {
+    for (int i = 1; i < argc; i++) {
+      if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+        options.warmup = std::stoi(argv[++i]);
+        if (options.warmup < 0) return false;
+      } else if (std::strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+        options.repetitions = std::stoi(argv[++i]);
+        if (options.repetitions < 1) return false;
+      } else if (std::strcmp(argv[i], "--json") == 0 && i + 1 < argc) {
+        options.jsonPath = argv[++i];
+      } else if (std::strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+        options.csvPath = argv[++i];
+      } else {
+        return false;
+      }
+    }
+  } catch (std::exception const&) {
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  BenchOptions options;
+  if (!parseArgs(argc, argv, options)) {
+    std::cout << "Usage: bench [--warmup W] [--reps R] [--json PATH] "
+                 "[--csv PATH]\n";
+    std::cout << "  --warmup W   untimed runs of every benchmark (default 2)\n";
+    std::cout << "  --reps R     timed runs of every benchmark (default 10)\n";
+    std::cout << "  --json PATH  also write the results as JSON\n";
+    std::cout << "  --csv PATH   also write the results as CSV\n";
+    return EXIT_FAILURE;
+  }
+
+  TH1::AddDirectory(kFALSE);
+  const ParticleIds ids = addParticleTypes();
+  Particle::FreezeParticleTypes();
+  const PairCategoryTable categories = buildPairCategories(ids);
+
+  section("Benchmarks");
+  const std::vector<BenchResult> results = runBenches(options, ids, categories);
+
+  auto table = Table<std::string, std::string, std::string, std::string,
+                     std::string, std::string, std::string>();
+  table.headers(
+      {"BENCHMARK", "NS/OP", "STDDEV", "MIN", "OPS/S", "OP", "EVENTS/S"});
+  for (BenchResult const& r : results) {
+    table.row(r.name, format(r.meanNs, "%.2f"), format(r.stddevNs, "%.2f"),
+              format(r.minNs, "%.2f"), format(1e9 / r.meanNs, "%.3e"), r.unit,
+              r.opsPerEvent > 0 ? format(1e9 / r.meanNs / r.opsPerEvent, "%.1f")
+                                : "-");
+  }
+  table.print();
+
+  printPairPrecision(ids);
+
+  if (!options.jsonPath.empty()) {
+    writeJson(options.jsonPath, results);
+    std::cout << "Saved to " << options.jsonPath << "\n";
+  }
+  if (!options.csvPath.empty()) {
+    writeCsv(options.csvPath, results);
+    std::cout << "Saved to " << options.csvPath << "\n";
+  }
+}
@@ -0,0 +1,242 @@
+#include "checkpoint.hpp"
+
+#include <TFile.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+const char CHECKPOINT_MAGIC[8] = {'S', 'I', 'M', 'C', 'K', 'P', 'T', '\0'};
+const uint32_t CHECKPOINT_VERSION = 5;
+
+template <class T>
+static void writeValue(std::ofstream& out, T const& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof value);
+}
+
+template <class T>
+static T readValue(std::ifstream& in) {
+  T value;
+  if (!in.read(reinterpret_cast<char*>(&value), sizeof value)) {
+    throw std::runtime_error("Checkpoint file is truncated");
+  }
+  return value;
+}
+
+int countEvents(std::vector<EventRange> const& ranges) {
+  int n = 0;
+  for (auto const& range : ranges) {
+    n += range.fLast - range.fFirst;
+  }
+  return n;
+}
+
+EventRange shardEventRange(int nEvents, int index, int nShards) {
+  const long total = nEvents;
+  return {static_cast<int>(total * index / nShards),
+          static_cast<int>(total * (index + 1) / nShards)};
+}
+
+std::vector<std::vector<EventRange>> splitEventRanges(
+    std::vector<EventRange> const& ranges, int nParts) {
+  const long total = countEvents(ranges);
+  std::vector<std::vector<EventRange>> parts(nParts);
+  size_t r = 0;
+  int next = ranges.empty() ? 0 : ranges[0].fFirst;
+  for (int p = 0; p < nParts; p++) {
+    // events of part p, as evenly as possible
+    long size = total * (p + 1) / nParts - total * p / nParts;
+    while (size > 0 && r < ranges.size()) {
+      const int last = std::min<long>(ranges[r].fLast, next + size);
+      if (last > next) parts[p].push_back({next, last});
+      size -= last - next;
+      next = last;
+      if (next == ranges[r].fLast && ++r < ranges.size()) {
+        next = ranges[r].fFirst;
+      }
+    }
+  }
+  return parts;
+}
+
+bool writeCheckpoint(std::string const& path, Checkpoint const& checkpoint,
+                     SimulationHistos const& histos) {
+  const std::string tmpPath = path + ".tmp";
+  {
+    std::ofstream out(tmpPath, std::ios::binary);
+    if (!out) {
+      return false;
+    }
+    out.write(CHECKPOINT_MAGIC, sizeof CHECKPOINT_MAGIC);
+    writeValue(out, CHECKPOINT_VERSION);
+    writeValue(out, checkpoint.fSeed);
+    writeValue(out, checkpoint.fNEvents);
+    writeValue(out, checkpoint.fNParticles);
+    writeValue(out, static_cast<int>(checkpoint.fPairPrecision));
+    writeValue(out, checkpoint.fPairFraction);
+    writeValue(out, checkpoint.fMixDepth);
+    writeValue(out, checkpoint.fMixMemoryMb);
+    writeValue(out, static_cast<int>(checkpoint.fRemaining.size()));
+    for (auto const& range : checkpoint.fRemaining) {
+      writeValue(out, range.fFirst);
+      writeValue(out, range.fLast);
+    }
+    // bins include underflow and overflow
+    writeValue(out, static_cast<int>(histos.All().size()));
+    for (TH1D const* histo : histos.All()) {
+      const int nBins = histo->GetNbinsX() + 2;
+      const bool hasSumw2 = histo->GetSumw2N() > 0;
+      double stats[4];
+      histo->GetStats(stats);
+      writeValue(out, nBins);
+      writeValue(out, hasSumw2);
+      for (int bin = 0; bin < nBins; bin++) {
+        writeValue(out, histo->GetBinContent(bin));
+        if (hasSumw2) writeValue(out, (*histo->GetSumw2())[bin]);
+      }
+      out.write(reinterpret_cast<const char*>(stats), sizeof stats);
+      writeValue(out, histo->GetEntries());
+    }
+    if (!out) {
+      return false;
+    }
+  }
+  return std::rename(tmpPath.c_str(), path.c_str()) == 0;
+}
+
+Checkpoint readCheckpoint(std::string const& path, SimulationHistos& histos) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("Unable to open " + path + " file");
+  }
+  char magic[sizeof CHECKPOINT_MAGIC];
+  in.read(magic, sizeof magic);
+  if (!in || std::memcmp(magic, CHECKPOINT_MAGIC, sizeof magic) != 0 ||
+      readValue<uint32_t>(in) != CHECKPOINT_VERSION) {
+    throw std::runtime_error(path + " is not a checkpoint file");
+  }
+  Checkpoint checkpoint;
+  checkpoint.fSeed = readValue<uint64_t>(in);
+  checkpoint.fNEvents = readValue<int>(in);
+  checkpoint.fNParticles = readValue<int>(in);
+  checkpoint.fPairPrecision = static_cast<PairPrecision>(readValue<int>(in));
+  checkpoint.fPairFraction = readValue<double>(in);
+  checkpoint.fMixDepth = readValue<int>(in);
+  checkpoint.fMixMemoryMb = readValue<long>(in);
+  const int nRanges = readValue<int>(in);
+  for (int r = 0; r < nRanges; r++) {
+    const int first = readValue<int>(in);
+    const int last = readValue<int>(in);
+    checkpoint.fRemaining.push_back({first, last});
+  }
+  if (readValue<int>(in) != (int)histos.All().size()) {
+    throw std::runtime_error(path + " has different pair categories");
+  }
+  for (TH1D* histo : histos.All()) {
+    const int nBins = readValue<int>(in);
+    const bool hasSumw2 = readValue<bool>(in);
+    if (nBins != histo->GetNbinsX() + 2) {
+      throw std::runtime_error(path + " has a different binning");
+    }
+    if (hasSumw2) histo->Sumw2();
+    double stats[4];
+    histo->GetStats(stats);
+    const double entries = histo->GetEntries();
+    for (int bin = 0; bin < nBins; bin++) {
+      const double content = readValue<double>(in);
+      histo->SetBinContent(bin, histo->GetBinContent(bin) + content);
+      if (hasSumw2) (*histo->GetSumw2())[bin] += readValue<double>(in);
+    }
+    for (double& stat : stats) {
+      stat += readValue<double>(in);
+    }
+    histo->PutStats(stats);
+    histo->SetEntries(entries + readValue<double>(in));
+  }
+  return checkpoint;
+}
+
+CheckpointWriter::CheckpointWriter(
+    std::string path, Checkpoint run, SimulationHistos const& base,
+    std::vector<std::vector<EventRange>> const& ranges)
+    : fPath{std::move(path)},
+      fRun{std::move(run)},
+      fBase{base},
+      fLatest(ranges.size()),
+      fPending(ranges.size()),
+      fStop{false},
+      fNWritten{0} {
+  for (size_t w = 0; w < ranges.size(); w++) {
+    fLatest[w].fRemaining = ranges[w];
+  }
+  fThread = std::thread(&CheckpointWriter::Run, this);
+}
+
+CheckpointWriter::~CheckpointWriter() {
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fStop = true;
+  }
+  fWakeUp.notify_one();
+  fThread.join();
+}
+
+void CheckpointWriter::Submit(int worker, SimulationHistos const& histos,
+                              std::vector<EventRange> remaining) {
+  // the copy is made by the worker, the lock only swaps pointers
+  Snapshot snapshot{std::make_unique<SimulationHistos>(histos),
+                    std::move(remaining)};
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fPending[worker] = std::move(snapshot);
+  }
+  fWakeUp.notify_one();
+}
+
+int CheckpointWriter::GetNWritten() {
+  std::lock_guard<std::mutex> lock(fMutex);
+  return fNWritten;
+}
+
+void CheckpointWriter::Run() {
+  std::unique_lock<std::mutex> lock(fMutex);
+  while (true) {
+    auto hasPending = [this] {
+      for (auto const& snapshot : fPending) {
+        if (snapshot.fHistos) return true;
+      }
+      return false;
+    };
+    fWakeUp.wait(lock, [&] { return fStop || hasPending(); });
+    if (!hasPending()) {
+      return;
+    }
+    for (size_t w = 0; w < fPending.size(); w++) {
+      if (fPending[w].fHistos) fLatest[w] = std::move(fPending[w]);
+      fPending[w] = Snapshot{};
+    }
+    lock.unlock();
+
+    // every snapshot covers exactly the events its worker has completed
+    SimulationHistos merged(fBase);
+    Checkpoint checkpoint = fRun;
+    for (auto const& snapshot : fLatest) {
+      if (snapshot.fHistos) merged.Add(*snapshot.fHistos);
+      checkpoint.fRemaining.insert(checkpoint.fRemaining.end(),
+                                   snapshot.fRemaining.begin(),
+                                   snapshot.fRemaining.end());
+    }
+    const bool written = writeCheckpoint(fPath, checkpoint, merged);
+    // partial histograms that can be opened with ROOT during the run
+    TFile partialFile((fPath + ".root").c_str(), "RECREATE");
+    if (partialFile.IsOpen()) {
+      merged.Write();
+      partialFile.Close();
+    }
+
+    lock.lock();
+    if (written) fNWritten++;
+  }
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "particle_batch.hpp"
+#include "simulation_histos.hpp"
+
+// events [fFirst, fLast) of a run
+struct EventRange {
+  int fFirst, fLast;
+};
+
+// State of a run besides its histograms. Events are generated from (seed,
+// event number), so the events still to simulate are all the random state
+// a resumed run needs.
+struct Checkpoint {
+  uint64_t fSeed;
+  int fNEvents;
+  // settings that change the histograms of an event: a run resumed with
+  // other values would mix two different simulations
+  int fNParticles;
+  PairPrecision fPairPrecision;
+  double fPairFraction;
+  // the event pools are not saved: a resumed run starts them empty, but
+  // refuses to mix with other pools than the saved run
+  int fMixDepth;
+  long fMixMemoryMb;
+  std::vector<EventRange> fRemaining;
+};
+
+int countEvents(std::vector<EventRange> const& ranges);
+// Events of shard index of nShards of a run of nEvents events. The shards
+// are disjoint, consecutive and together cover the whole run.
+EventRange shardEventRange(int nEvents, int index, int nShards);
+// Splits ranges into nParts lists with (almost) the same number of events
+std::vector<std::vector<EventRange>> splitEventRanges(
+    std::vector<EventRange> const& ranges, int nParts);
+
+// Writes the checkpoint and the histogram contents to path. The file is
+// written beside it and renamed, so path always holds a complete checkpoint.
+bool writeCheckpoint(std::string const& path, Checkpoint const& checkpoint,
+                     SimulationHistos const& histos);
+// Reads a checkpoint and adds its contents to histos, which must have the
+// binning of the simulation. Throws std::runtime_error on invalid files.
+Checkpoint readCheckpoint(std::string const& path, SimulationHistos& histos);
+
+// Writes checkpoints on a background thread. Workers Submit a copy of their
+// histograms with the events they still have to simulate; the thread merges
+// the last snapshot of every worker and writes it, so workers never wait
+// for the disk.
+class CheckpointWriter {
+ private:
+  struct Snapshot {
+    std::unique_ptr<SimulationHistos> fHistos;
+    std::vector<EventRange> fRemaining;
+  };
+
+  std::string fPath;
+  // settings of the run, without events
+  Checkpoint fRun;
+  // contents of the checkpoint the run was resumed from
+  SimulationHistos const& fBase;
+  // last snapshot written for every worker
+  std::vector<Snapshot> fLatest;
+  // snapshots not written yet, guarded by fMutex
+  std::vector<Snapshot> fPending;
+  bool fStop;
+  int fNWritten;
+  std::mutex fMutex;
+  std::condition_variable fWakeUp;
+  std::thread fThread;
+
+  void Run();
+
+ public:
+  // run holds the settings written in every checkpoint, ranges[w] are the
+  // events assigned to worker w
+  CheckpointWriter(std::string path, Checkpoint run,
+                   SimulationHistos const& base,
+                   std::vector<std::vector<EventRange>> const& ranges);
+  // stops the thread after writing the pending snapshots
+  ~CheckpointWriter();
+  CheckpointWriter(CheckpointWriter const&) = delete;
+  CheckpointWriter& operator=(CheckpointWriter const&) = delete;
+  void Submit(int worker, SimulationHistos const& histos,
+              std::vector<EventRange> remaining);
+  int GetNWritten();
+};
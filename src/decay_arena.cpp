@@ -0,0 +1,81 @@
+#include "decay_arena.hpp"
+
+#include <utility>
+
+#include "four_momentum.hpp"
+
+void DecayArena::Clear() {
+  fParticles.clear();
+  fEvents.clear();
+  fParents.clear();
+}
+
+int DecayArena::Add(Particle const& particle, int event, int parent) {
+  fParticles.push_back(particle);
+  fEvents.push_back(event);
+  fParents.push_back(parent);
+  return fParticles.size() - 1;
+}
+
+int DecayArena::Size() const {
+  return fParticles.size();
+}
+
+void DecayArena::SortByEvent(int nEvents) {
+  // stable counting sort, like bucketByType
+  fEventOffsets.assign(nEvents + 1, 0);
+  for (int event : fEvents) {
+    fEventOffsets[event + 1]++;
+  }
+  for (int e = 0; e < nEvents; e++) {
+    fEventOffsets[e + 1] += fEventOffsets[e];
+  }
+  fOrder.resize(fParticles.size());
+  for (int node = 0; node < Size(); node++) {
+    fOrder[fEventOffsets[fEvents[node]]++] = node;
+  }
+  // the fill moved every offset to the end of its event
+  for (int e = nEvents; e > 0; e--) {
+    fEventOffsets[e] = fEventOffsets[e - 1];
+  }
+  fEventOffsets[0] = 0;
+}
+
+void CascadeDecayer::Decay(DecayArena& arena, Rng* rngs,
+                           std::vector<double>& siblingMasses) {
+  ParticleTable const& table = Particle::GetParticleTable();
+  fPending.clear();
+  for (int node = 0; node < arena.Size(); node++) {
+    if (table.IsUnstable(arena.Get(node).GetParticleType())) {
+      fPending.push_back(node);
+    }
+  }
+  for (int generation = 0;
+       !fPending.empty() && generation < MAX_DECAY_GENERATIONS; generation++) {
+    fBatch.Clear();
+    for (int node : fPending) {
+      Particle const& mother = arena.Get(node);
+      Rng& rng = rngs[arena.GetEvent(node)];
+      TableDecayChannel const& channel =
+          table.ChooseChannel(mother.GetParticleType(), rng.Rndm());
+      fBatch.Add(mother, channel.fDau1, channel.fDau2, rng);
+    }
+    fBatch.Decay();
+
+    fNext.clear();
+    for (int d = 0; d < fBatch.Size(); d++) {
+      if (fBatch.GetStatus(d) != DecayStatus::OK) continue;
+      const int event = arena.GetEvent(fPending[d]);
+      const int dau1 = arena.Add(Particle(fBatch.GetDau1Type(d),
+                                          fBatch.GetDau1(d)),
+                                 event, fPending[d]);
+      const int dau2 = arena.Add(Particle(fBatch.GetDau2Type(d),
+                                          fBatch.GetDau2(d)),
+                                 event, fPending[d]);
+      siblingMasses.push_back(invMass(fBatch.GetDau1(d), fBatch.GetDau2(d)));
+      if (table.IsUnstable(fBatch.GetDau1Type(d))) fNext.push_back(dau1);
+      if (table.IsUnstable(fBatch.GetDau2Type(d))) fNext.push_back(dau2);
+    }
+    std::swap(fPending, fNext);
+  }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include "decay_batch.hpp"
+#include "particle.hpp"
+#include "rng.hpp"
+
+// Particles of a chunk of events that take part in decays: the unstable
+// primaries and every decay product, as nodes that know their event and the
+// node they come from. Clear keeps the storage, so once the arena has grown
+// to the largest chunk decays add no heap traffic, however long the chains.
+class DecayArena {
+ private:
+  std::vector<Particle> fParticles;
+  std::vector<int> fEvents, fParents;
+  // nodes grouped by event, filled by SortByEvent
+  std::vector<int> fOrder, fEventOffsets;
+
+ public:
+  void Clear();
+  // returns the node of the particle, parent is -1 for primaries
+  int Add(Particle const& particle, int event, int parent);
+  int Size() const;
+  Particle const& Get(int node) const {
+    return fParticles[node];
+  }
+  int GetEvent(int node) const {
+    return fEvents[node];
+  }
+  int GetParent(int node) const {
+    return fParents[node];
+  }
+  // groups the nodes by event keeping their order, call after the last Add
+  void SortByEvent(int nEvents);
+  // the nodes of event e are Node(k) for k in [EventBegin(e), EventEnd(e))
+  int EventBegin(int event) const {
+    return fEventOffsets[event];
+  }
+  int EventEnd(int event) const {
+    return fEventOffsets[event + 1];
+  }
+  int Node(int k) const {
+    return fOrder[k];
+  }
+};
+
+// decay generations after which the products are left undecayed, a guard
+// against decay tables with loops
+const int MAX_DECAY_GENERATIONS = 16;
+
+// Decays the unstable nodes of an arena, then their unstable products, one
+// generation at a time: every generation is a single DecayBatch over all the
+// events, so there is no recursion and no per-decay allocation.
+class CascadeDecayer {
+ private:
+  DecayBatch fBatch;
+  std::vector<int> fPending, fNext;
+
+ public:
+  // rngs[e] is the decay stream of event e. The invariant mass of the two
+  // daughters of every decay is appended to siblingMasses. Decays whose
+  // mother is below threshold produce nothing.
+  void Decay(DecayArena& arena, Rng* rngs, std::vector<double>& siblingMasses);
+};
@@ -0,0 +1,162 @@
+#include "decay_batch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+DecayBatch::DecayBatch(int maxAttempts) : fMaxAttempts{maxAttempts} {
+  if (maxAttempts < 1) {
+    throw std::invalid_argument("maxAttempts must be at least 1");
+  }
+}
+
+void DecayBatch::Clear() {
+  fPx.clear();
+  fPy.clear();
+  fPz.clear();
+  fMass.clear();
+  fWidth.clear();
+  fDau1Type.clear();
+  fDau2Type.clear();
+  fDau1Mass.clear();
+  fDau2Mass.clear();
+  fRng.clear();
+}
+
+int DecayBatch::Add(Particle const& mother, TypeId dau1, TypeId dau2,
+                    Rng& rng) {
+  ParticleTable const& table = Particle::GetParticleTable();
+  FourMomentum const& p = mother.GetFourMomentum();
+  fPx.push_back(p.fPx);
+  fPy.push_back(p.fPy);
+  fPz.push_back(p.fPz);
+  fMass.push_back(table[mother.GetParticleType()].fMass);
+  fWidth.push_back(table[mother.GetParticleType()].fWidth);
+  fDau1Type.push_back(dau1);
+  fDau2Type.push_back(dau2);
+  fDau1Mass.push_back(table[dau1].fMass);
+  fDau2Mass.push_back(table[dau2].fMass);
+  fRng.push_back(&rng);
+  return fPx.size() - 1;
+}
+
+void DecayBatch::Decay() {
+  const int n = Size();
+  fGausU1.resize(n);
+  fGausU2.resize(n);
+  fU1.resize(n);
+  fU2.resize(n);
+  fMassMot.resize(n);
+  fDau1.resize(n);
+  fDau2.resize(n);
+  fStatus.resize(n);
+
+  // uniforms of every entry from its event stream, in the same order as
+  // Particle::Decay2body, then the Gaussians are computed all at once
+  double draws[4];
+  for (int i = 0; i < n; i++) {
+    fRng[i]->Rndm(draws, 4);
+    fGausU1[i] = draws[0];
+    fGausU2[i] = draws[1];
+    fU1[i] = draws[2];
+    fU2[i] = draws[3];
+  }
+
+  // width smearing
+  for (int i = 0; i < n; i++) {
+    fMassMot[i] = fMass[i] + fWidth[i] * boxMuller(fGausU1[i], fGausU2[i]);
+  }
+
+  // resample the few masses below threshold, a round of all of them at a time
+  fRetry.clear();
+  for (int i = 0; i < n; i++) {
+    if (fMassMot[i] < fDau1Mass[i] + fDau2Mass[i]) fRetry.push_back(i);
+  }
+  for (int attempts = 1; !fRetry.empty() && attempts < fMaxAttempts;
+       attempts++) {
+    const int nRetry = fRetry.size();
+    fRetryU1.resize(nRetry);
+    fRetryU2.resize(nRetry);
+    for (int k = 0; k < nRetry; k++) {
+      fRng[fRetry[k]]->Rndm(draws, 2);
+      fRetryU1[k] = draws[0];
+      fRetryU2[k] = draws[1];
+    }
+    for (int k = 0; k < nRetry; k++) {
+      const int i = fRetry[k];
+      fMassMot[i] = fMass[i] + fWidth[i] * boxMuller(fRetryU1[k], fRetryU2[k]);
+    }
+    // keep the ones still below threshold
+    int nLeft = 0;
+    for (int k = 0; k < nRetry; k++) {
+      const int i = fRetry[k];
+      if (fMassMot[i] < fDau1Mass[i] + fDau2Mass[i]) fRetry[nLeft++] = i;
+    }
+    fRetry.resize(nLeft);
+  }
+  for (int i = 0; i < n; i++) {
+    fStatus[i] = fMassMot[i] < fDau1Mass[i] + fDau2Mass[i]
+                     ? DecayStatus::BELOW_THRESHOLD
+                     : DecayStatus::OK;
+  }
+
+  // momentum in the rest frame and boost to the lab frame
+  for (int i = 0; i < n; i++) {
+    const double m = fMassMot[i], m1 = fDau1Mass[i], m2 = fDau2Mass[i];
+    const double sum = (m * m - (m1 + m2) * (m1 + m2));
+    const double diff = (m * m - (m1 - m2) * (m1 - m2));
+    // below threshold entries get a zero momentum instead of a NaN
+    const double pout = std::sqrt(std::max(sum * diff, 0.)) / m * 0.5;
+
+    const double phi = 2 * M_PI * fU1[i];
+    const double theta = M_PI * fU2[i] - M_PI / 2.;
+    const double sinTheta = std::sin(theta);
+    const double qx = pout * sinTheta * std::cos(phi);
+    const double qy = pout * sinTheta * std::sin(phi);
+    const double qz = pout * std::cos(theta);
+    const double e1 = std::sqrt(qx * qx + qy * qy + qz * qz + m1 * m1);
+    const double e2 = std::sqrt(qx * qx + qy * qy + qz * qz + m2 * m2);
+
+    const double energy = std::sqrt(fPx[i] * fPx[i] + fPy[i] * fPy[i] +
+                                    fPz[i] * fPz[i] + m * m);
+    const double bx = fPx[i] / energy;
+    const double by = fPy[i] / energy;
+    const double bz = fPz[i] / energy;
+    const double b2 = bx * bx + by * by + bz * bz;
+    const double gamma = 1.0 / std::sqrt(1.0 - b2);
+    const double gamma2 = b2 > 0 ? (gamma - 1.0) / b2 : 0.0;
+    // the daughters are back to back, so b.q has opposite signs
+    const double bq = bx * qx + by * qy + bz * qz;
+    const double k1 = gamma2 * bq + gamma * e1;
+    const double k2 = -gamma2 * bq + gamma * e2;
+
+    fDau1[i] = makeFourMomentum(qx + k1 * bx, qy + k1 * by, qz + k1 * bz,
+                                m1 * m1);
+    fDau2[i] = makeFourMomentum(-qx + k2 * bx, -qy + k2 * by, -qz + k2 * bz,
+                                m2 * m2);
+  }
+}
+
+int DecayBatch::Size() const {
+  return fPx.size();
+}
+
+DecayStatus DecayBatch::GetStatus(int i) const {
+  return fStatus[i];
+}
+
+TypeId DecayBatch::GetDau1Type(int i) const {
+  return fDau1Type[i];
+}
+
+TypeId DecayBatch::GetDau2Type(int i) const {
+  return fDau2Type[i];
+}
+
+FourMomentum const& DecayBatch::GetDau1(int i) const {
+  return fDau1[i];
+}
+
+FourMomentum const& DecayBatch::GetDau2(int i) const {
+  return fDau2[i];
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <vector>
+
+#include "four_momentum.hpp"
+#include "particle.hpp"
+#include "rng.hpp"
+
+enum class DecayStatus { OK, BELOW_THRESHOLD };
+
+// Two-body decays of many resonances at once. Resonances are collected with
+// Add, then Decay draws the random numbers of every entry and runs mass
+// smearing, angle sampling and Lorentz boosts as loops over plain arrays.
+// A smeared mass below threshold is resampled; if it keeps failing the entry
+// is marked BELOW_THRESHOLD instead of throwing.
+class DecayBatch {
+ private:
+  // inputs
+  std::vector<double> fPx, fPy, fPz, fMass, fWidth;
+  std::vector<TypeId> fDau1Type, fDau2Type;
+  std::vector<double> fDau1Mass, fDau2Mass;
+  std::vector<Rng*> fRng;
+  // random numbers and intermediate results
+  std::vector<double> fGausU1, fGausU2, fU1, fU2, fMassMot;
+  // entries whose mass is still below threshold and their new uniforms
+  std::vector<int> fRetry;
+  std::vector<double> fRetryU1, fRetryU2;
+  // outputs
+  std::vector<FourMomentum> fDau1, fDau2;
+  std::vector<DecayStatus> fStatus;
+  int fMaxAttempts;
+
+ public:
+  explicit DecayBatch(int maxAttempts = 100);
+  void Clear();
+  // rng is the stream the decay draws from, it must outlive the call to Decay
+  int Add(Particle const& mother, TypeId dau1, TypeId dau2, Rng& rng);
+  void Decay();
+  int Size() const;
+  DecayStatus GetStatus(int i) const;
+  TypeId GetDau1Type(int i) const;
+  TypeId GetDau2Type(int i) const;
+  FourMomentum const& GetDau1(int i) const;
+  FourMomentum const& GetDau2(int i) const;
+};
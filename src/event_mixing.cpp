@@ -0,0 +1,164 @@
+#include "event_mixing.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include "four_momentum.hpp"
+
+EventPool::EventPool(int depth, int nTypes, long memoryBytes)
+    : fDepth{depth}, fNTypes{nTypes}, fSize{0}, fNext{0}, fNTruncated{0} {
+  if (depth <= 0 || nTypes <= 0) {
+    throw std::invalid_argument("pool depth and types must be positive");
+  }
+  const long capacity = memoryBytes / (POOL_PARTICLE_BYTES * depth);
+  if (capacity < 1) {
+    throw std::invalid_argument("memory budget too small for the pool depth");
+  }
+  fCapacity = static_cast<int>(std::min<long>(capacity, 1 << 30));
+  const long size = static_cast<long>(fCapacity) * depth;
+  fPx.resize(size);
+  fPy.resize(size);
+  fPz.resize(size);
+  fE.resize(size);
+  fM2.resize(size);
+  fBuckets.resize(depth * (nTypes + 1));
+  fCursors.resize(nTypes);
+}
+
+int EventPool::GetDepth() const {
+  return fDepth;
+}
+
+int EventPool::GetCapacity() const {
+  return fCapacity;
+}
+
+int EventPool::Size() const {
+  return fSize;
+}
+
+long EventPool::GetNTruncated() const {
+  return fNTruncated;
+}
+
+void EventPool::Clear() {
+  fSize = 0;
+  fNext = 0;
+}
+
+void EventPool::Push(std::vector<Particle> const& particles, Rng& rng) {
+  PushParticles(
+      particles.size(),
+      [&](int k) { return particles[k].GetParticleType(); },
+      [&](int k) -> FourMomentum const& {
+        return particles[k].GetFourMomentum();
+      },
+      rng);
+}
+
+void EventPool::Push(EventView const& event, Rng& rng) {
+  fRows.clear();
+  for (int i = 0; i < event.Size(); i++) {
+    if (event.IsFinal(i)) fRows.push_back(i);
+  }
+  PushParticles(
+      fRows.size(), [&](int k) { return event.GetType(fRows[k]); },
+      [&](int k) { return event.GetFourMomentum(fRows[k]); }, rng);
+}
+
+template <class Type, class Momentum>
+void EventPool::PushParticles(int nParticles, Type type, Momentum momentum,
+                              Rng& rng) {
+  const int n = std::min(nParticles, fCapacity);
+  fKept.resize(nParticles);
+  std::iota(fKept.begin(), fKept.end(), 0);
+  if (n < nParticles) {
+    // the decay daughters follow the primaries, so the first particles would
+    // not be a fair sample: partial Fisher-Yates shuffle instead
+    fNTruncated++;
+    for (int k = 0; k < n; k++) {
+      const int left = nParticles - k;
+      const int pick =
+          k + std::min(left - 1, static_cast<int>(rng.Rndm() * left));
+      std::swap(fKept[k], fKept[pick]);
+    }
+  }
+  const int slot = fNext;
+  int* buckets = fBuckets.data() + slot * (fNTypes + 1);
+  // stable counting sort by type straight into the slot
+  std::fill(buckets, buckets + fNTypes + 1, 0);
+  for (int k = 0; k < n; k++) {
+    buckets[type(fKept[k]) + 1]++;
+  }
+  for (int t = 0; t < fNTypes; t++) {
+    buckets[t + 1] += buckets[t];
+  }
+  std::copy(buckets, buckets + fNTypes, fCursors.begin());
+  const long base = static_cast<long>(slot) * fCapacity;
+  for (int k = 0; k < n; k++) {
+    FourMomentum const& p = momentum(fKept[k]);
+    const long j = base + fCursors[type(fKept[k])]++;
+    fPx[j] = p.fPx;
+    fPy[j] = p.fPy;
+    fPz[j] = p.fPz;
+    fE[j] = p.fE;
+    fM2[j] = p.fM2;
+  }
+  fNext = (fNext + 1) % fDepth;
+  fSize = std::min(fSize + 1, fDepth);
+}
+
+EventMixer::EventMixer(PairCategoryTable const& categories,
+                       std::vector<HistoAccumulator*> const& categoryHistos)
+    : fNTypes{categories.GetNTypes()},
+      fPairHistos{resolvePairHistos(categories, categoryHistos)},
+      fCuts{categories.GetCuts()} {
+}
+
+long EventMixer::Fill(std::vector<Particle> const& particles, EventPool& pool,
+                      Rng& rng) {
+  bucketByType(particles, fNTypes, fBatch, fBuckets);
+  const long nPairs = Mix(pool);
+  pool.Push(particles, rng);
+  return nPairs;
+}
+
+long EventMixer::Fill(EventView const& event, EventPool& pool, Rng& rng) {
+  bucketByType(event, fNTypes, fBatch, fBuckets);
+  const long nPairs = Mix(pool);
+  pool.Push(event, rng);
+  return nPairs;
+}
+
+long EventMixer::Mix(EventPool const& pool) {
+  fInvMasses.resize(pool.GetCapacity());
+  fSelected.resize(pool.GetCapacity());
+  long nPairs = 0;
+  // one pooled event at a time, so that its arrays stay in cache while all
+  // the particles of the new event go through them
+  for (int slot = 0; slot < pool.Size(); slot++) {
+    const int* buckets = pool.Buckets(slot);
+    for (int aType = 0; aType < fNTypes; aType++) {
+      for (int i = fBuckets[aType]; i < fBuckets[aType + 1]; i++) {
+        const FourMomentum a = fBatch.GetFourMomentum(i);
+        // only the type slices that fill some histogram are computed
+        for (int bType = 0; bType < fNTypes; bType++) {
+          auto const& histos = fPairHistos[aType * fNTypes + bType];
+          const int begin = buckets[bType];
+          const int end = buckets[bType + 1];
+          if (histos.empty() || begin >= end) continue;
+          invMassAgainst(a, pool.Px(slot) + begin, pool.Py(slot) + begin,
+                         pool.Pz(slot) + begin, pool.E(slot) + begin,
+                         pool.M2(slot) + begin, end - begin,
+                         fInvMasses.data());
+          fillPairHistos(histos, fCuts, a, pool.Px(slot) + begin,
+                         pool.Py(slot) + begin, pool.Pz(slot) + begin,
+                         fInvMasses.data(), end - begin, fSelected.data());
+          nPairs += end - begin;
+        }
+      }
+    }
+  }
+  return nPairs;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vector>
+
+#include "histo_accumulator.hpp"
+#include "pair_categories.hpp"
+#include "particle.hpp"
+#include "pair_filler.hpp"
+#include "particle_batch.hpp"
+#include "rng.hpp"
+
+// memory taken by every particle kept in an EventPool: momentum, energy and
+// squared mass, the type is implied by the bucket the particle is stored in
+const long POOL_PARTICLE_BYTES = 5 * sizeof(double);
+
+// Ring buffer of the last events, used as partners of the new events in
+// event mixing. The memory is allocated once: every slot holds up to
+// GetCapacity() particles sorted by type, as arrays of px, py, pz, E and
+// squared mass.
+// Events with more particles keep GetCapacity() of them drawn uniformly.
+class EventPool {
+ private:
+  int fDepth;
+  int fNTypes;
+  int fCapacity;
+  std::vector<double> fPx, fPy, fPz, fE, fM2;
+  // type bucket offsets of every slot, fNTypes + 1 per slot
+  std::vector<int> fBuckets;
+  // next free row of every type while an event is stored
+  std::vector<int> fCursors;
+  int fSize;
+  int fNext;
+  long fNTruncated;
+  // final state rows of the event being pushed from an event file
+  std::vector<int> fRows;
+  // particles of the event being pushed that are stored
+  std::vector<int> fKept;
+
+  // stores the n particles whose types and four-momenta are type(k) and
+  // momentum(k), rng draws the ones kept if they do not fit
+  template <class Type, class Momentum>
+  void PushParticles(int n, Type type, Momentum momentum, Rng& rng);
+
+ public:
+  // keeps the last depth events in memoryBytes bytes, throws
+  // std::invalid_argument if not even one particle per event fits
+  EventPool(int depth, int nTypes, long memoryBytes);
+  int GetDepth() const;
+  int GetCapacity() const;
+  // number of events in the pool, up to GetDepth()
+  int Size() const;
+  // number of events stored without some of their particles
+  long GetNTruncated() const;
+  void Clear();
+  // stores an event in place of the oldest one when the pool is full. rng
+  // is the mixing stream of the event, used only if it does not fit.
+  void Push(std::vector<Particle> const& particles, Rng& rng);
+  // same for the final state particles of an event of an event file
+  void Push(EventView const& event, Rng& rng);
+
+  const double* Px(int slot) const {
+    return fPx.data() + static_cast<long>(slot) * fCapacity;
+  }
+  const double* Py(int slot) const {
+    return fPy.data() + static_cast<long>(slot) * fCapacity;
+  }
+  const double* Pz(int slot) const {
+    return fPz.data() + static_cast<long>(slot) * fCapacity;
+  }
+  const double* E(int slot) const {
+    return fE.data() + static_cast<long>(slot) * fCapacity;
+  }
+  const double* M2(int slot) const {
+    return fM2.data() + static_cast<long>(slot) * fCapacity;
+  }
+  // the particles of type t of slot are in [Buckets(slot)[t],
+  // Buckets(slot)[t + 1])
+  const int* Buckets(int slot) const {
+    return fBuckets.data() + slot * (fNTypes + 1);
+  }
+};
+
+// Fills the invariant mass of every particle of an event paired with every
+// particle of the events in a pool, i.e. the uncorrelated (mixed-event)
+// background of the same-event distributions filled by PairFiller.
+class EventMixer {
+ private:
+  int fNTypes;
+  std::vector<std::vector<PairHisto>> fPairHistos;
+  std::vector<PairCuts> fCuts;
+  ParticleBatch fBatch;
+  std::vector<int> fBuckets;
+  std::vector<double> fInvMasses, fSelected;
+
+  // mixes the event sorted into fBatch and fBuckets with the pool
+  long Mix(EventPool const& pool);
+
+ public:
+  // categoryHistos[c] is filled by the pairs whose category has bit c set,
+  // null entries are not filled
+  EventMixer(PairCategoryTable const& categories,
+             std::vector<HistoAccumulator*> const& categoryHistos);
+  // mixes the event with the pool, then adds it to the pool with rng as
+  // EventPool::Push; returns the number of pairs filled
+  long Fill(std::vector<Particle> const& particles, EventPool& pool,
+            Rng& rng);
+  // same for the final state particles of an event of an event file
+  long Fill(EventView const& event, EventPool& pool, Rng& rng);
+};
@@ -0,0 +1,77 @@
+#include "event_replay.hpp"
+
+#include <cmath>
+
+#include "event_simulation.hpp"
+#include "four_momentum.hpp"
+#include "pair_filler.hpp"
+
+const double PI2 = 2 * M_PI;
+
+void replayEvent(EventView const& event, int nParticles,
+                 SimulationAccumulators& accumulators) {
+  accumulators.CountEvent(nParticles);
+  for (int i = 0; i < event.Size(); i++) {
+    if (event.GetParent(i) < 0) {
+      // primary, fill the same quantities as the simulation
+      const double px = event.GetPx(i), py = event.GetPy(i),
+                   pz = event.GetPz(i);
+      const double pulse = std::sqrt(px * px + py * py + pz * pz);
+      double phi = std::atan2(py, px);
+      if (phi < 0) phi += PI2;
+      accumulators.particleTypesHisto.Fill(event.GetType(i));
+      accumulators.zenithDist.Fill(pulse > 0 ? std::acos(pz / pulse) : 0.);
+      accumulators.azimuthDist.Fill(phi);
+      accumulators.pulseDist.Fill(pulse);
+      accumulators.traversePulseDist.Fill(std::hypot(px, py));
+      accumulators.particleEnergyDist.Fill(event.GetFourMomentum(i).fE);
+    } else if (i > 0 && event.GetParent(i - 1) == event.GetParent(i)) {
+      // second daughter of a decay: the daughters of a decay are next to
+      // each other, and the first one may have decayed in turn
+      accumulators.invMassSibDecayDist.Fill(
+          invMass(event.GetFourMomentum(i), event.GetFourMomentum(i - 1)));
+    }
+  }
+}
+
+void replayEvents(EventStoreReader const& reader, int firstBlock,
+                  int lastBlock, PairCategoryTable const& categories,
+                  EventPool* pool, SimulationHistos& histos) {
+  SimulationAccumulators accumulators(histos);
+  PairFiller pairs(categories, accumulators.invMassDist,
+                   accumulators.PairCategoryHistos());
+  EventMixer mixer(categories,
+                   {&accumulators.invMassMixedDiscordantDist, nullptr,
+                    &accumulators.invMassMixedPioneKaoneDiscordantDist,
+                    nullptr});
+  // the pair loops read the final state straight from the mapped columns
+  for (int b = firstBlock; b < lastBlock; b++) {
+    for (int e = 0; e < reader.NEvents(b); e++) {
+      const EventView event = reader.GetEvent(b, e);
+      replayEvent(event, reader.GetNParticles(), accumulators);
+      pairs.Fill(event);
+      if (pool) {
+        // the stream of the event in the simulation that wrote the file
+        Rng mixRng(reader.GetSeed(), event.GetNumber(), MIX_STREAM);
+        mixer.Fill(event, *pool, mixRng);
+      }
+    }
+  }
+  accumulators.FlushInto(histos);
+}
+
+std::vector<int> splitBlocks(EventStoreReader const& reader, int nParts) {
+  const long total = reader.GetNEvents();
+  std::vector<int> bounds{0};
+  long events = 0;
+  for (int b = 0; b < reader.NBlocks(); b++) {
+    // range p ends at the first block that reaches its share of events
+    events += reader.NEvents(b);
+    while ((int)bounds.size() < nParts &&
+           events >= total * (long)bounds.size() / nParts) {
+      bounds.push_back(b + 1);
+    }
+  }
+  bounds.resize(nParts + 1, reader.NBlocks());
+  return bounds;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <vector>
+
+#include "event_mixing.hpp"
+#include "event_store.hpp"
+#include "pair_categories.hpp"
+#include "simulation_histos.hpp"
+
+// Fills the single particle accumulators with the primaries of an event read
+// from an event file and the decay siblings accumulator with the daughters of
+// every decay, as the simulation filled them. The values are computed from
+// the columns of the event, without building particles. nParticles is the
+// multiplicity of the run, counted in the events accumulator.
+void replayEvent(EventView const& event, int nParticles,
+                 SimulationAccumulators& accumulators);
+
+// Replays the events of blocks [firstBlock, lastBlock) of reader into
+// histos: single particles and siblings with replayEvent, the pairs with a
+// PairFiller and, if pool is not null, the mixed pairs with an EventMixer.
+// Ranges of blocks are independent and can be replayed on different threads.
+void replayEvents(EventStoreReader const& reader, int firstBlock,
+                  int lastBlock, PairCategoryTable const& categories,
+                  EventPool* pool, SimulationHistos& histos);
+
+// Splits the blocks of reader into nParts consecutive ranges with about the
+// same number of events: range p is [bounds[p], bounds[p + 1])
+std::vector<int> splitBlocks(EventStoreReader const& reader, int nParts);
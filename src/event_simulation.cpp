@@ -0,0 +1,182 @@
+#include "event_simulation.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "constants.hpp"
+#include "decay_arena.hpp"
+#include "four_momentum.hpp"
+#include "kinematics.hpp"
+#include "pair_filler.hpp"
+#include "particle.hpp"
+#include "rng.hpp"
+
+void simulateEvents(int firstEvent, int lastEvent, uint64_t seed,
+                    ParticleIds const& ids, int nParticles,
+                    PairCategoryTable const& categories,
+                    PairLoopOptions const& pairOptions,
+                    SimulationHistos& histos, StageTimers& timers,
+                    EventStoreWriter* store, EventPool* pool,
+                    std::atomic<int>& completed,
+                    std::function<void(int)> const& onFlush) {
+  timers.Start();
+  SimulationAccumulators accumulators(histos);
+  PairFiller pairs(categories, accumulators.invMassDist,
+                   accumulators.PairCategoryHistos(), pairOptions);
+  EventMixer mixer(categories,
+                   {&accumulators.invMassMixedDiscordantDist, nullptr,
+                    &accumulators.invMassMixedPioneKaoneDiscordantDist,
+                    nullptr});
+
+  // events are generated in chunks so that the resonances of a whole chunk
+  // are decayed together
+  std::vector<std::vector<Particle>> chunkParticles(DECAY_CHUNK_EVENTS);
+  std::vector<Rng> decayRngs;
+  decayRngs.reserve(DECAY_CHUNK_EVENTS);
+  std::vector<int> nPrimaries(DECAY_CHUNK_EVENTS);
+  ParticleTable const& table = Particle::GetParticleTable();
+  DecayArena arena;
+  CascadeDecayer decayer;
+  // event file row of every arena node
+  std::vector<int> rows;
+  EventBlock block;
+  block.Clear(firstEvent);
+  KinematicsBatch kinematics;
+  std::vector<TypeId> eventTypes;
+  // first kinematics row of every event of the chunk, and one past the last
+  std::vector<int> eventRows(DECAY_CHUNK_EVENTS + 1);
+  // single particle quantities of the chunk, filled all at once
+  std::vector<double> types;
+  std::vector<double> siblingMasses;
+  int sinceFlush = 0;
+  for (int chunkFirst = firstEvent; chunkFirst < lastEvent;
+       chunkFirst += DECAY_CHUNK_EVENTS) {
+    const int chunkSize = std::min(DECAY_CHUNK_EVENTS, lastEvent - chunkFirst);
+    decayRngs.clear();
+    arena.Clear();
+    kinematics.Clear();
+    siblingMasses.clear();
+
+    for (int e = 0; e < chunkSize; e++) {
+      const int event = chunkFirst + e;
+      Rng typeRng(seed, event, TYPE_STREAM);
+      Rng rng(seed, event, KINEMATICS_STREAM);
+      decayRngs.emplace_back(seed, event, DECAY_STREAM);
+      // resonances count as their two daughters
+      eventTypes.clear();
+      int eventSize = 0;
+      while (eventSize <= nParticles) {
+        const TypeId type = determineParticleType(ids, typeRng);
+        eventTypes.push_back(type);
+        eventSize += table.IsUnstable(type) ? 2 : 1;
+      }
+      eventRows[e] = kinematics.Size();
+      kinematics.Add(rng, eventTypes.data(), eventTypes.size());
+    }
+    eventRows[chunkSize] = kinematics.Size();
+    kinematics.Generate(table);
+
+    for (int e = 0; e < chunkSize; e++) {
+      auto& eventParticles = chunkParticles[e];
+      for (int i = eventRows[e]; i < eventRows[e + 1]; i++) {
+        Particle particle(kinematics.Type()[i], kinematics.GetFourMomentum(i));
+        // unstable particles go to the arena to be decayed
+        if (table.IsUnstable(particle.GetParticleType())) {
+          arena.Add(particle, e, -1);
+        } else {
+          eventParticles.push_back(particle);
+        }
+      }
+      nPrimaries[e] = eventParticles.size();
+    }
+    timers.Lap(GENERATION);
+
+    // decay every resonance of the chunk, and their products, at once
+    decayer.Decay(arena, decayRngs.data(), siblingMasses);
+    arena.SortByEvent(chunkSize);
+    for (int e = 0; e < chunkSize; e++) {
+      auto& eventParticles = chunkParticles[e];
+      for (int k = arena.EventBegin(e); k < arena.EventEnd(e); k++) {
+        Particle const& particle = arena.Get(arena.Node(k));
+        if (!table.IsUnstable(particle.GetParticleType())) {
+          eventParticles.push_back(particle);
+        }
+      }
+    }
+    timers.Lap(DECAY);
+
+    if (store) {
+      // stable primaries first, then the arena nodes of the event, so the
+      // final state rows keep the order of eventParticles
+      rows.resize(arena.Size());
+      for (int e = 0; e < chunkSize; e++) {
+        auto const& eventParticles = chunkParticles[e];
+        block.BeginEvent();
+        for (int i = 0; i < nPrimaries[e]; i++) {
+          block.Add(eventParticles[i], -1, true);
+        }
+        for (int k = arena.EventBegin(e); k < arena.EventEnd(e); k++) {
+          const int node = arena.Node(k);
+          Particle const& particle = arena.Get(node);
+          const int parent = arena.GetParent(node);
+          rows[node] =
+              block.Add(particle, parent < 0 ? -1 : rows[parent],
+                        !table.IsUnstable(particle.GetParticleType()));
+        }
+      }
+      if (block.NParticles() >= EVENT_BLOCK_PARTICLES) {
+        store->Write(block);
+        block.Clear(chunkFirst + chunkSize);
+      }
+      timers.Lap(FILE_WRITE);
+    }
+
+    const int nKinematics = kinematics.Size();
+    types.assign(kinematics.Type(), kinematics.Type() + nKinematics);
+    accumulators.particleTypesHisto.FillN(nKinematics, types.data());
+    accumulators.zenithDist.FillN(nKinematics, kinematics.Theta());
+    accumulators.azimuthDist.FillN(nKinematics, kinematics.Phi());
+    accumulators.pulseDist.FillN(nKinematics, kinematics.Pulse());
+    accumulators.traversePulseDist.FillN(nKinematics,
+                                         kinematics.TraversePulse());
+    accumulators.particleEnergyDist.FillN(nKinematics, kinematics.E());
+    accumulators.invMassSibDecayDist.FillN(siblingMasses.size(),
+                                           siblingMasses.data());
+    for (int e = 0; e < chunkSize; e++) accumulators.CountEvent(nParticles);
+    timers.Lap(HISTO_FILL);
+
+    for (int e = 0; e < chunkSize; e++) {
+      auto const& eventParticles = chunkParticles[e];
+      const long n = eventParticles.size();
+      Rng pairRng(seed, chunkFirst + e, PAIR_STREAM);
+      timers.AddEvent(n * (n - 1) / 2, pairs.Fill(eventParticles, &pairRng));
+    }
+    timers.Lap(PAIR_LOOP);
+
+    if (pool) {
+      for (int e = 0; e < chunkSize; e++) {
+        Rng mixRng(seed, chunkFirst + e, MIX_STREAM);
+        mixer.Fill(chunkParticles[e], *pool, mixRng);
+      }
+      timers.Lap(EVENT_MIXING);
+    }
+    for (int e = 0; e < chunkSize; e++) {
+      chunkParticles[e].clear();
+    }
+    completed.fetch_add(chunkSize, std::memory_order_relaxed);
+
+    sinceFlush += chunkSize;
+    if (sinceFlush >= FLUSH_EVENTS) {
+      accumulators.FlushInto(histos);
+      sinceFlush = 0;
+      timers.Lap(HISTO_FILL);
+      if (onFlush) onFlush(chunkFirst + chunkSize);
+    }
+  }
+  accumulators.FlushInto(histos);
+  timers.Lap(HISTO_FILL);
+  if (store) {
+    store->Write(block);
+    timers.Lap(FILE_WRITE);
+  }
+}
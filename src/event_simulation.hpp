@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+#include "event_mixing.hpp"
+#include "event_store.hpp"
+#include "instrumentation.hpp"
+#include "pair_categories.hpp"
+#include "pair_filler.hpp"
+#include "particle_catalogue.hpp"
+#include "simulation_histos.hpp"
+
+// events after which workers flush their accumulators into the histograms
+const int FLUSH_EVENTS = 1000;
+// events whose resonances are decayed together
+const int DECAY_CHUNK_EVENTS = 64;
+
+// independent random streams of every event
+enum RandomStream : uint32_t {
+  KINEMATICS_STREAM,
+  DECAY_STREAM,
+  TYPE_STREAM,
+  PAIR_STREAM,
+  MIX_STREAM
+};
+
+// Generates the events in [firstEvent, lastEvent) of the run identified by
+// seed, of about nParticles particles each, and fills histos with them. The
+// pairs are filled by a PairFiller with pairOptions. The time spent in each
+// stage is added to timers and completed is incremented once per event. If
+// store is not null the particles of every event are also written to it. If
+// pool is not null every event is mixed with the events in the pool and then
+// added to it. The pool is left with the last events, so that the next call
+// of the same worker can carry on mixing with them. onFlush, if set, is
+// called with the first event not simulated yet every time histos holds all
+// the events simulated so far.
+void simulateEvents(int firstEvent, int lastEvent, uint64_t seed,
+                    ParticleIds const& ids, int nParticles,
+                    PairCategoryTable const& categories,
+                    PairLoopOptions const& pairOptions,
+                    SimulationHistos& histos, StageTimers& timers,
+                    EventStoreWriter* store, EventPool* pool,
+                    std::atomic<int>& completed,
+                    std::function<void(int)> const& onFlush = {});
@@ -0,0 +1,259 @@
+#include "event_store.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#include "util.hpp"
+
+const char EVENT_STORE_MAGIC[8] = {'E', 'V', 'S', 'T', 'O', 'R', 'E', '\0'};
+
+// columns are padded so that every one starts at a multiple of 8 bytes
+static size_t padded(size_t bytes) {
+  return (bytes + 7) & ~size_t(7);
+}
+
+// checks the columns of a block before they are used in place: the events
+// must cover the rows in order, the types index the table and every parent
+// is an earlier row of the same event
+static bool isValidBlock(const uint32_t* offsets, const int32_t* type,
+                         const int32_t* parent, size_t nEvents, size_t n,
+                         int nTypes) {
+  if (offsets[0] != 0 || offsets[nEvents] != n) {
+    return false;
+  }
+  for (size_t e = 0; e < nEvents; e++) {
+    const uint32_t first = offsets[e], last = offsets[e + 1];
+    if (last < first || last > n) {
+      return false;
+    }
+    for (uint32_t i = first; i < last; i++) {
+      const int32_t row = i - first;
+      if (type[i] < 0 || type[i] >= nTypes || parent[i] < -1 ||
+          parent[i] >= row) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void EventBlock::Clear(uint64_t firstEvent) {
+  fFirstEvent = firstEvent;
+  fOffsets.assign(1, 0);
+  fType.clear();
+  fParent.clear();
+  fFinal.clear();
+  fPx.clear();
+  fPy.clear();
+  fPz.clear();
+}
+
+void EventBlock::BeginEvent() {
+  if (fOffsets.empty()) {
+    fOffsets.push_back(0);
+  }
+  fOffsets.push_back(fOffsets.back());
+}
+
+int EventBlock::Add(Particle const& particle, int parent, bool final) {
+  FourMomentum const& p = particle.GetFourMomentum();
+  fType.push_back(particle.GetParticleType());
+  fParent.push_back(parent);
+  fFinal.push_back(final);
+  fPx.push_back(p.fPx);
+  fPy.push_back(p.fPy);
+  fPz.push_back(p.fPz);
+  const int row = fOffsets.back() - fOffsets[fOffsets.size() - 2];
+  fOffsets.back()++;
+  return row;
+}
+
+int EventBlock::NEvents() const {
+  return fOffsets.empty() ? 0 : fOffsets.size() - 1;
+}
+
+int EventBlock::NParticles() const {
+  return fType.size();
+}
+
+EventStoreWriter::EventStoreWriter(std::string const& path, int nTypes,
+                                   int nParticles, uint64_t seed)
+    : fFile{std::fopen(path.c_str(), "wb")}, fFailed{false} {
+  if (!fFile) {
+    throw std::runtime_error("Unable to open " + path + " file");
+  }
+  EventStoreHeader header{};
+  std::memcpy(header.fMagic, EVENT_STORE_MAGIC, sizeof header.fMagic);
+  header.fVersion = EVENT_STORE_VERSION;
+  header.fNTypes = nTypes;
+  header.fNParticles = nParticles;
+  header.fSeed = seed;
+  if (std::fwrite(&header, sizeof header, 1, fFile) != 1) {
+    std::fclose(fFile);
+    throw std::runtime_error("Unable to write " + path + " file");
+  }
+}
+
+EventStoreWriter::~EventStoreWriter() {
+  Close();
+}
+
+bool EventStoreWriter::Close() {
+  std::lock_guard<std::mutex> lock(fMutex);
+  if (fFile) {
+    if (std::fclose(fFile) != 0) fFailed = true;
+    fFile = nullptr;
+  }
+  return !fFailed;
+}
+
+void EventStoreWriter::Write(EventBlock const& block) {
+  if (block.NEvents() == 0) {
+    return;
+  }
+  static const char zeros[8] = {};
+  const EventBlockHeader header{block.fFirstEvent,
+                                static_cast<uint32_t>(block.NEvents()),
+                                static_cast<uint32_t>(block.NParticles())};
+  auto writeColumn = [this](const void* data, size_t bytes) {
+    const size_t padding = padded(bytes) - bytes;
+    return std::fwrite(data, 1, bytes, fFile) == bytes &&
+           std::fwrite(zeros, 1, padding, fFile) == padding;
+  };
+  const size_t n = block.NParticles();
+  std::lock_guard<std::mutex> lock(fMutex);
+  if (fFailed || !fFile) {
+    fFailed = true;
+    return;
+  }
+  fFailed =
+      std::fwrite(&header, sizeof header, 1, fFile) != 1 ||
+      !writeColumn(block.fOffsets.data(),
+                   block.fOffsets.size() * sizeof(uint32_t)) ||
+      !writeColumn(block.fType.data(), n * sizeof(int32_t)) ||
+      !writeColumn(block.fParent.data(), n * sizeof(int32_t)) ||
+      !writeColumn(block.fFinal.data(), n * sizeof(uint8_t)) ||
+      !writeColumn(block.fPx.data(), n * sizeof(double)) ||
+      !writeColumn(block.fPy.data(), n * sizeof(double)) ||
+      !writeColumn(block.fPz.data(), n * sizeof(double));
+}
+
+EventStoreReader::EventStoreReader(std::string const& path)
+    : fData{nullptr}, fSize{0}, fHeader{nullptr}, fNEvents{0} {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Unable to open " + path + " file");
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(EventStoreHeader)) {
+    close(fd);
+    throw std::runtime_error(path + " is not an event file");
+  }
+  fSize = info.st_size;
+  fData = mmap(nullptr, fSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (fData == MAP_FAILED) {
+    fData = nullptr;
+    throw std::runtime_error("Unable to map " + path + " file");
+  }
+  // events are read front to back
+  madvise(fData, fSize, MADV_SEQUENTIAL);
+
+  // the mapping is released before any error is thrown
+  auto fail = [&](std::string const& message) {
+    munmap(fData, fSize);
+    fData = nullptr;
+    throw std::runtime_error(path + message);
+  };
+  const char* begin = static_cast<const char*>(fData);
+  fHeader = reinterpret_cast<EventStoreHeader const*>(begin);
+  if (std::memcmp(fHeader->fMagic, EVENT_STORE_MAGIC, 8) != 0 ||
+      fHeader->fVersion != EVENT_STORE_VERSION) {
+    fail(" is not an event file");
+  }
+
+  // index the blocks, the columns are used in place once validated
+  size_t pos = sizeof(EventStoreHeader);
+  while (pos < fSize) {
+    Block block;
+    if (pos + sizeof(EventBlockHeader) > fSize) {
+      fail(" is truncated");
+    }
+    block.fHeader = reinterpret_cast<EventBlockHeader const*>(begin + pos);
+    const size_t nEvents = block.fHeader->fNEvents;
+    const size_t n = block.fHeader->fNParticles;
+    const size_t blockSize = sizeof(EventBlockHeader) +
+                             padded((nEvents + 1) * sizeof(uint32_t)) +
+                             2 * padded(n * sizeof(int32_t)) + padded(n) +
+                             3 * n * sizeof(double);
+    if (blockSize > fSize - pos) {
+      fail(" is truncated");
+    }
+    pos += sizeof(EventBlockHeader);
+    block.fOffsets = reinterpret_cast<const uint32_t*>(begin + pos);
+    pos += padded((nEvents + 1) * sizeof(uint32_t));
+    block.fType = reinterpret_cast<const int32_t*>(begin + pos);
+    pos += padded(n * sizeof(int32_t));
+    block.fParent = reinterpret_cast<const int32_t*>(begin + pos);
+    pos += padded(n * sizeof(int32_t));
+    block.fFinal = reinterpret_cast<const uint8_t*>(begin + pos);
+    pos += padded(n);
+    block.fPx = reinterpret_cast<const double*>(begin + pos);
+    pos += n * sizeof(double);
+    block.fPy = reinterpret_cast<const double*>(begin + pos);
+    pos += n * sizeof(double);
+    block.fPz = reinterpret_cast<const double*>(begin + pos);
+    pos += n * sizeof(double);
+    if (!isValidBlock(block.fOffsets, block.fType, block.fParent, nEvents, n,
+                      fHeader->fNTypes)) {
+      fail(concat(" has an invalid block at event ",
+                  block.fHeader->fFirstEvent));
+    }
+    fBlocks.push_back(block);
+    fNEvents += nEvents;
+  }
+}
+
+EventStoreReader::~EventStoreReader() {
+  if (fData) {
+    munmap(fData, fSize);
+  }
+}
+
+int EventStoreReader::GetNTypes() const {
+  return fHeader->fNTypes;
+}
+
+int EventStoreReader::GetNParticles() const {
+  return fHeader->fNParticles;
+}
+
+uint64_t EventStoreReader::GetSeed() const {
+  return fHeader->fSeed;
+}
+
+long EventStoreReader::GetNEvents() const {
+  return fNEvents;
+}
+
+int EventStoreReader::NBlocks() const {
+  return fBlocks.size();
+}
+
+int EventStoreReader::NEvents(int block) const {
+  return fBlocks[block].fHeader->fNEvents;
+}
+
+EventView EventStoreReader::GetEvent(int block, int event) const {
+  Block const& b = fBlocks[block];
+  const uint32_t first = b.fOffsets[event];
+  const int size = b.fOffsets[event + 1] - first;
+  return EventView(b.fHeader->fFirstEvent + event, size, b.fType + first,
+                   b.fParent + first, b.fFinal + first, b.fPx + first,
+                   b.fPy + first, b.fPz + first);
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "four_momentum.hpp"
+#include "particle.hpp"
+
+// Columnar event file. After a file header the file is a sequence of blocks,
+// each holding consecutive events of one worker:
+//
+//   header  { uint64 firstEvent; uint32 nEvents; uint32 nParticles; }
+//   uint32  offsets[nEvents + 1]   first particle of every event
+//   int32   type[nParticles]
+//   int32   parent[nParticles]     row of the decayed mother, -1 if primary
+//   uint8   final[nParticles]      1 if part of the final state
+//   double  px[nParticles], py[nParticles], pz[nParticles]
+//
+// every column starts at a multiple of 8 bytes. Decayed resonances are kept
+// as rows with final = 0, their daughters follow them.
+struct EventStoreHeader {
+  char fMagic[8];
+  uint32_t fVersion;
+  // number of particle types of the run, type ids index the particle table
+  uint32_t fNTypes;
+  // particles of every event the run was configured with (--particles)
+  uint32_t fNParticles;
+  // seed of the run, the random streams of the events depend on it
+  uint64_t fSeed;
+};
+
+struct EventBlockHeader {
+  uint64_t fFirstEvent;
+  uint32_t fNEvents;
+  uint32_t fNParticles;
+};
+
+const uint32_t EVENT_STORE_VERSION = 3;
+// particles after which a worker writes its block
+const int EVENT_BLOCK_PARTICLES = 1 << 18;
+
+// Events of one worker being collected before they are written as a block
+class EventBlock {
+ private:
+  uint64_t fFirstEvent = 0;
+  std::vector<uint32_t> fOffsets;
+  std::vector<int32_t> fType, fParent;
+  std::vector<uint8_t> fFinal;
+  std::vector<double> fPx, fPy, fPz;
+
+  friend class EventStoreWriter;
+
+ public:
+  // starts a new block whose first event is firstEvent
+  void Clear(uint64_t firstEvent);
+  void BeginEvent();
+  // returns the row of the particle inside the current event
+  int Add(Particle const& particle, int parent, bool final);
+  int NEvents() const;
+  int NParticles() const;
+};
+
+// Appends blocks to an event file. Write can be called by several threads.
+// A failed write is remembered, the later ones are skipped, and Close
+// reports it: the file is complete only if Close returns true.
+class EventStoreWriter {
+ private:
+  std::FILE* fFile;
+  std::mutex fMutex;
+  bool fFailed;
+
+ public:
+  // throws std::runtime_error if path cannot be opened or written
+  EventStoreWriter(std::string const& path, int nTypes, int nParticles,
+                   uint64_t seed);
+  ~EventStoreWriter();
+  EventStoreWriter(EventStoreWriter const&) = delete;
+  EventStoreWriter& operator=(EventStoreWriter const&) = delete;
+  void Write(EventBlock const& block);
+  // closes the file, returns false if any write or the close failed
+  bool Close();
+};
+
+// Event inside a memory-mapped file, its columns point to the mapping
+class EventView {
+ private:
+  uint64_t fNumber;
+  int fSize;
+  const int32_t *fType, *fParent;
+  const uint8_t* fFinal;
+  const double *fPx, *fPy, *fPz;
+
+ public:
+  EventView(uint64_t number, int size, const int32_t* type,
+            const int32_t* parent, const uint8_t* final, const double* px,
+            const double* py, const double* pz)
+      : fNumber{number},
+        fSize{size},
+        fType{type},
+        fParent{parent},
+        fFinal{final},
+        fPx{px},
+        fPy{py},
+        fPz{pz} {
+  }
+  uint64_t GetNumber() const {
+    return fNumber;
+  }
+  int Size() const {
+    return fSize;
+  }
+  TypeId GetType(int i) const {
+    return fType[i];
+  }
+  int GetParent(int i) const {
+    return fParent[i];
+  }
+  bool IsFinal(int i) const {
+    return fFinal[i];
+  }
+  double GetPx(int i) const {
+    return fPx[i];
+  }
+  double GetPy(int i) const {
+    return fPy[i];
+  }
+  double GetPz(int i) const {
+    return fPz[i];
+  }
+  // the energy comes from the mass of the type, like in Particle
+  FourMomentum GetFourMomentum(int i) const {
+    return makeFourMomentum(fPx[i], fPy[i], fPz[i],
+                            Particle::GetParticleTable()[fType[i]].fMass2);
+  }
+};
+
+// Maps an event file into memory and gives access to its events without
+// copying them
+class EventStoreReader {
+ private:
+  struct Block {
+    EventBlockHeader const* fHeader;
+    const uint32_t* fOffsets;
+    const int32_t *fType, *fParent;
+    const uint8_t* fFinal;
+    const double *fPx, *fPy, *fPz;
+  };
+  void* fData;
+  size_t fSize;
+  EventStoreHeader const* fHeader;
+  std::vector<Block> fBlocks;
+  long fNEvents;
+
+ public:
+  // throws std::runtime_error if path cannot be mapped or is not valid
+  explicit EventStoreReader(std::string const& path);
+  ~EventStoreReader();
+  EventStoreReader(EventStoreReader const&) = delete;
+  EventStoreReader& operator=(EventStoreReader const&) = delete;
+  int GetNTypes() const;
+  // particles of every event the run was configured with
+  int GetNParticles() const;
+  uint64_t GetSeed() const;
+  long GetNEvents() const;
+  int NBlocks() const;
+  int NEvents(int block) const;
+  EventView GetEvent(int block, int event) const;
+};
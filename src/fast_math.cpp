@@ -0,0 +1,171 @@
+#include "fast_math.hpp"
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+using namespace fast_math_detail;
+
+#if defined(__AVX512F__)
+const int64_t SIGN_BIT = INT64_MIN;
+// the unmasked getexp and getmant of gcc 12 warn about their undefined source
+const __mmask8 ALL_LANES = 0xFF;
+
+// vector version of series
+static inline __m512d horner8(__m512d x2, const double* c, int n) {
+  __m512d s = _mm512_set1_pd(c[0]);
+  for (int i = 1; i < n; i++) {
+    s = _mm512_fmadd_pd(s, x2, _mm512_set1_pd(c[i]));
+  }
+  return _mm512_mul_pd(s, x2);
+}
+#elif defined(__AVX2__)
+// bits of 2^52: or-ed with an integer below 2^52 it gives 2^52 + integer
+const int64_t TWO52_BITS = 0x4330000000000000ll;
+const double TWO52_PLUS_BIAS = 4503599627370496. + 1023.;
+const int64_t MANTISSA_MASK = 0x000FFFFFFFFFFFFFll;
+const int64_t ONE_BITS = 0x3FF0000000000000ll;
+
+static inline __m256d madd4(__m256d a, __m256d b, __m256d c) {
+#if defined(__FMA__)
+  return _mm256_fmadd_pd(a, b, c);
+#else
+  return _mm256_add_pd(_mm256_mul_pd(a, b), c);
+#endif
+}
+
+static inline __m256d horner4(__m256d x2, const double* c, int n) {
+  __m256d s = _mm256_set1_pd(c[0]);
+  for (int i = 1; i < n; i++) {
+    s = madd4(s, x2, _mm256_set1_pd(c[i]));
+  }
+  return _mm256_mul_pd(s, x2);
+}
+#endif
+
+void fastLogN(const double* x, int n, double* out) {
+  int i = 0;
+
+#if defined(__AVX512F__)
+  for (; i + 8 <= n; i += 8) {
+    const __m512d xi = _mm512_loadu_pd(x + i);
+    __m512d k = _mm512_mask_getexp_pd(xi, ALL_LANES, xi);
+    __m512d m = _mm512_mask_getmant_pd(xi, ALL_LANES, xi, _MM_MANT_NORM_1_2,
+                                       _MM_MANT_SIGN_src);
+    const __mmask8 high =
+        _mm512_cmp_pd_mask(m, _mm512_set1_pd(SQRT2), _CMP_GT_OQ);
+    m = _mm512_mask_mul_pd(m, high, m, _mm512_set1_pd(0.5));
+    k = _mm512_mask_add_pd(k, high, k, _mm512_set1_pd(1.));
+    const __m512d f = _mm512_sub_pd(m, _mm512_set1_pd(1.));
+    const __m512d s = _mm512_div_pd(f, _mm512_add_pd(_mm512_set1_pd(2.), f));
+    const __m512d hfsq =
+        _mm512_mul_pd(_mm512_set1_pd(0.5), _mm512_mul_pd(f, f));
+    const __m512d r =
+        horner8(_mm512_mul_pd(s, s), LOG_COEFFICIENTS, N_LOG_COEFFICIENTS);
+    // k LN2_HI - ((hfsq - (s (hfsq + r) + k LN2_LO)) - f)
+    const __m512d tail =
+        _mm512_fmadd_pd(s, _mm512_add_pd(hfsq, r),
+                        _mm512_mul_pd(k, _mm512_set1_pd(LN2_LO)));
+    const __m512d log = _mm512_fmsub_pd(
+        k, _mm512_set1_pd(LN2_HI), _mm512_sub_pd(_mm512_sub_pd(hfsq, tail), f));
+    _mm512_storeu_pd(out + i, log);
+  }
+#elif defined(__AVX2__)
+  for (; i + 4 <= n; i += 4) {
+    const __m256i b = _mm256_castpd_si256(_mm256_loadu_pd(x + i));
+    const __m256i e = _mm256_or_si256(_mm256_srli_epi64(b, 52),
+                                      _mm256_set1_epi64x(TWO52_BITS));
+    __m256d k = _mm256_sub_pd(_mm256_castsi256_pd(e),
+                              _mm256_set1_pd(TWO52_PLUS_BIAS));
+    __m256d m = _mm256_castsi256_pd(_mm256_or_si256(
+        _mm256_and_si256(b, _mm256_set1_epi64x(MANTISSA_MASK)),
+        _mm256_set1_epi64x(ONE_BITS)));
+    const __m256d high = _mm256_cmp_pd(m, _mm256_set1_pd(SQRT2), _CMP_GT_OQ);
+    m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), high);
+    k = _mm256_add_pd(k, _mm256_and_pd(high, _mm256_set1_pd(1.)));
+    const __m256d f = _mm256_sub_pd(m, _mm256_set1_pd(1.));
+    const __m256d s = _mm256_div_pd(f, _mm256_add_pd(_mm256_set1_pd(2.), f));
+    const __m256d hfsq =
+        _mm256_mul_pd(_mm256_set1_pd(0.5), _mm256_mul_pd(f, f));
+    const __m256d r =
+        horner4(_mm256_mul_pd(s, s), LOG_COEFFICIENTS, N_LOG_COEFFICIENTS);
+    const __m256d tail = madd4(s, _mm256_add_pd(hfsq, r),
+                               _mm256_mul_pd(k, _mm256_set1_pd(LN2_LO)));
+    const __m256d log = _mm256_sub_pd(
+        _mm256_mul_pd(k, _mm256_set1_pd(LN2_HI)),
+        _mm256_sub_pd(_mm256_sub_pd(hfsq, tail), f));
+    _mm256_storeu_pd(out + i, log);
+  }
+#endif
+
+  // scalar fallback and remainder
+  for (; i < n; i++) {
+    out[i] = fastLog(x[i]);
+  }
+}
+
+void fastSinCosN(const double* x, int n, double* s, double* c) {
+  int i = 0;
+
+#if defined(__AVX512F__)
+  for (; i + 8 <= n; i += 8) {
+    const __m512d xi = _mm512_loadu_pd(x + i);
+    const __m512d t = _mm512_fmadd_pd(xi, _mm512_set1_pd(TWO_OVER_PI),
+                                      _mm512_set1_pd(ROUND_MAGIC));
+    const __m512i quadrant = _mm512_castpd_si512(t);
+    const __m512d q = _mm512_sub_pd(t, _mm512_set1_pd(ROUND_MAGIC));
+    __m512d r = _mm512_fnmadd_pd(q, _mm512_set1_pd(PIO2_HI), xi);
+    r = _mm512_fnmadd_pd(q, _mm512_set1_pd(PIO2_LO), r);
+    const __m512d r2 = _mm512_mul_pd(r, r);
+    const __m512d sr = _mm512_fmadd_pd(
+        r, horner8(r2, SIN_COEFFICIENTS, N_SIN_COEFFICIENTS), r);
+    const __m512d cr = _mm512_add_pd(
+        _mm512_set1_pd(1.), horner8(r2, COS_COEFFICIENTS, N_COS_COEFFICIENTS));
+    // rotate by quadrant * pi / 2, signs flipped through the sign bit
+    const __mmask8 swap =
+        _mm512_test_epi64_mask(quadrant, _mm512_set1_epi64(1));
+    const __m512i two = _mm512_set1_epi64(2);
+    const __mmask8 sinFlip = _mm512_test_epi64_mask(quadrant, two);
+    const __mmask8 cosFlip = _mm512_test_epi64_mask(
+        _mm512_add_epi64(quadrant, _mm512_set1_epi64(1)), two);
+    const __m512i sign = _mm512_set1_epi64(SIGN_BIT);
+    __m512i si = _mm512_castpd_si512(_mm512_mask_blend_pd(swap, sr, cr));
+    __m512i ci = _mm512_castpd_si512(_mm512_mask_blend_pd(swap, cr, sr));
+    si = _mm512_mask_xor_epi64(si, sinFlip, si, sign);
+    ci = _mm512_mask_xor_epi64(ci, cosFlip, ci, sign);
+    _mm512_storeu_pd(s + i, _mm512_castsi512_pd(si));
+    _mm512_storeu_pd(c + i, _mm512_castsi512_pd(ci));
+  }
+#elif defined(__AVX2__)
+  for (; i + 4 <= n; i += 4) {
+    const __m256d xi = _mm256_loadu_pd(x + i);
+    const __m256d t = madd4(xi, _mm256_set1_pd(TWO_OVER_PI),
+                            _mm256_set1_pd(ROUND_MAGIC));
+    const __m256i quadrant = _mm256_castpd_si256(t);
+    const __m256d q = _mm256_sub_pd(t, _mm256_set1_pd(ROUND_MAGIC));
+    __m256d r = _mm256_sub_pd(xi, _mm256_mul_pd(q, _mm256_set1_pd(PIO2_HI)));
+    r = _mm256_sub_pd(r, _mm256_mul_pd(q, _mm256_set1_pd(PIO2_LO)));
+    const __m256d r2 = _mm256_mul_pd(r, r);
+    const __m256d sr =
+        madd4(r, horner4(r2, SIN_COEFFICIENTS, N_SIN_COEFFICIENTS), r);
+    const __m256d cr = _mm256_add_pd(
+        _mm256_set1_pd(1.), horner4(r2, COS_COEFFICIENTS, N_COS_COEFFICIENTS));
+    const __m256i one = _mm256_set1_epi64x(1), two = _mm256_set1_epi64x(2);
+    const __m256d swap = _mm256_castsi256_pd(
+        _mm256_cmpeq_epi64(_mm256_and_si256(quadrant, one), one));
+    const __m256i sinSign =
+        _mm256_slli_epi64(_mm256_and_si256(quadrant, two), 62);
+    const __m256i cosSign = _mm256_slli_epi64(
+        _mm256_and_si256(_mm256_add_epi64(quadrant, one), two), 62);
+    _mm256_storeu_pd(s + i, _mm256_xor_pd(_mm256_blendv_pd(sr, cr, swap),
+                                          _mm256_castsi256_pd(sinSign)));
+    _mm256_storeu_pd(c + i, _mm256_xor_pd(_mm256_blendv_pd(cr, sr, swap),
+                                          _mm256_castsi256_pd(cosSign)));
+  }
+#endif
+
+  // scalar fallback and remainder
+  for (; i < n; i++) {
+    fastSinCos(x[i], s[i], c[i]);
+  }
+}
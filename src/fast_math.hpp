@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Branch-free logarithm and sine/cosine for whole arrays. The array versions
+// use AVX-512 or AVX2 when the compiler targets them; the scalar functions
+// below run the same algorithm, for the remainders and other targets.
+//
+// Accuracy, checked against libm in test.cpp:
+// - fastLog: relative error below 4e-16 (2 ulp) for positive normal x
+// - fastSinCos: absolute error below 4e-16 for |x| <= 2^20, which covers the
+//   angles of the simulation by far
+
+namespace fast_math_detail {
+
+const double LN2_HI = 6.93147180369123816490e-01;
+const double LN2_LO = 1.90821492927058770002e-10;
+const double SQRT2 = 1.41421356237309504880;
+// pi / 2 split in a 33 bit head and a tail, so that q * PIO2_HI is exact
+const double PIO2_HI = 1.57079632673412561417e+00;
+const double PIO2_LO = 6.07710050650619224932e-11;
+const double TWO_OVER_PI = 6.36619772367581382433e-01;
+// adding it rounds to an integer that sits in the low mantissa bits
+const double ROUND_MAGIC = 6755399441055744.0;  // 1.5 * 2^52
+
+// Coefficients of the series below, highest order first:
+// 2 atanh(s) / s - 2 = sum of 2 s^2k / (2k + 1) for k = 1..9,
+// sin(r) / r - 1 and cos(r) - 1 are Taylor series for |r| <= pi / 4
+const double LOG_COEFFICIENTS[] = {2. / 19., 2. / 17., 2. / 15.,
+                                   2. / 13., 2. / 11., 2. / 9.,
+                                   2. / 7.,  2. / 5.,  2. / 3.};
+const double SIN_COEFFICIENTS[] = {
+    -1. / 1307674368000., 1. / 6227020800., -1. / 39916800., 1. / 362880.,
+    -1. / 5040.,          1. / 120.,        -1. / 6.};
+const double COS_COEFFICIENTS[] = {
+    1. / 20922789888000., -1. / 87178291200., 1. / 479001600.,
+    -1. / 3628800.,       1. / 40320.,        -1. / 720.,
+    1. / 24.,             -1. / 2.};
+const int N_LOG_COEFFICIENTS = 9;
+const int N_SIN_COEFFICIENTS = 7;
+const int N_COS_COEFFICIENTS = 8;
+
+// x2 (c[0] x2^(n-1) + ... + c[n-1]) by Horner's rule
+inline double series(double x2, const double* c, int n) {
+  double s = c[0];
+  for (int i = 1; i < n; i++) {
+    s = s * x2 + c[i];
+  }
+  return s * x2;
+}
+
+inline uint64_t bits(double x) {
+  uint64_t b;
+  std::memcpy(&b, &x, sizeof b);
+  return b;
+}
+
+inline double fromBits(uint64_t b) {
+  double x;
+  std::memcpy(&x, &b, sizeof x);
+  return x;
+}
+
+}  // namespace fast_math_detail
+
+// x = m 2^k with m in [sqrt(1/2), sqrt(2)), then log(m) = 2 atanh(s) with
+// s = (m - 1) / (m + 1), arranged as in fdlibm to keep the error small
+inline double fastLog(double x) {
+  using namespace fast_math_detail;
+  const uint64_t b = bits(x);
+  double k = static_cast<double>(static_cast<int>(b >> 52) - 1023);
+  double m = fromBits((b & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull);
+  if (m > SQRT2) {
+    m *= 0.5;
+    k += 1.;
+  }
+  const double f = m - 1.;
+  const double s = f / (2. + f);
+  const double hfsq = 0.5 * f * f;
+  const double r = series(s * s, LOG_COEFFICIENTS, N_LOG_COEFFICIENTS);
+  return k * LN2_HI - ((hfsq - (s * (hfsq + r) + k * LN2_LO)) - f);
+}
+
+inline void fastSinCos(double x, double& s, double& c) {
+  using namespace fast_math_detail;
+  const double t = x * TWO_OVER_PI + ROUND_MAGIC;
+  const uint64_t quadrant = bits(t);
+  const double q = t - ROUND_MAGIC;
+  const double r = (x - q * PIO2_HI) - q * PIO2_LO;
+  const double r2 = r * r;
+  const double sr = r + r * series(r2, SIN_COEFFICIENTS, N_SIN_COEFFICIENTS);
+  const double cr = 1. + series(r2, COS_COEFFICIENTS, N_COS_COEFFICIENTS);
+  // rotate by quadrant * pi / 2
+  const bool swap = quadrant & 1;
+  s = swap ? cr : sr;
+  c = swap ? sr : cr;
+  if (quadrant & 2) s = -s;
+  if ((quadrant + 1) & 2) c = -c;
+}
+
+// out[i] = log(x[i]), x in place is allowed
+void fastLogN(const double* x, int n, double* out);
+// s[i] = sin(x[i]), c[i] = cos(x[i])
+void fastSinCosN(const double* x, int n, double* s, double* c);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cmath>
+
+// Four-momentum of a particle together with its squared mass. It is filled
+// once, when the particle is created or decayed, so that pair quantities never
+// have to recompute energies.
+struct FourMomentum {
+  double fE;
+  double fPx, fPy, fPz;
+  double fM2;
+};
+
+inline FourMomentum makeFourMomentum(double px, double py, double pz,
+                                     double m2) {
+  return {std::sqrt(m2 + px * px + py * py + pz * pz), px, py, pz, m2};
+}
+
+// (p1 + p2)^2 = m1^2 + m2^2 + 2 (E1 E2 - p1.p2)
+inline double invMass2(FourMomentum const& a, FourMomentum const& b) {
+  return a.fM2 + b.fM2 +
+         2. * (a.fE * b.fE - a.fPx * b.fPx - a.fPy * b.fPy - a.fPz * b.fPz);
+}
+
+inline double invMass(FourMomentum const& a, FourMomentum const& b) {
+  return std::sqrt(invMass2(a, b));
+}
@@ -0,0 +1,77 @@
+#include "histo_accumulator.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+HistoAccumulator::HistoAccumulator(int nBins, double xMin, double xMax)
+    : fNBins{nBins},
+      fXMin{xMin},
+      fXMax{xMax},
+      fSumw(nBins + 2, 0.),
+      fSumw2(nBins + 2, 0.),
+      fEntries{0.},
+      fTsumw{0.},
+      fTsumw2{0.},
+      fTsumwx{0.},
+      fTsumwx2{0.} {
+  if (nBins <= 0) {
+    throw std::invalid_argument("number of bins must be positive");
+  }
+  if (xMax <= xMin) {
+    throw std::invalid_argument("xMax must be greater than xMin");
+  }
+}
+
+void HistoAccumulator::FillN(int n, const double* xs) {
+  for (int i = 0; i < n; i++) {
+    Fill(xs[i], 1.);
+  }
+}
+
+void HistoAccumulator::FillN(int n, const double* xs, const double* ws) {
+  for (int i = 0; i < n; i++) {
+    Fill(xs[i], ws[i]);
+  }
+}
+
+void HistoAccumulator::FillN(int n, const double* xs, double w) {
+  for (int i = 0; i < n; i++) {
+    Fill(xs[i], w);
+  }
+}
+
+void HistoAccumulator::Add(HistoAccumulator const& other) {
+  if (other.fNBins != fNBins || other.fXMin != fXMin || other.fXMax != fXMax) {
+    throw std::invalid_argument("cannot add accumulators with different bins");
+  }
+  for (int bin = 0; bin <= fNBins + 1; bin++) {
+    fSumw[bin] += other.fSumw[bin];
+    fSumw2[bin] += other.fSumw2[bin];
+  }
+  fEntries += other.fEntries;
+  fTsumw += other.fTsumw;
+  fTsumw2 += other.fTsumw2;
+  fTsumwx += other.fTsumwx;
+  fTsumwx2 += other.fTsumwx2;
+}
+
+void HistoAccumulator::Reset() {
+  std::fill(fSumw.begin(), fSumw.end(), 0.);
+  std::fill(fSumw2.begin(), fSumw2.end(), 0.);
+  fEntries = fTsumw = fTsumw2 = fTsumwx = fTsumwx2 = 0.;
+}
+
+double HistoAccumulator::GetEntries() const {
+  return fEntries;
+}
+
+double HistoAccumulator::GetBinContent(int bin) const {
+  return fSumw[bin];
+}
+
+bool HistoAccumulator::IsWeighted() const {
+  for (int bin = 0; bin <= fNBins + 1; bin++) {
+    if (fSumw2[bin] != fSumw[bin]) return true;
+  }
+  return false;
+}
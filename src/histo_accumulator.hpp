@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+
+// Lightweight uniform-binning histogram: plain arrays of sums of weights and
+// sums of squared weights, including underflow (bin 0) and overflow (bin
+// nBins + 1) like ROOT does. Filling is a bin computation and two additions,
+// the contents are flushed into a real histogram with FlushInto.
+class HistoAccumulator {
+ private:
+  int fNBins;
+  double fXMin, fXMax;
+  std::vector<double> fSumw, fSumw2;
+  double fEntries;
+  // in-range statistics, same meaning as TH1::GetStats
+  double fTsumw, fTsumw2, fTsumwx, fTsumwx2;
+
+ public:
+  HistoAccumulator(int nBins, double xMin, double xMax);
+  // builds an accumulator with the same binning of a TH1
+  template <class H>
+  explicit HistoAccumulator(H const& histo)
+      : HistoAccumulator(histo.GetXaxis()->GetNbins(),
+                         histo.GetXaxis()->GetXmin(),
+                         histo.GetXaxis()->GetXmax()) {
+  }
+
+  int FindBin(double x) const {
+    // same expression as TAxis::FindFixBin so bins match exactly
+    if (x < fXMin) return 0;
+    if (!(x < fXMax)) return fNBins + 1;
+    return 1 + int(fNBins * (x - fXMin) / (fXMax - fXMin));
+  }
+
+  void Fill(double x) {
+    Fill(x, 1.);
+  }
+
+  void Fill(double x, double w) {
+    const int bin = FindBin(x);
+    fSumw[bin] += w;
+    fSumw2[bin] += w * w;
+    fEntries++;
+    if (bin > 0 && bin <= fNBins) {
+      fTsumw += w;
+      fTsumw2 += w * w;
+      fTsumwx += w * x;
+      fTsumwx2 += w * x * x;
+    }
+  }
+
+  void FillN(int n, const double* xs);
+  void FillN(int n, const double* xs, const double* ws);
+  // fills the n values xs all with the same weight w
+  void FillN(int n, const double* xs, double w);
+  void Add(HistoAccumulator const& other);
+  void Reset();
+  double GetEntries() const;
+  double GetBinContent(int bin) const;
+  bool IsWeighted() const;
+
+  // Adds the accumulated contents, errors, entries and statistics to histo,
+  // then resets the accumulator. histo must have the same binning.
+  template <class H>
+  void FlushInto(H& histo) {
+    if (fEntries == 0) {
+      return;
+    }
+    // statistics must be read before touching the bins, since setting
+    // contents invalidates them
+    double stats[4];
+    histo.GetStats(stats);
+    const double entries = histo.GetEntries();
+    bool hasSumw2 = histo.GetSumw2N() > 0;
+    if (!hasSumw2 && IsWeighted()) {
+      // same as TH1::Fill with a weight different from one
+      histo.Sumw2();
+      hasSumw2 = true;
+    }
+    for (int bin = 0; bin <= fNBins + 1; bin++) {
+      if (fSumw[bin] == 0. && fSumw2[bin] == 0.) continue;
+      histo.SetBinContent(bin, histo.GetBinContent(bin) + fSumw[bin]);
+      if (hasSumw2) {
+        (*histo.GetSumw2())[bin] += fSumw2[bin];
+      }
+    }
+    stats[0] += fTsumw;
+    stats[1] += fTsumw2;
+    stats[2] += fTsumwx;
+    stats[3] += fTsumwx2;
+    histo.PutStats(stats);
+    histo.SetEntries(entries + fEntries);
+    Reset();
+  }
+};
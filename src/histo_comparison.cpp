@@ -0,0 +1,102 @@
+#include "histo_comparison.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+#include "rng.hpp"
+
+static double total(int n, const double* contents) {
+  double sum = 0.;
+  for (int i = 0; i < n; i++) {
+    sum += contents[i];
+  }
+  return sum;
+}
+
+double kolmogorovDistance(int n, const double* a, const double* b) {
+  const double totalA = total(n, a), totalB = total(n, b);
+  if (totalA <= 0. || totalB <= 0.) return totalA == totalB ? 0. : 1.;
+  double cumulativeA = 0., cumulativeB = 0., distance = 0.;
+  for (int i = 0; i < n; i++) {
+    cumulativeA += a[i];
+    cumulativeB += b[i];
+    distance = std::max(
+        distance, std::abs(cumulativeA / totalA - cumulativeB / totalB));
+  }
+  return distance;
+}
+
+double chi2Homogeneity(int n, const double* a, const double* b, int& ndf) {
+  const double totalA = total(n, a), totalB = total(n, b);
+  ndf = 0;
+  if (totalA <= 0. || totalB <= 0.) return 0.;
+  double chi2 = 0.;
+  int nBins = 0;
+  for (int i = 0; i < n; i++) {
+    const double sum = a[i] + b[i];
+    if (sum <= 0.) continue;
+    const double diff = totalB * a[i] - totalA * b[i];
+    chi2 += diff * diff / sum;
+    nBins++;
+  }
+  ndf = std::max(nBins - 1, 0);
+  return chi2 / (totalA * totalB);
+}
+
+BatchComparison compareBatches(int nBatches, int n, const double* a,
+                               const double* b, int nPermutations,
+                               uint64_t seed) {
+  // batches of both runs one after the other
+  std::vector<const double*> batches;
+  std::vector<double> sum(n, 0.);
+  for (const double* run : {a, b}) {
+    for (int k = 0; k < nBatches; k++) {
+      batches.push_back(run + k * n);
+      for (int i = 0; i < n; i++) {
+        sum[i] += run[k * n + i];
+      }
+    }
+  }
+  std::vector<int> order(2 * nBatches);
+  std::iota(order.begin(), order.end(), 0);
+  std::vector<double> first(n), second(n);
+  // statistics of the runs made of the batches in order
+  auto compare = [&](double& distance, double& chi2, int& ndf) {
+    std::fill(first.begin(), first.end(), 0.);
+    for (int k = 0; k < nBatches; k++) {
+      const double* batch = batches[order[k]];
+      for (int i = 0; i < n; i++) {
+        first[i] += batch[i];
+      }
+    }
+    for (int i = 0; i < n; i++) {
+      second[i] = sum[i] - first[i];
+    }
+    distance = kolmogorovDistance(n, first.data(), second.data());
+    chi2 = chi2Homogeneity(n, first.data(), second.data(), ndf);
+  };
+
+  BatchComparison result;
+  compare(result.fDistance, result.fChi2, result.fNdf);
+  // the observed statistics count as one of the permutations
+  int nLargerDistance = 1, nLargerChi2 = 1;
+  Rng rng(seed, 0);
+  for (int p = 0; p < nPermutations; p++) {
+    // the first nBatches of a Fisher-Yates shuffle
+    for (int k = 0; k < nBatches; k++) {
+      const int other = k + static_cast<int>(rng.Rndm() * (2 * nBatches - k));
+      std::swap(order[k], order[other]);
+    }
+    double distance, chi2;
+    int ndf;
+    compare(distance, chi2, ndf);
+    nLargerDistance += distance >= result.fDistance;
+    nLargerChi2 += chi2 >= result.fChi2;
+  }
+  result.fKolmogorovP = static_cast<double>(nLargerDistance) /
+                        (nPermutations + 1);
+  result.fChi2P = static_cast<double>(nLargerChi2) / (nPermutations + 1);
+  return result;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+
+// Statistics comparing two histograms of n bins, under and overflow
+// included, as unweighted counts:
+// - the Kolmogorov-Smirnov distance, the largest difference between their
+//   normalized cumulative distributions, like TH1::KolmogorovTest
+// - the chi-squared of homogeneity, like TH1::Chi2Test with option "UU";
+//   bins empty in both are skipped and ndf is the number of the others
+//   minus one
+double kolmogorovDistance(int n, const double* a, const double* b);
+double chi2Homogeneity(int n, const double* a, const double* b, int& ndf);
+
+struct BatchComparison {
+  double fDistance;
+  double fKolmogorovP;
+  double fChi2;
+  int fNdf;
+  double fChi2P;
+};
+
+// Compares two runs split in nBatches batches of events each, whose
+// histograms are a[k * n + i] and b[k * n + i] for batch k, with the
+// statistics above of the sums of the batches. The entries of a batch may
+// be correlated, like the pairs of the same event, so the asymptotic
+// p-values of the statistics do not hold. The p-values are instead the
+// fraction of nPermutations random reassignments of the 2 nBatches batches
+// to the two runs whose statistics are at least as large: this only needs
+// the batches to be independent and alike if the runs are.
+BatchComparison compareBatches(int nBatches, int n, const double* a,
+                               const double* b, int nPermutations,
+                               uint64_t seed);
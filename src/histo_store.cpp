@@ -0,0 +1,56 @@
+#include "histo_store.hpp"
+
+#include <TKey.h>
+#include <TList.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+HistoStore::HistoStore(TFile& file) : fFile{file} {
+  if (!file.IsOpen()) {
+    throw std::runtime_error(std::string("Unable to open ") +
+                             file.GetName() + " file");
+  }
+  // a name written more than once has one key per cycle
+  TIter next(file.GetListOfKeys());
+  while (TKey* key = static_cast<TKey*>(next())) {
+    if (std::strcmp(key->GetClassName(), "TH1D") == 0 &&
+        fEntries.emplace(key->GetName(), Entry{}).second) {
+      fNames.push_back(key->GetName());
+    }
+  }
+}
+
+std::vector<std::string> const& HistoStore::Names() const {
+  return fNames;
+}
+
+bool HistoStore::Has(std::string const& name) const {
+  return fEntries.count(name) > 0;
+}
+
+TH1D* HistoStore::Find(std::string const& name) {
+  auto it = fEntries.find(name);
+  if (it == fEntries.end()) return nullptr;
+  Entry& entry = it->second;
+  if (!entry.fLoaded) {
+    entry.fHisto = fFile.Get<TH1D>(name.c_str());
+    entry.fLoaded = true;
+  }
+  return entry.fHisto;
+}
+
+TH1D* HistoStore::Get(std::string const& name) {
+  TH1D* histo = Find(name);
+  if (!histo) {
+    throw std::runtime_error(std::string(fFile.GetName()) + " has no " +
+                             name + " histogram");
+  }
+  return histo;
+}
+
+int HistoStore::NLoaded() const {
+  return std::count_if(fEntries.begin(), fEntries.end(),
+                       [](auto const& entry) { return entry.second.fLoaded; });
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <TFile.h>
+#include <TH1D.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Histograms of a file, looked up by name and read from the file only the
+// first time they are asked for. The names come from the keys of the file,
+// so the histograms of configured pair categories are found like the
+// built-in ones. Histograms stay owned by the file.
+class HistoStore {
+ private:
+  struct Entry {
+    TH1D* fHisto = nullptr;
+    bool fLoaded = false;
+  };
+  TFile& fFile;
+  // names of the TH1D keys, in file order
+  std::vector<std::string> fNames;
+  std::unordered_map<std::string, Entry> fEntries;
+
+ public:
+  // throws if the file is not open
+  explicit HistoStore(TFile& file);
+  std::vector<std::string> const& Names() const;
+  bool Has(std::string const& name) const;
+  // null if the file has no histogram with that name
+  TH1D* Find(std::string const& name);
+  // throws if the file has no histogram with that name
+  TH1D* Get(std::string const& name);
+  // histograms read so far
+  int NLoaded() const;
+};
@@ -0,0 +1,120 @@
+#include "instrumentation.hpp"
+
+#include <sys/resource.h>
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+
+#include "table.hpp"
+
+const char* stageName(Stage stage) {
+  switch (stage) {
+    case GENERATION:
+      return "generation";
+    case DECAY:
+      return "decay";
+    case PAIR_LOOP:
+      return "pair-loop";
+    case EVENT_MIXING:
+      return "event-mixing";
+    case HISTO_FILL:
+      return "histo-fill";
+    case FILE_WRITE:
+      return "file-write";
+    default:
+      return "unknown";
+  }
+}
+
+void StageTimers::Add(StageTimers const& other) {
+  for (int s = 0; s < N_STAGES; s++) {
+    fSeconds[s] += other.fSeconds[s];
+  }
+  fEvents += other.fEvents;
+  fPairs += other.fPairs;
+  fSampledPairs += other.fSampledPairs;
+}
+
+double StageTimers::GetSeconds(Stage stage) const {
+  return fSeconds[stage];
+}
+
+long StageTimers::GetEvents() const {
+  return fEvents;
+}
+
+long StageTimers::GetPairs() const {
+  return fPairs;
+}
+
+long StageTimers::GetSampledPairs() const {
+  return fSampledPairs;
+}
+
+long peakRssKb() {
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return -1;
+  }
+  // ru_maxrss is in kB on Linux
+  return usage.ru_maxrss;
+}
+
+void printReport(StageTimers const& timers, double wallSeconds, int nThreads) {
+  std::cout << "Threads: " << nThreads << "\n";
+  std::cout << "Events/s: " << timers.GetEvents() / wallSeconds << "\n";
+  std::cout << "Pairs/s: " << timers.GetPairs() / wallSeconds << "\n";
+  if (timers.GetSampledPairs() < timers.GetPairs()) {
+    std::cout << "Sampled pairs: " << timers.GetSampledPairs() << " of "
+              << timers.GetPairs() << " ("
+              << timers.GetSampledPairs() * 100. / timers.GetPairs()
+              << "%)\n";
+  }
+  std::cout << "Peak RSS: " << peakRssKb() << " kB\n";
+#if SIMULATION_INSTRUMENTATION
+  double total = 0.;
+  for (int s = 0; s < N_STAGES; s++) {
+    total += timers.GetSeconds(Stage(s));
+  }
+  auto table = Table<const char*, double, double>();
+  table.headers({"STAGE", "TIME (s)", "FRACTION (%)"});
+  for (int s = 0; s < N_STAGES; s++) {
+    const double seconds = timers.GetSeconds(Stage(s));
+    table.row(stageName(Stage(s)), seconds,
+              total > 0 ? seconds * 100. / total : 0.);
+  }
+  table.print();
+#else
+  std::cout << "Stage timers disabled at compile time\n";
+#endif
+}
+
+bool writeReportJson(std::string const& path, StageTimers const& timers,
+                     double wallSeconds, int nThreads) {
+  std::ofstream out(path);
+  if (!out) {
+    return false;
+  }
+  out << "{\n";
+  out << "  \"threads\": " << nThreads << ",\n";
+  out << "  \"wall_seconds\": " << wallSeconds << ",\n";
+  out << "  \"events\": " << timers.GetEvents() << ",\n";
+  out << "  \"pairs\": " << timers.GetPairs() << ",\n";
+  out << "  \"sampled_pairs\": " << timers.GetSampledPairs() << ",\n";
+  out << "  \"events_per_second\": " << timers.GetEvents() / wallSeconds
+      << ",\n";
+  out << "  \"pairs_per_second\": " << timers.GetPairs() / wallSeconds
+      << ",\n";
+  out << "  \"peak_rss_kb\": " << peakRssKb();
+#if SIMULATION_INSTRUMENTATION
+  out << ",\n  \"stage_seconds\": {";
+  for (int s = 0; s < N_STAGES; s++) {
+    out << (s > 0 ? ", " : "") << "\"" << stageName(Stage(s))
+        << "\": " << timers.GetSeconds(Stage(s));
+  }
+  out << "}";
+#endif
+  out << "\n}\n";
+  return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <string>
+
+// build with -DSIMULATION_INSTRUMENTATION=0 to compile the stage timers out
+#ifndef SIMULATION_INSTRUMENTATION
+#define SIMULATION_INSTRUMENTATION 1
+#endif
+
+enum Stage {
+  GENERATION,
+  DECAY,
+  PAIR_LOOP,
+  EVENT_MIXING,
+  HISTO_FILL,
+  FILE_WRITE,
+  N_STAGES
+};
+
+const char* stageName(Stage stage);
+
+// Time spent in each stage of the simulation plus event and pair counters:
+// the pairs of the events, and the ones actually filled when they are
+// sampled.
+// Time is sampled once per stage change (Lap charges the time elapsed since
+// the previous Lap or Start to a stage), never per particle or per pair.
+class StageTimers {
+ private:
+  std::array<double, N_STAGES> fSeconds{};
+  long fEvents = 0;
+  long fPairs = 0;
+  long fSampledPairs = 0;
+#if SIMULATION_INSTRUMENTATION
+  std::chrono::steady_clock::time_point fLast;
+#endif
+
+ public:
+  void Start() {
+#if SIMULATION_INSTRUMENTATION
+    fLast = std::chrono::steady_clock::now();
+#endif
+  }
+
+  void Lap([[maybe_unused]] Stage stage) {
+#if SIMULATION_INSTRUMENTATION
+    const auto now = std::chrono::steady_clock::now();
+    fSeconds[stage] += std::chrono::duration<double>(now - fLast).count();
+    fLast = now;
+#endif
+  }
+
+  void AddEvent(long pairs, long sampledPairs) {
+    fEvents++;
+    fPairs += pairs;
+    fSampledPairs += sampledPairs;
+  }
+
+  void Add(StageTimers const& other);
+  double GetSeconds(Stage stage) const;
+  long GetEvents() const;
+  long GetPairs() const;
+  long GetSampledPairs() const;
+};
+
+// peak resident set size of the process in kB
+long peakRssKb();
+
+// Prints events/s, pairs/s, time per stage and peak RSS of a run that took
+// wallSeconds on nThreads threads; stage times are summed over threads
+void printReport(StageTimers const& timers, double wallSeconds, int nThreads);
+bool writeReportJson(std::string const& path, StageTimers const& timers,
+                     double wallSeconds, int nThreads);
@@ -0,0 +1,94 @@
+#include "kinematics.hpp"
+
+#include <cmath>
+
+#include "fast_math.hpp"
+
+KinematicsBatch::KinematicsBatch() : fNGenerated{0} {
+}
+
+void KinematicsBatch::Clear() {
+  fType.clear();
+  fPhi.clear();
+  fTheta.clear();
+  fPulse.clear();
+  fNGenerated = 0;
+}
+
+void KinematicsBatch::Add(Rng& rng, const TypeId* types, int n) {
+  const int begin = Size();
+  fType.insert(fType.end(), types, types + n);
+  fPhi.resize(begin + n);
+  fTheta.resize(begin + n);
+  fPulse.resize(begin + n);
+  rng.Rndm(fPhi.data() + begin, n);
+  rng.Rndm(fTheta.data() + begin, n);
+  rng.Rndm(fPulse.data() + begin, n);
+}
+
+void KinematicsBatch::Generate(ParticleTable const& table) {
+  const int begin = fNGenerated;
+  const int n = Size() - begin;
+  fSinPhi.resize(Size());
+  fCosPhi.resize(Size());
+  fSinTheta.resize(Size());
+  fCosTheta.resize(Size());
+  fPx.resize(Size());
+  fPy.resize(Size());
+  fPz.resize(Size());
+  fTraversePulse.resize(Size());
+  fE.resize(Size());
+  fM2.resize(Size());
+  double* phi = fPhi.data() + begin;
+  double* theta = fTheta.data() + begin;
+  double* pulse = fPulse.data() + begin;
+
+  for (int i = 0; i < n; i++) {
+    phi[i] *= 2. * M_PI;
+    theta[i] *= M_PI;
+    // 1 - u is in (0, 1], so the logarithm is always finite
+    pulse[i] = 1. - pulse[i];
+  }
+  fastLogN(pulse, n, pulse);
+  fastSinCosN(phi, n, fSinPhi.data() + begin, fCosPhi.data() + begin);
+  fastSinCosN(theta, n, fSinTheta.data() + begin, fCosTheta.data() + begin);
+
+  for (int i = begin; i < Size(); i++) {
+    fPulse[i] = -fPulse[i];
+    fM2[i] = table[fType[i]].fMass2;
+    fTraversePulse[i] = fPulse[i] * fSinTheta[i];
+    fPx[i] = fTraversePulse[i] * fCosPhi[i];
+    fPy[i] = fTraversePulse[i] * fSinPhi[i];
+    fPz[i] = fPulse[i] * fCosTheta[i];
+    fE[i] = std::sqrt(fPulse[i] * fPulse[i] + fM2[i]);
+  }
+  fNGenerated = Size();
+}
+
+int KinematicsBatch::Size() const {
+  return fType.size();
+}
+
+const TypeId* KinematicsBatch::Type() const {
+  return fType.data();
+}
+
+const double* KinematicsBatch::Phi() const {
+  return fPhi.data();
+}
+
+const double* KinematicsBatch::Theta() const {
+  return fTheta.data();
+}
+
+const double* KinematicsBatch::Pulse() const {
+  return fPulse.data();
+}
+
+const double* KinematicsBatch::TraversePulse() const {
+  return fTraversePulse.data();
+}
+
+const double* KinematicsBatch::E() const {
+  return fE.data();
+}
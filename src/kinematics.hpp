@@ -0,0 +1,42 @@
+#pragma once
+
+#include <vector>
+
+#include "four_momentum.hpp"
+#include "particle.hpp"
+#include "particle_table.hpp"
+#include "rng.hpp"
+
+// Kinematics of many primary particles at once: phi uniform in [0, 2pi], theta
+// uniform in [0, pi] (so the directions are not isotropic) and momenta
+// exponentially distributed with mean 1. Particles are collected with Add,
+// which draws their random numbers from the stream of their event, then
+// Generate turns all of them into momenta and energies with loops over plain
+// arrays and the vectorized fastLogN and fastSinCosN.
+class KinematicsBatch {
+ private:
+  std::vector<TypeId> fType;
+  // uniform numbers after Add, angles and momentum modulus after Generate
+  std::vector<double> fPhi, fTheta, fPulse;
+  std::vector<double> fSinPhi, fCosPhi, fSinTheta, fCosTheta;
+  std::vector<double> fPx, fPy, fPz, fTraversePulse, fE, fM2;
+  int fNGenerated;
+
+ public:
+  KinematicsBatch();
+  void Clear();
+  // appends n particles of the given types, drawing 3 n numbers from rng
+  void Add(Rng& rng, const TypeId* types, int n);
+  // computes the kinematics of the particles added since the last call
+  void Generate(ParticleTable const& table);
+  int Size() const;
+  const TypeId* Type() const;
+  const double* Phi() const;
+  const double* Theta() const;
+  const double* Pulse() const;
+  const double* TraversePulse() const;
+  const double* E() const;
+  FourMomentum GetFourMomentum(int i) const {
+    return {fE[i], fPx[i], fPy[i], fPz[i], fM2[i]};
+  }
+};
@@ -0,0 +1,233 @@
+#include "least_squares.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+const int MAX_PARAMETERS = 3;
+const int MAX_ITERATIONS = 200;
+
+int nParameters(FitModel model) {
+  switch (model) {
+    case FitModel::POL0:
+      return 1;
+    case FitModel::EXPO:
+      return 2;
+    case FitModel::GAUS:
+      return 3;
+  }
+  return 0;
+}
+
+const char* parameterName(FitModel model, int parameter) {
+  static const char* names[][MAX_PARAMETERS] = {
+      {"p0", "", ""}, {"Constant", "Slope", ""}, {"Constant", "Mean", "Sigma"}};
+  return names[static_cast<int>(model)][parameter];
+}
+
+const char* formulaName(FitModel model) {
+  static const char* names[] = {"pol0", "expo", "gaus"};
+  return names[static_cast<int>(model)];
+}
+
+// value of the model in x, and its derivatives in the parameters if grad is
+// not null
+static double evaluate(FitModel model, const double* p, double x,
+                       double* grad) {
+  switch (model) {
+    case FitModel::POL0:
+      if (grad) grad[0] = 1.;
+      return p[0];
+    case FitModel::EXPO: {
+      const double f = std::exp(p[0] + p[1] * x);
+      if (grad) {
+        grad[0] = f;
+        grad[1] = f * x;
+      }
+      return f;
+    }
+    case FitModel::GAUS: {
+      const double t = (x - p[1]) / p[2];
+      const double g = std::exp(-0.5 * t * t);
+      if (grad) {
+        grad[0] = g;
+        grad[1] = p[0] * g * t / p[2];
+        grad[2] = p[0] * g * t * t / p[2];
+      }
+      return p[0] * g;
+    }
+  }
+  return 0.;
+}
+
+struct Points {
+  std::vector<double> x, y, w;  // w = 1 / e^2
+};
+
+static double chi2(FitModel model, const double* p, Points const& points) {
+  double sum = 0.;
+  for (size_t i = 0; i < points.x.size(); i++) {
+    const double r = points.y[i] - evaluate(model, p, points.x[i], nullptr);
+    sum += points.w[i] * r * r;
+  }
+  return sum;
+}
+
+// solves a x = b in place for a small dense system, false if singular
+static bool solve(int n, double a[MAX_PARAMETERS][MAX_PARAMETERS],
+                  double* b) {
+  for (int c = 0; c < n; c++) {
+    int pivot = c;
+    for (int r = c + 1; r < n; r++) {
+      if (std::abs(a[r][c]) > std::abs(a[pivot][c])) pivot = r;
+    }
+    if (a[pivot][c] == 0.) return false;
+    std::swap(a[c], a[pivot]);
+    std::swap(b[c], b[pivot]);
+    for (int r = c + 1; r < n; r++) {
+      const double f = a[r][c] / a[c][c];
+      for (int k = c; k < n; k++) a[r][k] -= f * a[c][k];
+      b[r] -= f * b[c];
+    }
+  }
+  for (int r = n - 1; r >= 0; r--) {
+    for (int k = r + 1; k < n; k++) b[r] -= a[r][k] * b[k];
+    b[r] /= a[r][r];
+  }
+  return true;
+}
+
+// normal equations J^T W J and J^T W r in p
+static void normalEquations(FitModel model, const double* p,
+                            Points const& points,
+                            double a[MAX_PARAMETERS][MAX_PARAMETERS],
+                            double* b) {
+  const int np = nParameters(model);
+  for (int i = 0; i < np; i++) {
+    b[i] = 0.;
+    for (int j = 0; j < np; j++) a[i][j] = 0.;
+  }
+  double grad[MAX_PARAMETERS];
+  for (size_t k = 0; k < points.x.size(); k++) {
+    const double r = points.y[k] - evaluate(model, p, points.x[k], grad);
+    for (int i = 0; i < np; i++) {
+      b[i] += points.w[k] * grad[i] * r;
+      for (int j = 0; j < np; j++) a[i][j] += points.w[k] * grad[i] * grad[j];
+    }
+  }
+}
+
+static void initialEstimate(FitModel model, Points const& points, double* p) {
+  const size_t n = points.x.size();
+  if (model == FitModel::EXPO) {
+    // weighted straight line through log(y), var(log y) = e^2 / y^2
+    double s = 0., sx = 0., sy = 0., sxx = 0., sxy = 0.;
+    for (size_t i = 0; i < n; i++) {
+      if (points.y[i] <= 0.) continue;
+      const double w = points.w[i] * points.y[i] * points.y[i];
+      const double ly = std::log(points.y[i]);
+      s += w;
+      sx += w * points.x[i];
+      sy += w * ly;
+      sxx += w * points.x[i] * points.x[i];
+      sxy += w * points.x[i] * ly;
+    }
+    const double det = s * sxx - sx * sx;
+    p[1] = det != 0. ? (s * sxy - sx * sy) / det : 0.;
+    p[0] = s != 0. ? (sy - p[1] * sx) / s : 0.;
+  } else if (model == FitModel::GAUS) {
+    // highest point of the data smoothed over a few points, so that a
+    // narrow peak on top of noise is not mistaken for a fluctuation; the
+    // width is where the smoothed data falls below half of the peak
+    const int halfWindow = 2;
+    std::vector<double> smooth(n, 0.);
+    for (size_t i = 0; i < n; i++) {
+      const size_t begin = i >= halfWindow ? i - halfWindow : 0;
+      const size_t end = std::min(n, i + halfWindow + 1);
+      for (size_t j = begin; j < end; j++) smooth[i] += points.y[j];
+      smooth[i] /= end - begin;
+    }
+    const size_t peak = std::max_element(smooth.begin(), smooth.end()) -
+                        smooth.begin();
+    size_t left = peak, right = peak;
+    while (left > 0 && smooth[left] > smooth[peak] / 2.) left--;
+    while (right + 1 < n && smooth[right] > smooth[peak] / 2.) right++;
+    p[0] = smooth[peak];
+    p[1] = points.x[peak];
+    // full width at half maximum is 2.355 sigma
+    p[2] = std::max(points.x[right] - points.x[left], 1e-12) / 2.355;
+  }
+}
+
+FitResult fitLeastSquares(FitModel model, int n, const double* x,
+                          const double* y, const double* e) {
+  const int np = nParameters(model);
+  FitResult result{std::vector<double>(np, 0.), std::vector<double>(np, 0.),
+                   0., 0, false};
+  Points points;
+  for (int i = 0; i < n; i++) {
+    if (e[i] <= 0.) continue;
+    points.x.push_back(x[i]);
+    points.y.push_back(y[i]);
+    points.w.push_back(1. / (e[i] * e[i]));
+  }
+  result.fNdf = static_cast<int>(points.x.size()) - np;
+  if (result.fNdf <= 0) {
+    return result;
+  }
+
+  double p[MAX_PARAMETERS] = {};
+  double a[MAX_PARAMETERS][MAX_PARAMETERS], b[MAX_PARAMETERS];
+  bool converged = false;
+  if (model == FitModel::POL0) {
+    // linear in the parameter, one step from zero is the minimum
+    normalEquations(model, p, points, a, b);
+    converged = solve(np, a, b);
+    p[0] = b[0];
+  } else {
+    initialEstimate(model, points, p);
+    double current = chi2(model, p, points);
+    double lambda = 1e-3;
+    for (int it = 0; it < MAX_ITERATIONS && !converged; it++) {
+      normalEquations(model, p, points, a, b);
+      for (int i = 0; i < np; i++) a[i][i] *= 1. + lambda;
+      if (!solve(np, a, b)) break;
+      double trial[MAX_PARAMETERS];
+      for (int i = 0; i < np; i++) trial[i] = p[i] + b[i];
+      const double next = chi2(model, trial, points);
+      if (std::isfinite(next) && next <= current) {
+        converged = current - next <= 1e-10 * std::max(current, 1.);
+        std::copy(trial, trial + np, p);
+        current = next;
+        lambda = std::max(lambda / 10., 1e-12);
+      } else {
+        lambda *= 10.;
+        // no step reduces chi2 any more, p is the minimum
+        converged = lambda > 1e12;
+      }
+    }
+    if (model == FitModel::GAUS) p[2] = std::abs(p[2]);
+  }
+
+  // parameter errors from the inverse of the curvature matrix
+  normalEquations(model, p, points, a, b);
+  for (int i = 0; i < np; i++) {
+    double column[MAX_PARAMETERS] = {};
+    column[i] = 1.;
+    double copy[MAX_PARAMETERS][MAX_PARAMETERS];
+    std::copy(&a[0][0], &a[0][0] + MAX_PARAMETERS * MAX_PARAMETERS,
+              &copy[0][0]);
+    if (!solve(np, copy, column)) {
+      converged = false;
+      break;
+    }
+    result.fErrors[i] = std::sqrt(std::abs(column[i]));
+  }
+
+  std::copy(p, p + np, result.fParameters.begin());
+  result.fChi2 = chi2(model, p, points);
+  result.fValid = converged && std::isfinite(result.fChi2);
+  for (double parameter : result.fParameters) {
+    result.fValid = result.fValid && std::isfinite(parameter);
+  }
+  return result;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+
+// models with the same parameters as the ROOT formulas of the same name
+enum class FitModel {
+  POL0,  // p0
+  EXPO,  // exp(Constant + Slope * x)
+  GAUS   // Constant * exp(-0.5 * ((x - Mean) / Sigma)^2)
+};
+
+struct FitResult {
+  std::vector<double> fParameters;
+  std::vector<double> fErrors;
+  double fChi2;
+  int fNdf;
+  bool fValid;
+};
+
+int nParameters(FitModel model);
+const char* parameterName(FitModel model, int parameter);
+// ROOT formula of the model
+const char* formulaName(FitModel model);
+
+// Binned chi-squared fit of model to the points (x, y) with errors e. Points
+// with a zero error are skipped, like ROOT does for empty bins. pol0 is
+// solved exactly, expo and gaus start from a linearized estimate and are
+// refined with Levenberg-Marquardt. It does not use ROOT, so any number of
+// fits can run at the same time on different threads.
+FitResult fitLeastSquares(FitModel model, int n, const double* x,
+                          const double* y, const double* e);
@@ -0,0 +1,147 @@
+#include <TFile.h>
+#include <TH1D.h>
+#include <TROOT.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "constants.hpp"
+#include "pair_config.hpp"
+#include "parallel_for.hpp"
+#include "particle_catalogue.hpp"
+#include "simulation_histos.hpp"
+#include "util.hpp"
+
+struct MergeOptions {
+  int nThreads = 1;
+  std::string outputPath = SAVE_FILE;
+  std::string pairConfigPath;
+  std::vector<std::string> inputPaths;
+};
+
+bool parseArgs(int argc, char** argv, MergeOptions& options);
+
+// Adds up the histogram files written by the shards of a run, which must all
+// be given, each once. The files are read in parallel and summed pairwise in
+// a tree whose shape only depends on the number of files, so the result does
+// not change with the threads.
+int main(int argc, char** argv) {
+  MergeOptions options;
+  if (!parseArgs(argc, argv, options)) {
+    std::cout << "Usage: merge [--threads N] [--output FILE] "
+                 "[--pair-config PATH] FILE...\n";
+    std::cout << "  FILE           histograms file written by simulation\n";
+    std::cout << "  --threads N    number of threads, 0 to use all cores "
+                 "(default 1)\n";
+    std::cout << "  --output FILE  merged histograms file (default "
+              << SAVE_FILE << ")\n";
+    std::cout << "  --pair-config PATH  pair categories the simulation was "
+                 "run with\n";
+    return EXIT_FAILURE;
+  }
+  int nThreads = options.nThreads;
+  if (nThreads == 0) {
+    nThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  ROOT::EnableThreadSafety();
+  TH1::AddDirectory(kFALSE);
+  // the particle types histogram has a bin per registered type
+  addParticleTypes();
+  Particle::FreezeParticleTypes();
+  std::vector<PairCategoryConfig> pairCategories;
+  if (!options.pairConfigPath.empty()) {
+    try {
+      pairCategories = readPairConfig(options.pairConfigPath);
+    } catch (std::runtime_error const& error) {
+      std::cout << error.what() << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  section("Merging");
+  const auto start = std::chrono::steady_clock::now();
+  const int nFiles = options.inputPaths.size();
+  std::vector<std::unique_ptr<SimulationHistos>> parts(nFiles);
+  std::vector<ShardInfo> shards(nFiles);
+  std::vector<std::string> errors(nFiles);
+  parallelFor(nFiles, nThreads, [&](int i) {
+    TFile file(options.inputPaths[i].c_str());
+    if (!file.IsOpen()) {
+      errors[i] = "Unable to open " + options.inputPaths[i] + " file";
+      return;
+    }
+    try {
+      shards[i] = readShardInfo(file);
+      parts[i] = std::make_unique<SimulationHistos>(pairCategories);
+      parts[i]->AddFile(file);
+    } catch (std::exception const& error) {
+      errors[i] = error.what();
+    }
+  });
+  for (auto const& error : errors) {
+    if (!error.empty()) {
+      std::cout << error << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+  try {
+    checkShards(shards, options.inputPaths);
+  } catch (std::runtime_error const& error) {
+    std::cout << error.what() << "\n";
+    return EXIT_FAILURE;
+  }
+  // level by level, part i takes in part i + stride
+  for (int stride = 1; stride < nFiles; stride *= 2) {
+    const int nPairs = (nFiles + stride - 1) / (2 * stride);
+    parallelFor(nPairs, nThreads, [&](int pair) {
+      const int i = pair * 2 * stride;
+      parts[i]->Add(*parts[i + stride]);
+      parts[i + stride].reset();
+    });
+  }
+  const double seconds = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+  std::cout << "Merged " << nFiles << " files in " << seconds << "s\n";
+
+  section("Saving to file");
+  TFile saveFile(options.outputPath.c_str(), "RECREATE");
+  if (!saveFile.IsOpen()) {
+    std::cout << "Unable to open " << options.outputPath << " file\n";
+    return EXIT_FAILURE;
+  }
+  parts[0]->Write();
+  // the merged file holds the whole run
+  writeShardInfo({shards[0].fSeed, shards[0].fNEvents, 0, 1});
+  saveFile.Close();
+  std::cout << "Saved to " << options.outputPath << "\n";
+}
+
+bool parseArgs(int argc, char** argv, MergeOptions& options) {
+  try {
+    for (int i = 1; i < argc; i++) {
+      if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+        options.nThreads = std::stoi(argv[++i]);
+        if (options.nThreads < 0) return false;
+      } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+        options.outputPath = argv[++i];
+      } else if (std::strcmp(argv[i], "--pair-config") == 0 && i + 1 < argc) {
+        options.pairConfigPath = argv[++i];
+      } else if (argv[i][0] == '-') {
+        return false;
+      } else {
+        options.inputPaths.push_back(argv[i]);
+      }
+    }
+  } catch (std::exception const&) {
+    return false;
+  }
+  return !options.inputPaths.empty();
+}
@@ -0,0 +1,151 @@
+#include "pair_categories.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+
+// the unmasked sqrt and max of gcc 12 warn about their undefined source
+const __mmask8 ALL_LANES = 0xFF;
+#endif
+
+bool operator==(PairCuts const& a, PairCuts const& b) {
+  return a.fMinPt == b.fMinPt && a.fMaxPt == b.fMaxPt &&
+         a.fMinCos == b.fMinCos && a.fMaxCos == b.fMaxCos;
+}
+
+PairCategoryTable::PairCategoryTable(int nTypes)
+    : fNTypes{nTypes},
+      fMasks(nTypes * nTypes, 0u),
+      fCategoryCuts(MAX_PAIR_CATEGORIES, -1) {
+  if (nTypes <= 0) {
+    throw std::invalid_argument("number of types must be positive");
+  }
+}
+
+int PairCategoryTable::GetNTypes() const {
+  return fNTypes;
+}
+
+void PairCategoryTable::Add(TypeId a, TypeId b, CategoryMask categories) {
+  if (a < 0 || a >= fNTypes || b < 0 || b >= fNTypes) {
+    throw std::invalid_argument("No particle type with specified index\n");
+  }
+  fMasks[a * fNTypes + b] |= categories;
+  fMasks[b * fNTypes + a] |= categories;
+}
+
+void PairCategoryTable::SetCuts(int category, PairCuts const& cuts) {
+  if (category < 0 || category >= MAX_PAIR_CATEGORIES) {
+    throw std::invalid_argument("No pair category with specified index");
+  }
+  auto it = std::find(fCuts.begin(), fCuts.end(), cuts);
+  if (it == fCuts.end()) {
+    it = fCuts.insert(fCuts.end(), cuts);
+  }
+  fCategoryCuts[category] = it - fCuts.begin();
+}
+
+int PairCategoryTable::GetCutsIndex(int category) const {
+  return fCategoryCuts[category];
+}
+
+std::vector<PairCuts> const& PairCategoryTable::GetCuts() const {
+  return fCuts;
+}
+
+int selectPairs(PairCuts const& cuts, FourMomentum const& a, const double* px,
+                const double* py, const double* pz, const double* xs, int n,
+                double* out) {
+  // transverse momenta are compared squared, for a and for its partners
+  const double minPt2 = cuts.fMinPt * cuts.fMinPt;
+  const double maxPt2 = cuts.fMaxPt * cuts.fMaxPt;
+  const double ptA2 = a.fPx * a.fPx + a.fPy * a.fPy;
+  if (!(ptA2 >= minPt2 && ptA2 < maxPt2)) return 0;
+  const double pA = std::sqrt(ptA2 + a.fPz * a.fPz);
+  int j = 0;
+  int k = 0;
+
+#if defined(__AVX512F__)
+  const __m512d minPt2s = _mm512_set1_pd(minPt2);
+  const __m512d maxPt2s = _mm512_set1_pd(maxPt2);
+  const __m512d minCos = _mm512_set1_pd(cuts.fMinCos);
+  const __m512d maxCos = _mm512_set1_pd(cuts.fMaxCos);
+  const __m512d apx = _mm512_set1_pd(a.fPx);
+  const __m512d apy = _mm512_set1_pd(a.fPy);
+  const __m512d apz = _mm512_set1_pd(a.fPz);
+  const __m512d ap = _mm512_set1_pd(pA);
+  const __m512d tiny = _mm512_set1_pd(DBL_MIN);
+  for (; j + 8 <= n; j += 8) {
+    const __m512d bpx = _mm512_loadu_pd(px + j);
+    const __m512d bpy = _mm512_loadu_pd(py + j);
+    const __m512d bpz = _mm512_loadu_pd(pz + j);
+    const __m512d pt2 = _mm512_fmadd_pd(bpx, bpx, _mm512_mul_pd(bpy, bpy));
+    const __m512d p2 = _mm512_fmadd_pd(bpz, bpz, pt2);
+    const __m512d p = _mm512_mask_sqrt_pd(p2, ALL_LANES, p2);
+    const __m512d dot = _mm512_fmadd_pd(
+        apx, bpx, _mm512_fmadd_pd(apy, bpy, _mm512_mul_pd(apz, bpz)));
+    const __m512d norm = _mm512_mul_pd(ap, p);
+    const __m512d cos =
+        _mm512_div_pd(dot, _mm512_mask_max_pd(norm, ALL_LANES, norm, tiny));
+    __mmask8 pass = _mm512_cmp_pd_mask(pt2, minPt2s, _CMP_GE_OQ);
+    pass &= _mm512_cmp_pd_mask(pt2, maxPt2s, _CMP_LT_OQ);
+    pass &= _mm512_cmp_pd_mask(cos, minCos, _CMP_GT_OQ);
+    pass &= _mm512_cmp_pd_mask(cos, maxCos, _CMP_LT_OQ);
+    _mm512_mask_compressstoreu_pd(out + k, pass, _mm512_loadu_pd(xs + j));
+    k += __builtin_popcount(pass);
+  }
+#endif
+
+  // scalar fallback and remainder: always store, advance only on a pass
+  for (; j < n; j++) {
+    const double pt2 = px[j] * px[j] + py[j] * py[j];
+    const double p = std::sqrt(pt2 + pz[j] * pz[j]);
+    const double dot = a.fPx * px[j] + a.fPy * py[j] + a.fPz * pz[j];
+    const double cos = dot / std::max(pA * p, DBL_MIN);
+    const bool pass = (pt2 >= minPt2) & (pt2 < maxPt2) &
+                      (cos > cuts.fMinCos) & (cos < cuts.fMaxCos);
+    out[k] = xs[j];
+    k += pass;
+  }
+  return k;
+}
+
+void bucketByType(std::vector<Particle> const& particles, int nTypes,
+                  ParticleBatch& batch, std::vector<int>& bucketOffsets) {
+  // count particles per type and turn the counts into offsets
+  bucketOffsets.assign(nTypes + 1, 0);
+  for (auto const& particle : particles) {
+    bucketOffsets[particle.GetParticleType() + 1]++;
+  }
+  for (int t = 0; t < nTypes; t++) {
+    bucketOffsets[t + 1] += bucketOffsets[t];
+  }
+
+  // write every particle straight into its bucket
+  batch.Resize(particles.size());
+  std::vector<int> next(bucketOffsets.begin(), bucketOffsets.end() - 1);
+  for (auto const& particle : particles) {
+    batch.Set(next[particle.GetParticleType()]++, particle);
+  }
+}
+
+void bucketByType(EventView const& event, int nTypes, ParticleBatch& batch,
+                  std::vector<int>& bucketOffsets) {
+  bucketOffsets.assign(nTypes + 1, 0);
+  for (int i = 0; i < event.Size(); i++) {
+    if (event.IsFinal(i)) bucketOffsets[event.GetType(i) + 1]++;
+  }
+  for (int t = 0; t < nTypes; t++) {
+    bucketOffsets[t + 1] += bucketOffsets[t];
+  }
+  batch.Resize(bucketOffsets[nTypes]);
+  std::vector<int> next(bucketOffsets.begin(), bucketOffsets.end() - 1);
+  for (int i = 0; i < event.Size(); i++) {
+    if (!event.IsFinal(i)) continue;
+    const TypeId type = event.GetType(i);
+    batch.Set(next[type]++, type, event.GetFourMomentum(i));
+  }
+}
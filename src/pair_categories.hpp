@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cfloat>
+#include <cstdint>
+#include <vector>
+
+#include "event_store.hpp"
+#include "four_momentum.hpp"
+#include "particle.hpp"
+#include "particle_batch.hpp"
+
+// one bit per pair category
+using CategoryMask = uint64_t;
+const int MAX_PAIR_CATEGORIES = 64;
+
+// Kinematic cuts of a pair category. Every category has all of them, wide
+// open by default, so that any set of cuts is checked by the same code:
+// a pair passes if the transverse momenta of both particles are in
+// [fMinPt, fMaxPt) and the cosine of their opening angle is in
+// (fMinCos, fMaxCos).
+struct PairCuts {
+  double fMinPt = 0.;
+  double fMaxPt = DBL_MAX;
+  double fMinCos = -2.;
+  double fMaxCos = 2.;
+};
+
+bool operator==(PairCuts const& a, PairCuts const& b);
+
+// Symmetric table mapping a pair of particle types to a bitmask of the pair
+// categories (i.e. histograms) the pair belongs to. It is sized by the
+// particle registry, so adding a species only adds rows to the table.
+// Categories may also have kinematic cuts; categories with the same cuts
+// share them, so that their selection is computed once.
+class PairCategoryTable {
+ private:
+  int fNTypes;
+  std::vector<CategoryMask> fMasks;
+  std::vector<PairCuts> fCuts;
+  // index in fCuts of the cuts of every category, -1 if it has none
+  std::vector<int> fCategoryCuts;
+
+ public:
+  explicit PairCategoryTable(int nTypes);
+  int GetNTypes() const;
+  void Add(TypeId a, TypeId b, CategoryMask categories);
+  CategoryMask Get(TypeId a, TypeId b) const {
+    return fMasks[a * fNTypes + b];
+  }
+  void SetCuts(int category, PairCuts const& cuts);
+  // index of the cuts of category in GetCuts(), -1 if it has none
+  int GetCutsIndex(int category) const;
+  std::vector<PairCuts> const& GetCuts() const;
+};
+
+// Copies to out the values xs[j] of the pairs of a with the n particles of
+// momenta (px[j], py[j], pz[j]) that pass cuts, in order, and returns how
+// many they are; out must have room for n values. The cuts are evaluated
+// as masks, without branches, and the selected values are compressed with
+// AVX-512 when available.
+int selectPairs(PairCuts const& cuts, FourMomentum const& a, const double* px,
+                const double* py, const double* pz, const double* xs, int n,
+                double* out);
+
+// Fills batch with the particles sorted by type (a stable counting sort) and
+// sets bucketOffsets so that the particles of type t are in
+// [bucketOffsets[t], bucketOffsets[t + 1]).
+void bucketByType(std::vector<Particle> const& particles, int nTypes,
+                  ParticleBatch& batch, std::vector<int>& bucketOffsets);
+// same for the final state particles of an event of an event file, read
+// straight from its columns
+void bucketByType(EventView const& event, int nTypes, ParticleBatch& batch,
+                  std::vector<int>& bucketOffsets);
@@ -0,0 +1,142 @@
+#include "pair_config.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include "particle.hpp"
+#include "util.hpp"
+
+static std::vector<std::string> split(std::string const& list, char separator) {
+  std::vector<std::string> items;
+  std::stringstream stream(list);
+  std::string item;
+  while (std::getline(stream, item, separator)) {
+    items.push_back(item);
+  }
+  return items;
+}
+
+// applies a cut like "pt>0.5" to cuts, returns false if it is not valid
+static bool parseCut(std::string const& cut, PairCuts& cuts) {
+  const size_t op = cut.find_first_of("<>");
+  if (op == std::string::npos || op + 1 == cut.size()) return false;
+  const std::string variable = cut.substr(0, op);
+  size_t end;
+  const double value = std::stod(cut.substr(op + 1), &end);
+  if (op + 1 + end != cut.size()) return false;
+  const bool greater = cut[op] == '>';
+  if (variable == "pt") {
+    if (greater) {
+      cuts.fMinPt = std::max(cuts.fMinPt, value);
+    } else {
+      cuts.fMaxPt = std::min(cuts.fMaxPt, value);
+    }
+  } else if (variable == "angle") {
+    // the angle decreases with its cosine in [0, pi]
+    if (greater) {
+      cuts.fMaxCos = std::min(cuts.fMaxCos, std::cos(value));
+    } else {
+      cuts.fMinCos = std::max(cuts.fMinCos, std::cos(value));
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+std::vector<PairCategoryConfig> parsePairConfig(std::istream& in,
+                                                std::string const& source) {
+  std::vector<PairCategoryConfig> configs;
+  std::string line;
+  for (int lineNumber = 1; std::getline(in, line); lineNumber++) {
+    std::istringstream fields(line);
+    std::string name, first, second;
+    if (!(fields >> name) || name[0] == '#') continue;
+    const std::string where = concat(source, ":", lineNumber, ": ");
+    PairCategoryConfig config;
+    config.fName = name;
+    if (!(fields >> first >> second >> config.fNBins >> config.fXMin >>
+          config.fXMax)) {
+      throw std::runtime_error(
+          where + "expected name first second nBins xMin xMax [cut...]");
+    }
+    if (config.fNBins <= 0 || !(config.fXMin < config.fXMax)) {
+      throw std::runtime_error(where + "invalid binning");
+    }
+    config.fFirst = split(first, ',');
+    config.fSecond = split(second, ',');
+    std::string cut;
+    while (fields >> cut) {
+      bool valid = false;
+      try {
+        valid = parseCut(cut, config.fCuts);
+      } catch (std::exception const&) {
+      }
+      if (!valid) {
+        throw std::runtime_error(where + "invalid cut " + cut);
+      }
+    }
+    for (auto const& other : configs) {
+      if (other.fName == name) {
+        throw std::runtime_error(where + "duplicate category " + name);
+      }
+    }
+    configs.push_back(config);
+  }
+  return configs;
+}
+
+std::vector<PairCategoryConfig> readPairConfig(std::string const& path) {
+  std::ifstream in(path);
+  if (!in) {
+    throw std::runtime_error("Unable to open " + path + " file");
+  }
+  return parsePairConfig(in, path);
+}
+
+// types matched by a list of selectors
+static std::vector<TypeId> selectTypes(
+    std::vector<std::string> const& selectors) {
+  ParticleTable const& table = Particle::GetParticleTable();
+  std::vector<TypeId> types;
+  for (auto const& selector : selectors) {
+    const bool byCharge = selector == "+" || selector == "-" || selector == "0";
+    if (selector == "*" || byCharge) {
+      const int charge = selector == "+" ? 1 : selector == "-" ? -1 : 0;
+      for (int t = 0; t < table.Size(); t++) {
+        if (!byCharge || table[t].fCharge == charge) types.push_back(t);
+      }
+    } else {
+      const TypeId type = Particle::FindParticle(selector);
+      if (type == Particle::INVALID_TYPE) {
+        throw std::invalid_argument("No particle type named " + selector);
+      }
+      types.push_back(type);
+    }
+  }
+  return types;
+}
+
+void compilePairCategories(std::vector<PairCategoryConfig> const& configs,
+                           int firstCategory, PairCategoryTable& table) {
+  if (firstCategory + (int)configs.size() > MAX_PAIR_CATEGORIES) {
+    throw std::invalid_argument(
+        concat("At most ", MAX_PAIR_CATEGORIES - firstCategory,
+               " pair categories can be added"));
+  }
+  for (size_t c = 0; c < configs.size(); c++) {
+    const int category = firstCategory + c;
+    const CategoryMask bit = CategoryMask{1} << category;
+    for (TypeId a : selectTypes(configs[c].fFirst)) {
+      for (TypeId b : selectTypes(configs[c].fSecond)) {
+        table.Add(a, b, bit);
+      }
+    }
+    if (!(configs[c].fCuts == PairCuts{})) {
+      table.SetCuts(category, configs[c].fCuts);
+    }
+  }
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "pair_categories.hpp"
+
+// Pair category declared at run time, with its own invariant mass histogram
+struct PairCategoryConfig {
+  std::string fName;
+  // type names, or "+", "-" and "0" for all the types with that charge and
+  // "*" for all the types
+  std::vector<std::string> fFirst, fSecond;
+  PairCuts fCuts;
+  int fNBins;
+  double fXMin, fXMax;
+};
+
+// Reads pair categories, one per line:
+//   name first second nBins xMin xMax [cut...]
+// first and second are comma separated lists of type selectors, cuts are
+// pt>X and pt<X (transverse momentum of both particles) and angle>X and
+// angle<X (opening angle in radians). Empty lines and lines starting with #
+// are skipped. Throws std::runtime_error with the line of the first error.
+std::vector<PairCategoryConfig> readPairConfig(std::string const& path);
+std::vector<PairCategoryConfig> parsePairConfig(std::istream& in,
+                                                std::string const& source);
+
+// Adds the categories to table with indices firstCategory, firstCategory +
+// 1, ..., so that filling them costs a table entry and no branch per pair.
+// Throws std::invalid_argument on unknown types or too many categories.
+void compilePairCategories(std::vector<PairCategoryConfig> const& configs,
+                           int firstCategory, PairCategoryTable& table);
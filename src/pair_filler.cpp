@@ -0,0 +1,289 @@
+#include "pair_filler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+std::vector<std::vector<PairHisto>> resolvePairHistos(
+    PairCategoryTable const& categories,
+    std::vector<HistoAccumulator*> const& categoryHistos) {
+  const int nTypes = categories.GetNTypes();
+  std::vector<std::vector<PairHisto>> pairHistos(nTypes * nTypes);
+  for (int a = 0; a < nTypes; a++) {
+    for (int b = 0; b < nTypes; b++) {
+      auto& histos = pairHistos[a * nTypes + b];
+      for (int c = 0; c < (int)categoryHistos.size(); c++) {
+        const CategoryMask bit = CategoryMask{1} << c;
+        if (categoryHistos[c] && (categories.Get(a, b) & bit)) {
+          histos.push_back({categoryHistos[c], categories.GetCutsIndex(c)});
+        }
+      }
+      std::stable_sort(histos.begin(), histos.end(),
+                       [](PairHisto const& x, PairHisto const& y) {
+                         return x.fCuts < y.fCuts;
+                       });
+    }
+  }
+  return pairHistos;
+}
+
+void fillPairHistos(std::vector<PairHisto> const& histos,
+                    std::vector<PairCuts> const& cuts, FourMomentum const& a,
+                    const double* px, const double* py, const double* pz,
+                    const double* xs, int n, double* selected,
+                    double weight) {
+  // the selection of the previous accumulator is reused when it has the
+  // same cuts
+  int lastCuts = -1;
+  int nSelected = 0;
+  for (auto const& histo : histos) {
+    if (histo.fCuts < 0) {
+      histo.fHisto->FillN(n, xs, weight);
+      continue;
+    }
+    if (histo.fCuts != lastCuts) {
+      nSelected =
+          selectPairs(cuts[histo.fCuts], a, px, py, pz, xs, n, selected);
+      lastCuts = histo.fCuts;
+    }
+    histo.fHisto->FillN(nSelected, selected, weight);
+  }
+}
+
+PairFiller::PairFiller(PairCategoryTable const& categories,
+                       HistoAccumulator& allPairs,
+                       std::vector<HistoAccumulator*> const& categoryHistos,
+                       PairLoopOptions const& options)
+    : fNTypes{categories.GetNTypes()},
+      fOptions{options},
+      fCuts{categories.GetCuts()},
+      fRound{0},
+      fNActive{0},
+      fNRunning{0},
+      fStop{false} {
+  if (!(options.fFraction > 0. && options.fFraction <= 1.)) {
+    throw std::invalid_argument("pair fraction must be in (0, 1]");
+  }
+  if (options.fNThreads < 1) {
+    throw std::invalid_argument("pair threads must be positive");
+  }
+  fTargets.push_back(&allPairs);
+  for (HistoAccumulator* histo : categoryHistos) {
+    if (histo) fTargets.push_back(histo);
+  }
+  fWorkers.resize(options.fNThreads);
+  for (int t = 0; t < options.fNThreads; t++) {
+    Worker& worker = fWorkers[t];
+    if (t == 0) {
+      worker.fAllPairs = &allPairs;
+      worker.fPairHistos = resolvePairHistos(categories, categoryHistos);
+      continue;
+    }
+    worker.fPartials.reserve(fTargets.size());
+    for (HistoAccumulator* target : fTargets) {
+      worker.fPartials.push_back(*target);
+      worker.fPartials.back().Reset();
+    }
+    // the same categories, pointing to the partials
+    std::vector<HistoAccumulator*> partialHistos;
+    int k = 1;
+    for (HistoAccumulator* histo : categoryHistos) {
+      partialHistos.push_back(histo ? &worker.fPartials[k++] : nullptr);
+    }
+    worker.fAllPairs = &worker.fPartials[0];
+    worker.fPairHistos = resolvePairHistos(categories, partialHistos);
+  }
+  for (int t = 1; t < options.fNThreads; t++) {
+    fThreads.emplace_back(&PairFiller::RunThread, this, t);
+  }
+}
+
+PairFiller::~PairFiller() {
+  {
+    std::lock_guard<std::mutex> lock(fMutex);
+    fStop = true;
+  }
+  fWakeUp.notify_all();
+  for (auto& thread : fThreads) {
+    thread.join();
+  }
+}
+
+long PairFiller::Fill(std::vector<Particle> const& particles, Rng* rng) {
+  // sort the event into per-type buckets: the partners of particle i with a
+  // given type are then a contiguous slice of its row of pairs, which is
+  // filled as a whole into every histogram of that type pair
+  bucketByType(particles, fNTypes, fBatch, fBuckets);
+  return FillBatch(rng);
+}
+
+long PairFiller::Fill(EventView const& event, Rng* rng) {
+  bucketByType(event, fNTypes, fBatch, fBuckets);
+  return FillBatch(rng);
+}
+
+long PairFiller::FillBatch(Rng* rng) {
+  if (fOptions.fFraction < 1. && !rng) {
+    throw std::invalid_argument("sampling pairs needs a random generator");
+  }
+  const int n = fBatch.Size();
+  for (auto& worker : fWorkers) {
+    worker.fInvMasses.resize(n);
+    worker.fSelected.resize(n);
+  }
+  if (fOptions.fFraction < 1.) {
+    return FillSampled(*rng);
+  }
+  if (n > PAIR_TILE_PARTICLES) {
+    FillTiles();
+  } else {
+    FillRows();
+  }
+  return static_cast<long>(n) * (n - 1) / 2;
+}
+
+void PairFiller::FillRows() {
+  Worker& worker = fWorkers[0];
+  const int n = fBatch.Size();
+  for (int aType = 0; aType < fNTypes; aType++) {
+    for (int i = fBuckets[aType]; i < fBuckets[aType + 1]; i++) {
+      invMassRow(fBatch, i, i + 1, n, worker.fInvMasses.data(),
+                 fOptions.fPrecision);
+      worker.fAllPairs->FillN(n - i - 1, worker.fInvMasses.data());
+      const FourMomentum a = fBatch.GetFourMomentum(i);
+      for (int bType = aType; bType < fNTypes; bType++) {
+        const int begin = std::max(fBuckets[bType], i + 1);
+        const int end = fBuckets[bType + 1];
+        if (begin >= end) continue;
+        fillPairHistos(worker.fPairHistos[aType * fNTypes + bType], fCuts, a,
+                       fBatch.Px() + begin, fBatch.Py() + begin,
+                       fBatch.Pz() + begin,
+                       worker.fInvMasses.data() + (begin - i - 1),
+                       end - begin, worker.fSelected.data());
+      }
+    }
+  }
+}
+
+void PairFiller::FillTile(Worker& worker, int iBegin, int iEnd, int jBegin,
+                          int jEnd) {
+  for (int i = iBegin; i < iEnd; i++) {
+    const int aType = fBatch.Type()[i];
+    const FourMomentum a = fBatch.GetFourMomentum(i);
+    for (int bType = aType; bType < fNTypes; bType++) {
+      const int begin = std::max({fBuckets[bType], i + 1, jBegin});
+      const int end = std::min(fBuckets[bType + 1], jEnd);
+      if (begin >= end) continue;
+      FillSlice(worker, i, a, aType * fNTypes + bType, begin, end, 1.);
+    }
+  }
+}
+
+void PairFiller::FillThreadTiles(int t, int nThreads) {
+  const int n = fBatch.Size();
+  const int nBlocks = (n + PAIR_TILE_PARTICLES - 1) / PAIR_TILE_PARTICLES;
+  // tile k goes to thread k % nThreads, the partner tiles of a row of tiles
+  // are next to each other so that its particles stay in L2
+  int tile = 0;
+  for (int bi = 0; bi < nBlocks; bi++) {
+    for (int bj = bi; bj < nBlocks; bj++, tile++) {
+      if (tile % nThreads != t) continue;
+      FillTile(fWorkers[t], bi * PAIR_TILE_PARTICLES,
+               std::min(n, (bi + 1) * PAIR_TILE_PARTICLES),
+               bj * PAIR_TILE_PARTICLES,
+               std::min(n, (bj + 1) * PAIR_TILE_PARTICLES));
+    }
+  }
+}
+
+void PairFiller::FillTiles() {
+  const int n = fBatch.Size();
+  const int nBlocks = (n + PAIR_TILE_PARTICLES - 1) / PAIR_TILE_PARTICLES;
+  const int nTiles = nBlocks * (nBlocks + 1) / 2;
+  const int nThreads = std::min<int>(fWorkers.size(), nTiles);
+  if (nThreads > 1) {
+    {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fNActive = nThreads;
+      fNRunning = nThreads - 1;
+      fRound++;
+    }
+    fWakeUp.notify_all();
+  }
+  FillThreadTiles(0, nThreads);
+  if (nThreads > 1) {
+    std::unique_lock<std::mutex> lock(fMutex);
+    fDone.wait(lock, [this] { return fNRunning == 0; });
+  }
+  for (int t = 1; t < nThreads; t++) {
+    auto& partials = fWorkers[t].fPartials;
+    for (size_t k = 0; k < fTargets.size(); k++) {
+      fTargets[k]->Add(partials[k]);
+      partials[k].Reset();
+    }
+  }
+}
+
+void PairFiller::RunThread(int t) {
+  long round = 0;
+  std::unique_lock<std::mutex> lock(fMutex);
+  while (true) {
+    fWakeUp.wait(lock, [&] { return fStop || fRound != round; });
+    if (fStop) {
+      return;
+    }
+    round = fRound;
+    // small events have fewer tiles than threads
+    if (t >= fNActive) continue;
+    const int nThreads = fNActive;
+    lock.unlock();
+    FillThreadTiles(t, nThreads);
+    lock.lock();
+    if (--fNRunning == 0) fDone.notify_one();
+  }
+}
+
+long PairFiller::FillSampled(Rng& rng) {
+  Worker& worker = fWorkers[0];
+  long nFilled = 0;
+  for (int aType = 0; aType < fNTypes; aType++) {
+    for (int i = fBuckets[aType]; i < fBuckets[aType + 1]; i++) {
+      const FourMomentum a = fBatch.GetFourMomentum(i);
+      // the partners after i of every type come after it in the batch, so
+      // the slices of all types make up the whole row
+      for (int bType = aType; bType < fNTypes; bType++) {
+        const int begin = std::max(fBuckets[bType], i + 1);
+        const int end = fBuckets[bType + 1];
+        const int size = end - begin;
+        if (size <= 0) continue;
+        // the partners taken are consecutive from a random start, wrapping
+        // around the slice, so that the masses are still computed in runs:
+        // every partner is taken with probability nTaken / size
+        const int nTaken = std::min(
+            size, static_cast<int>(std::ceil(fOptions.fFraction * size)));
+        const double weight = static_cast<double>(size) / nTaken;
+        const int start =
+            begin + std::min(size - 1, static_cast<int>(rng.Rndm() * size));
+        const int stop = start + nTaken;
+        const int pair = aType * fNTypes + bType;
+        FillSlice(worker, i, a, pair, start, std::min(stop, end), weight);
+        if (stop > end) {
+          FillSlice(worker, i, a, pair, begin, begin + stop - end, weight);
+        }
+        nFilled += nTaken;
+      }
+    }
+  }
+  return nFilled;
+}
+
+void PairFiller::FillSlice(Worker& worker, int i, FourMomentum const& a,
+                           int pair, int begin, int end, double weight) {
+  invMassRow(fBatch, i, begin, end, worker.fInvMasses.data(),
+             fOptions.fPrecision);
+  worker.fAllPairs->FillN(end - begin, worker.fInvMasses.data(), weight);
+  fillPairHistos(worker.fPairHistos[pair], fCuts, a, fBatch.Px() + begin,
+                 fBatch.Py() + begin, fBatch.Pz() + begin,
+                 worker.fInvMasses.data(), end - begin,
+                 worker.fSelected.data(), weight);
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "histo_accumulator.hpp"
+#include "pair_categories.hpp"
+#include "particle.hpp"
+#include "particle_batch.hpp"
+#include "rng.hpp"
+
+// accumulator filled by a type pair, with the index of the cuts of its
+// category in PairCategoryTable::GetCuts(), -1 if it has none
+struct PairHisto {
+  HistoAccumulator* fHisto;
+  int fCuts;
+};
+
+// Resolves every type pair (a * nTypes + b) into the accumulators it
+// fills: categoryHistos[c] is filled by the pairs whose category has bit c
+// set, null entries are skipped. The accumulators of a pair are sorted by
+// cuts, so that the ones with the same cuts are next to each other.
+std::vector<std::vector<PairHisto>> resolvePairHistos(
+    PairCategoryTable const& categories,
+    std::vector<HistoAccumulator*> const& categoryHistos);
+
+// Fills the n values xs into the accumulators of a type pair. The partners
+// of a are the particles of momenta (px[j], py[j], pz[j]); categories with
+// cuts only get the values of the pairs that pass them, selected into
+// selected, which must have room for n values. Every value is filled with
+// weight.
+void fillPairHistos(std::vector<PairHisto> const& histos,
+                    std::vector<PairCuts> const& cuts, FourMomentum const& a,
+                    const double* px, const double* py, const double* pz,
+                    const double* xs, int n, double* selected,
+                    double weight = 1.);
+
+// particles per side of the tiles of the pair loop of large events: the
+// momenta of a tile of partners (32 bytes each) and their masses stay in L1
+// while every particle of the other tile goes through them
+const int PAIR_TILE_PARTICLES = 512;
+
+// how PairFiller computes and fills the pairs of an event
+struct PairLoopOptions {
+  PairPrecision fPrecision = PairPrecision::DOUBLE;
+  // fraction of the pairs filled, in (0, 1]
+  double fFraction = 1.;
+  // threads sharing the pairs of an event larger than a tile
+  int fNThreads = 1;
+};
+
+// Fills the invariant mass of every pair of an event into an accumulator
+// for all pairs plus one accumulator per pair category bit. The masses are
+// computed with the arithmetic of precision, the cuts always in double.
+//
+// Events larger than a tile have their triangle of pairs cut into square
+// tiles of PAIR_TILE_PARTICLES, filled one at a time. With more than one
+// thread the tiles are dealt in turn to the threads, each filling its own
+// partial accumulators, which are added to the real ones in thread order at
+// the end of the event: the result only depends on the number of threads.
+// The threads are started with the filler and wait for the next event;
+// waking them up still costs more than the pairs of a small event, so they
+// only pay off for events of thousands of particles.
+//
+// With a fraction below one only a random subset of the pairs is filled,
+// stratified by particle and partner type: for every particle i and type b,
+// ceil(fraction * m) of the m partners of type b after i are taken, and
+// their pairs are filled with weight m over the number taken. Every pair is
+// taken with the inverse of its weight, so every histogram stays an
+// unbiased estimate of the full one, and rare type pairs are not left out.
+// Sampled events are filled by rows on the calling thread.
+class PairFiller {
+ private:
+  // what a thread fills: the first one the accumulators of the filler, the
+  // others partial copies of them
+  struct Worker {
+    // copies of fTargets, empty for the first thread
+    std::vector<HistoAccumulator> fPartials;
+    HistoAccumulator* fAllPairs;
+    // accumulators filled by each type pair
+    std::vector<std::vector<PairHisto>> fPairHistos;
+    std::vector<double> fInvMasses, fSelected;
+  };
+
+  int fNTypes;
+  PairLoopOptions fOptions;
+  // all pairs accumulator, then every category accumulator
+  std::vector<HistoAccumulator*> fTargets;
+  std::vector<PairCuts> fCuts;
+  std::vector<Worker> fWorkers;
+  ParticleBatch fBatch;
+  std::vector<int> fBuckets;
+  // threads 1, 2, ... of the tile loop, woken up by FillTiles for every
+  // event; the members below are guarded by fMutex
+  std::vector<std::thread> fThreads;
+  std::mutex fMutex;
+  std::condition_variable fWakeUp, fDone;
+  // events handed to the threads so far
+  long fRound;
+  // threads taking part in this round, and those still filling their tiles
+  int fNActive, fNRunning;
+  bool fStop;
+
+  // fills the pairs of particle a (row i of the batch) with the partners in
+  // [begin, end), which have the same type, with weight
+  void FillSlice(Worker& worker, int i, FourMomentum const& a, int pair,
+                 int begin, int end, double weight);
+  void FillRows();
+  void FillTile(Worker& worker, int iBegin, int iEnd, int jBegin, int jEnd);
+  // fills the tiles dealt to thread t of nThreads
+  void FillThreadTiles(int t, int nThreads);
+  void FillTiles();
+  void RunThread(int t);
+  long FillSampled(Rng& rng);
+  // fills the event sorted into fBatch and fBuckets
+  long FillBatch(Rng* rng);
+
+ public:
+  // categoryHistos[c] is filled by the pairs whose category has bit c set
+  PairFiller(PairCategoryTable const& categories, HistoAccumulator& allPairs,
+             std::vector<HistoAccumulator*> const& categoryHistos,
+             PairLoopOptions const& options = {});
+  // stops the threads of the tile loop
+  ~PairFiller();
+  PairFiller(PairFiller const&) = delete;
+  PairFiller& operator=(PairFiller const&) = delete;
+  // Fills the pairs of an event and returns how many were filled. rng picks
+  // the pairs when the fraction is below one, and is needed only then.
+  long Fill(std::vector<Particle> const& particles, Rng* rng = nullptr);
+  // same for the final state particles of an event of an event file, read
+  // straight from its columns
+  long Fill(EventView const& event, Rng* rng = nullptr);
+};
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Calls task(i) for every i in [0, n) on nThreads threads. Tasks are handed
+// out one at a time, so tasks of different lengths still balance out.
+template <class F>
+void parallelFor(int n, int nThreads, F&& task) {
+  nThreads = std::max(1, std::min(nThreads, n));
+  std::atomic<int> next{0};
+  auto worker = [&] {
+    for (int i = next++; i < n; i = next++) {
+      task(i);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int t = 1; t < nThreads; t++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
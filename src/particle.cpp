@@ -6,26 +6,40 @@
 
 #include "resonance_type.hpp"
 
-ParticleType* Particle::fParticleTypes[Particle::fMaxNumParticleType];
-int Particle::fNParticleType = 0;
+std::vector<ParticleType*> Particle::fParticleTypes;
+std::unordered_map<std::string, TypeId> Particle::fTypeIds;
+ParticleTable Particle::fTable;
+bool Particle::fFrozen = false;
 
 Particle::Particle()
-    : fIndex{Particle::INVALID_TYPE}, fPx{0.}, fPy{0.}, fPz{0.} {
+    : fIndex{Particle::INVALID_TYPE}, fP{0., 0., 0., 0., 0.} {
+}
+
+Particle::Particle(TypeId type, double px, double py, double pz)
+    : fIndex{CheckedType(type)},
+      fP{makeFourMomentum(px, py, pz, MassSquared(fIndex))} {
+}
+
+Particle::Particle(TypeId type, FourMomentum const& p)
+    : fIndex{CheckedType(type)}, fP{p} {
 }
 
 Particle::Particle(std::string name, double px, double py, double pz)
-    : fIndex{FindParticle(name)}, fPx{px}, fPy{py}, fPz{pz} {
+    : fIndex{FindParticle(name)},
+      fP{makeFourMomentum(px, py, pz, MassSquared(fIndex))} {
 }
 
-int Particle::AddParticleType(std::string name, double mass, int charge,
-                              double width) {
-  int index = FindParticle(name);
+TypeId Particle::AddParticleType(std::string name, double mass, int charge,
+                                 double width) {
+  if (fFrozen) {
+    throw std::runtime_error(
+        "Particle types cannot be edited while they are frozen.\n");
+  }
+  TypeId index = FindParticle(name);
   if (index == Particle::INVALID_TYPE) {  // particle does not exist
-    if (fNParticleType == fMaxNumParticleType) {
-      throw std::runtime_error("Maximum amount of particle types reached.\n");
-    }
-    index = fNParticleType;
-    fNParticleType++;
+    index = fParticleTypes.size();
+    fParticleTypes.push_back(nullptr);
+    fTypeIds.emplace(name, index);
     std::cout << "Adding new particle type named: \"" << name << "\"\n";
   } else {
     delete fParticleTypes[index];
@@ -34,9 +48,43 @@ int Particle::AddParticleType(std::string name, double mass, int charge,
   fParticleTypes[index] = width == 0.0
                               ? new ParticleType(name, mass, charge)
                               : new ResonanceType(name, mass, charge, width);
+  fTable = ParticleTable(fParticleTypes.data(), fParticleTypes.size());
   return index;
 }
 
+void Particle::AddDecayChannel(TypeId mother, TypeId dau1, TypeId dau2,
+                               double branchingRatio) {
+  if (fFrozen) {
+    throw std::runtime_error(
+        "Particle types cannot be edited while they are frozen.\n");
+  }
+  const TypeId nTypes = fParticleTypes.size();
+  if (mother < 0 || mother >= nTypes || dau1 < 0 || dau1 >= nTypes ||
+      dau2 < 0 || dau2 >= nTypes) {
+    throw std::invalid_argument("No particle type with specified index\n");
+  }
+  auto* resonance = dynamic_cast<ResonanceType*>(fParticleTypes[mother]);
+  if (!resonance) {
+    throw std::invalid_argument("Only resonances can decay\n");
+  }
+  resonance->AddDecayChannel({dau1, dau2, branchingRatio});
+  fTable = ParticleTable(fParticleTypes.data(), fParticleTypes.size());
+}
+
+// Once frozen the particle table cannot change, so it can be shared between
+// threads for the whole run
+void Particle::FreezeParticleTypes() {
+  fFrozen = true;
+}
+
+void Particle::UnfreezeParticleTypes() {
+  fFrozen = false;
+}
+
+ParticleTable const& Particle::GetParticleTable() {
+  return fTable;
+}
+
 void Particle::PrintParticleTypes() {
   for (auto const& type : fParticleTypes) {
     std::cout << "--------------\n";
@@ -45,7 +93,7 @@ void Particle::PrintParticleTypes() {
   std::cout << "--------------\n";
 }
 
-void Particle::Decay2body(Particle& dau1, Particle& dau2) const {
+void Particle::Decay2body(Particle& dau1, Particle& dau2, Rng& rng) const {
   if (GetMass() == 0.0) {
     throw std::runtime_error("Decayment cannot be preformed if mass is zero");
   }
@@ -55,20 +103,9 @@ void Particle::Decay2body(Particle& dau1, Particle& dau2) const {
   double massDau2 = dau2.GetMass();
 
   if (IsOfValidType()) {  // add width effect
-    // gaussian random numbers
-    float x1, x2, w, y1;
-
-    double invnum = 1. / RAND_MAX;
-    do {
-      x1 = 2.0 * rand() * invnum - 1.0;
-      x2 = 2.0 * rand() * invnum - 1.0;
-      w = x1 * x1 + x2 * x2;
-    } while (w >= 1.0);
-
-    w = sqrt((-2.0 * log(w)) / w);
-    y1 = x1 * w;
-
-    massMot += fParticleTypes[fIndex]->GetWidth() * y1;
+    const double u1 = rng.Rndm();
+    const double u2 = rng.Rndm();
+    massMot += fTable[fIndex].fWidth * boxMuller(u1, u2);
   }
 
   if (massMot < massDau1 + massDau2) {
@@ -83,46 +120,42 @@ void Particle::Decay2body(Particle& dau1, Particle& dau2) const {
           (massMot * massMot - (massDau1 - massDau2) * (massDau1 - massDau2))) /
       massMot * 0.5;
 
-  double norm = 2 * M_PI / RAND_MAX;
-
-  double phi = rand() * norm;
-  double theta = rand() * norm * 0.5 - M_PI / 2.;
+  double phi = rng.Uniform(0., 2 * M_PI);
+  double theta = rng.Uniform(-M_PI / 2., M_PI / 2.);
   dau1.SetP(pout * sin(theta) * cos(phi), pout * sin(theta) * sin(phi),
             pout * cos(theta));
   dau2.SetP(-pout * sin(theta) * cos(phi), -pout * sin(theta) * sin(phi),
             -pout * cos(theta));
 
-  double energy = sqrt(fPx * fPx + fPy * fPy + fPz * fPz + massMot * massMot);
+  double energy =
+      sqrt(fP.fPx * fP.fPx + fP.fPy * fP.fPy + fP.fPz * fP.fPz +
+           massMot * massMot);
 
-  double bx = fPx / energy;
-  double by = fPy / energy;
-  double bz = fPz / energy;
+  double bx = fP.fPx / energy;
+  double by = fP.fPy / energy;
+  double bz = fP.fPz / energy;
 
   dau1.Boost(bx, by, bz);
   dau2.Boost(bx, by, bz);
 }
 
 double Particle::TotalEnergy() const {
-  const auto p = std::hypot(fPx, fPy, fPz);
-  const auto m = GetMass();
-  return std::hypot(m, p);
+  return fP.fE;
 }
 
 double Particle::InvMass(Particle const& p) const {
-  const auto eSumSquared = std::pow(TotalEnergy() + p.TotalEnergy(), 2);
-  const auto pX = fPx + p.fPx, pY = fPy + p.fPy, pZ = fPz + p.fPz;
-  const auto pulseSquared = pX * pX + pY * pY + pZ * pZ;
-  return std::sqrt(eSumSquared - pulseSquared);
+  return invMass(fP, p.fP);
 }
 
 void Particle::Print() const {
   std::cout << "Type index: " << fIndex << "\n";
   if (IsOfValidType()) {
-    std::cout << "Name: \"" << fParticleTypes[fIndex]->GetName() << "\"\n";
+    std::cout << "Name: \"" << fTable.GetName(fIndex) << "\"\n";
   } else {
     std::cout << "Name: <invalid-particle-type>\n";
   }
-  std::cout << "Pulse: { x: " << fPx << ", y: " << fPy << ", z: " << fPz
+  std::cout << "Pulse: { x: " << fP.fPx << ", y: " << fP.fPy
+            << ", z: " << fP.fPz
             << " }\n";
 }
 
@@ -130,68 +163,83 @@ bool Particle::IsOfValidType() const {
   return fIndex != Particle::INVALID_TYPE;
 }
 
-int Particle::GetParticleType() const {
+TypeId Particle::GetParticleType() const {
   return fIndex;
 }
 
 void Particle::SetParticleType(std::string name) {
-  int index = FindParticle(name);
+  TypeId index = FindParticle(name);
   if (index == Particle::INVALID_TYPE) {
-    std::cout << "No particle type named: \"" << name << "\"\n";
-    return;
+    throw std::invalid_argument("No particle type with specified name\n");
   }
   fIndex = index;
+  UpdateEnergy();
 }
 
-void Particle::SetParticleType(int index) {
-  if (index < 0 || index >= fNParticleType) {
+void Particle::SetParticleType(TypeId index) {
+  if (index < 0 || index >= (TypeId)fParticleTypes.size()) {
     throw std::invalid_argument("No particle type with specified index\n");
   }
   fIndex = index;
+  UpdateEnergy();
 }
 
 double Particle::GetPulseX() const {
-  return fPx;
+  return fP.fPx;
 }
 
 double Particle::GetPulseY() const {
-  return fPy;
+  return fP.fPy;
 }
 
 double Particle::GetPulseZ() const {
-  return fPz;
+  return fP.fPz;
+}
+
+FourMomentum const& Particle::GetFourMomentum() const {
+  return fP;
 }
 
 void Particle::SetP(double x, double y, double z) {
-  fPx = x;
-  fPy = y;
-  fPz = z;
+  fP = makeFourMomentum(x, y, z, fP.fM2);
 }
 
 double Particle::GetMass() const {
   if (!IsOfValidType()) {
     throw std::runtime_error("Cannot read mass of invalid particle type");
   }
-  return fParticleTypes[fIndex]->GetMass();
+  return fTable[fIndex].fMass;
 }
 
 double Particle::GetCharge() const {
   if (!IsOfValidType()) {
     throw std::runtime_error("Cannot read charge of invalid particle type");
   }
-  return fParticleTypes[fIndex]->GetCharge();
+  return fTable[fIndex].fCharge;
 }
 
-int Particle::FindParticle(std::string const& name) {
-  ParticleType* type = nullptr;
-  for (int i = 0; i < Particle::fNParticleType; i++) {
-    type = Particle::fParticleTypes[i];
-    if (type->GetName() == name) {
-      return i;
-    }
+// hashes the name, meant for setup code only: hot paths should keep the TypeId
+// returned by AddParticleType instead
+TypeId Particle::FindParticle(std::string const& name) {
+  const auto found = fTypeIds.find(name);
+  return found == fTypeIds.end() ? Particle::INVALID_TYPE : found->second;
+}
+
+TypeId Particle::CheckedType(TypeId index) {
+  if (index < Particle::INVALID_TYPE ||
+      index >= (TypeId)fParticleTypes.size()) {
+    throw std::invalid_argument("No particle type with specified index\n");
   }
-  std::cout << "No particle named: " << name << "\n";
-  return Particle::INVALID_TYPE;
+  return index;
+}
+
+double Particle::MassSquared(TypeId index) {
+  return index == Particle::INVALID_TYPE ? 0. : fTable[index].fMass2;
+}
+
+// recomputes the cached energy after the particle changed type
+void Particle::UpdateEnergy() {
+  fP = makeFourMomentum(fP.fPx, fP.fPy, fP.fPz, MassSquared(fIndex));
 }
 
 void Particle::Boost(double bx, double by, double bz) {
@@ -200,10 +248,10 @@ void Particle::Boost(double bx, double by, double bz) {
   // Boost this Lorentz vector
   double b2 = bx * bx + by * by + bz * bz;
   double gamma = 1.0 / sqrt(1.0 - b2);
-  double bp = bx * fPx + by * fPy + bz * fPz;
+  double bp = bx * fP.fPx + by * fP.fPy + bz * fP.fPz;
   double gamma2 = b2 > 0 ? (gamma - 1.0) / b2 : 0.0;
 
-  fPx += gamma2 * bp * bx + gamma * bx * energy;
-  fPy += gamma2 * bp * by + gamma * by * energy;
-  fPz += gamma2 * bp * bz + gamma * bz * energy;
+  SetP(fP.fPx + gamma2 * bp * bx + gamma * bx * energy,
+       fP.fPy + gamma2 * bp * by + gamma * by * energy,
+       fP.fPz + gamma2 * bp * bz + gamma * bz * energy);
 }
\ No newline at end of file
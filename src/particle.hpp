@@ -1,44 +1,70 @@
 #pragma once
 
 #include <string>
+#include <unordered_map>
+#include <vector>
 
+#include "four_momentum.hpp"
+#include "particle_table.hpp"
 #include "particle_type.hpp"
+#include "rng.hpp"
+
+// Handle of a registered particle type, as returned by AddParticleType
+using TypeId = int;
 
 class Particle {
  private:
-  static const int fMaxNumParticleType = 10;
-  static ParticleType* fParticleTypes[fMaxNumParticleType];
-  static int fNParticleType;
+  // registered types, indexed by TypeId, and their index by name
+  static std::vector<ParticleType*> fParticleTypes;
+  static std::unordered_map<std::string, TypeId> fTypeIds;
+  static ParticleTable fTable;
+  static bool fFrozen;
 
-  int fIndex;
-  double fPx, fPy, fPz;
+  TypeId fIndex;
+  FourMomentum fP;
 
  public:
-  static const int INVALID_TYPE = -1;
+  static const TypeId INVALID_TYPE = -1;
 
  public:
   Particle();
+  Particle(TypeId type, double fPx = 0.0, double fPy = 0.0,
+           double fPz = 0.0);
+  Particle(TypeId type, FourMomentum const& p);
   Particle(std::string name, double fPx = 0.0, double fPy = 0.0,
            double fPz = 0.0);
-  static int AddParticleType(std::string name, double mass, int charge,
-                             double width = 0.0);
+  static TypeId AddParticleType(std::string name, double mass, int charge,
+                                double width = 0.0);
+  // adds a two body decay channel to a resonance type; the branching
+  // ratios of a type are normalized to their sum
+  static void AddDecayChannel(TypeId mother, TypeId dau1, TypeId dau2,
+                              double branchingRatio);
+  static TypeId FindParticle(std::string const& name);
+  static void FreezeParticleTypes();
+  static void UnfreezeParticleTypes();
+  static ParticleTable const& GetParticleTable();
   static void PrintParticleTypes();
-  void Decay2body(Particle& dau1, Particle& dau2) const;
+  void Decay2body(Particle& dau1, Particle& dau2, Rng& rng) const;
   double TotalEnergy() const;
   double InvMass(Particle const& p) const;
   void Print() const;
   bool IsOfValidType() const;
-  int GetParticleType() const;
+  TypeId GetParticleType() const;
   void SetParticleType(std::string name);
-  void SetParticleType(int index);
+  void SetParticleType(TypeId index);
   double GetPulseX() const;
   double GetPulseY() const;
   double GetPulseZ() const;
+  FourMomentum const& GetFourMomentum() const;
   void SetP(double x, double y, double z);
   double GetMass() const;
   double GetCharge() const;
+  void Boost(double bx, double by, double bz);
 
  private:
-  static int FindParticle(std::string const& name);
-  void Boost(double bx, double by, double bz);
+  // index, after checking that it is INVALID_TYPE or a registered type;
+  // throws std::invalid_argument otherwise
+  static TypeId CheckedType(TypeId index);
+  static double MassSquared(TypeId index);
+  void UpdateEnergy();
 };
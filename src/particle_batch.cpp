@@ -0,0 +1,249 @@
+#include "particle_batch.hpp"
+
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+bool parsePairPrecision(const char* name, PairPrecision& precision) {
+  if (std::strcmp(name, "double") == 0) {
+    precision = PairPrecision::DOUBLE;
+  } else if (std::strcmp(name, "float") == 0) {
+    precision = PairPrecision::FLOAT;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* pairPrecisionName(PairPrecision precision) {
+  return precision == PairPrecision::FLOAT ? "float" : "double";
+}
+
+void ParticleBatch::Clear() {
+  fPx.clear();
+  fPy.clear();
+  fPz.clear();
+  fE.clear();
+  fM2.clear();
+  fPxFloat.clear();
+  fPyFloat.clear();
+  fPzFloat.clear();
+  fEFloat.clear();
+  fM2Float.clear();
+  fType.clear();
+}
+
+void ParticleBatch::Reserve(int n) {
+  fPx.reserve(n);
+  fPy.reserve(n);
+  fPz.reserve(n);
+  fE.reserve(n);
+  fM2.reserve(n);
+  fPxFloat.reserve(n);
+  fPyFloat.reserve(n);
+  fPzFloat.reserve(n);
+  fEFloat.reserve(n);
+  fM2Float.reserve(n);
+  fType.reserve(n);
+}
+
+void ParticleBatch::Resize(int n) {
+  fPx.resize(n);
+  fPy.resize(n);
+  fPz.resize(n);
+  fE.resize(n);
+  fM2.resize(n);
+  fPxFloat.resize(n);
+  fPyFloat.resize(n);
+  fPzFloat.resize(n);
+  fEFloat.resize(n);
+  fM2Float.resize(n);
+  fType.resize(n);
+}
+
+void ParticleBatch::Push(Particle const& particle) {
+  Resize(Size() + 1);
+  Set(Size() - 1, particle);
+}
+
+void ParticleBatch::Set(int index, Particle const& particle) {
+  Set(index, particle.GetParticleType(), particle.GetFourMomentum());
+}
+
+void ParticleBatch::Set(int index, TypeId type, FourMomentum const& p) {
+  fPx[index] = p.fPx;
+  fPy[index] = p.fPy;
+  fPz[index] = p.fPz;
+  fE[index] = p.fE;
+  fM2[index] = p.fM2;
+  fPxFloat[index] = p.fPx;
+  fPyFloat[index] = p.fPy;
+  fPzFloat[index] = p.fPz;
+  fEFloat[index] = p.fE;
+  fM2Float[index] = p.fM2;
+  fType[index] = type;
+}
+
+int ParticleBatch::Size() const {
+  return fType.size();
+}
+
+const double* ParticleBatch::Px() const {
+  return fPx.data();
+}
+
+const double* ParticleBatch::Py() const {
+  return fPy.data();
+}
+
+const double* ParticleBatch::Pz() const {
+  return fPz.data();
+}
+
+const double* ParticleBatch::E() const {
+  return fE.data();
+}
+
+const double* ParticleBatch::M2() const {
+  return fM2.data();
+}
+
+const TypeId* ParticleBatch::Type() const {
+  return fType.data();
+}
+
+const float* ParticleBatch::PxFloat() const {
+  return fPxFloat.data();
+}
+
+const float* ParticleBatch::PyFloat() const {
+  return fPyFloat.data();
+}
+
+const float* ParticleBatch::PzFloat() const {
+  return fPzFloat.data();
+}
+
+const float* ParticleBatch::EFloat() const {
+  return fEFloat.data();
+}
+
+const float* ParticleBatch::M2Float() const {
+  return fM2Float.data();
+}
+
+FourMomentum ParticleBatch::GetFourMomentum(int index) const {
+  return {fE[index], fPx[index], fPy[index], fPz[index], fM2[index]};
+}
+
+void invMassRow(ParticleBatch const& batch, int i, int begin, int end,
+                double* out, PairPrecision precision) {
+  const FourMomentum a = batch.GetFourMomentum(i);
+  if (precision == PairPrecision::FLOAT) {
+    invMassAgainst(a, batch.PxFloat() + begin, batch.PyFloat() + begin,
+                   batch.PzFloat() + begin, batch.EFloat() + begin,
+                   batch.M2Float() + begin, end - begin, out);
+  } else {
+    invMassAgainst(a, batch.Px() + begin, batch.Py() + begin,
+                   batch.Pz() + begin, batch.E() + begin, batch.M2() + begin,
+                   end - begin, out);
+  }
+}
+
+// m^2 = m1^2 + m2^2 + 2 (E1 E2 - p1.p2), as invMass2: no sums of large
+// energies are squared, and the masses are the ones the energies come from
+void invMassAgainst(FourMomentum const& a, const double* px, const double* py,
+                    const double* pz, const double* e, const double* m2, int n,
+                    double* out) {
+  const double ax = a.fPx, ay = a.fPy, az = a.fPz, ae = a.fE, am2 = a.fM2;
+  int j = 0;
+
+#if defined(__AVX512F__)
+  const __m512d ax8 = _mm512_set1_pd(ax), ay8 = _mm512_set1_pd(ay),
+                az8 = _mm512_set1_pd(az), ae8 = _mm512_set1_pd(ae),
+                am28 = _mm512_set1_pd(am2), two8 = _mm512_set1_pd(2.);
+  for (; j + 8 <= n; j += 8) {
+    __m512d dot = _mm512_mul_pd(ae8, _mm512_loadu_pd(e + j));
+    dot = _mm512_fnmadd_pd(ax8, _mm512_loadu_pd(px + j), dot);
+    dot = _mm512_fnmadd_pd(ay8, _mm512_loadu_pd(py + j), dot);
+    dot = _mm512_fnmadd_pd(az8, _mm512_loadu_pd(pz + j), dot);
+    const __m512d masses2 = _mm512_add_pd(am28, _mm512_loadu_pd(m2 + j));
+    const __m512d sum = _mm512_fmadd_pd(two8, dot, masses2);
+    // all lanes set: the same as _mm512_sqrt_pd, which gcc 12 warns about
+    // (its builtin passes an undefined source)
+    _mm512_storeu_pd(out + j, _mm512_mask_sqrt_pd(sum, 0xFF, sum));
+  }
+#elif defined(__AVX2__)
+  const __m256d ax4 = _mm256_set1_pd(ax), ay4 = _mm256_set1_pd(ay),
+                az4 = _mm256_set1_pd(az), ae4 = _mm256_set1_pd(ae),
+                am24 = _mm256_set1_pd(am2), two4 = _mm256_set1_pd(2.);
+  for (; j + 4 <= n; j += 4) {
+    __m256d dot = _mm256_mul_pd(ae4, _mm256_loadu_pd(e + j));
+    dot = _mm256_sub_pd(dot, _mm256_mul_pd(ax4, _mm256_loadu_pd(px + j)));
+    dot = _mm256_sub_pd(dot, _mm256_mul_pd(ay4, _mm256_loadu_pd(py + j)));
+    dot = _mm256_sub_pd(dot, _mm256_mul_pd(az4, _mm256_loadu_pd(pz + j)));
+    const __m256d masses2 = _mm256_add_pd(am24, _mm256_loadu_pd(m2 + j));
+    const __m256d sum = _mm256_add_pd(masses2, _mm256_mul_pd(two4, dot));
+    _mm256_storeu_pd(out + j, _mm256_sqrt_pd(sum));
+  }
+#endif
+
+  // scalar fallback and remainder
+  for (; j < n; j++) {
+    const double dot = ae * e[j] - ax * px[j] - ay * py[j] - az * pz[j];
+    out[j] = std::sqrt(am2 + m2[j] + 2. * dot);
+  }
+}
+
+void invMassAgainst(FourMomentum const& a, const float* px, const float* py,
+                    const float* pz, const float* e, const float* m2, int n,
+                    double* out) {
+  const float ax = a.fPx, ay = a.fPy, az = a.fPz, ae = a.fE, am2 = a.fM2;
+  int j = 0;
+
+#if defined(__AVX512F__)
+  const __m512 ax16 = _mm512_set1_ps(ax), ay16 = _mm512_set1_ps(ay),
+               az16 = _mm512_set1_ps(az), ae16 = _mm512_set1_ps(ae),
+               am216 = _mm512_set1_ps(am2), two16 = _mm512_set1_ps(2.f);
+  alignas(64) float masses[16];
+  for (; j + 16 <= n; j += 16) {
+    __m512 dot = _mm512_mul_ps(ae16, _mm512_loadu_ps(e + j));
+    dot = _mm512_fnmadd_ps(ax16, _mm512_loadu_ps(px + j), dot);
+    dot = _mm512_fnmadd_ps(ay16, _mm512_loadu_ps(py + j), dot);
+    dot = _mm512_fnmadd_ps(az16, _mm512_loadu_ps(pz + j), dot);
+    const __m512 masses2 = _mm512_add_ps(am216, _mm512_loadu_ps(m2 + j));
+    const __m512 sum = _mm512_fmadd_ps(two16, dot, masses2);
+    // widened to double half by half through memory: with gcc 12 the
+    // register extracts and the unmasked forms warn about undefined sources
+    _mm512_store_ps(masses, _mm512_mask_sqrt_ps(sum, 0xFFFF, sum));
+    _mm512_storeu_pd(out + j,
+                     _mm512_maskz_cvtps_pd(0xFF, _mm256_load_ps(masses)));
+    _mm512_storeu_pd(out + j + 8,
+                     _mm512_maskz_cvtps_pd(0xFF, _mm256_load_ps(masses + 8)));
+  }
+#elif defined(__AVX2__)
+  const __m256 ax8 = _mm256_set1_ps(ax), ay8 = _mm256_set1_ps(ay),
+               az8 = _mm256_set1_ps(az), ae8 = _mm256_set1_ps(ae),
+               am28 = _mm256_set1_ps(am2), two8 = _mm256_set1_ps(2.f);
+  for (; j + 8 <= n; j += 8) {
+    __m256 dot = _mm256_mul_ps(ae8, _mm256_loadu_ps(e + j));
+    dot = _mm256_sub_ps(dot, _mm256_mul_ps(ax8, _mm256_loadu_ps(px + j)));
+    dot = _mm256_sub_ps(dot, _mm256_mul_ps(ay8, _mm256_loadu_ps(py + j)));
+    dot = _mm256_sub_ps(dot, _mm256_mul_ps(az8, _mm256_loadu_ps(pz + j)));
+    const __m256 masses2 = _mm256_add_ps(am28, _mm256_loadu_ps(m2 + j));
+    const __m256 m =
+        _mm256_sqrt_ps(_mm256_add_ps(masses2, _mm256_mul_ps(two8, dot)));
+    _mm256_storeu_pd(out + j, _mm256_cvtps_pd(_mm256_castps256_ps128(m)));
+    _mm256_storeu_pd(out + j + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(m, 1)));
+  }
+#endif
+
+  // scalar fallback and remainder
+  for (; j < n; j++) {
+    const float dot = ae * e[j] - ax * px[j] - ay * py[j] - az * pz[j];
+    out[j] = std::sqrt(am2 + m2[j] + 2.f * dot);
+  }
+}
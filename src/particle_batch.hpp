@@ -0,0 +1,64 @@
+#pragma once
+
+#include <vector>
+
+#include "particle.hpp"
+
+// Arithmetic of the pair kernels. DOUBLE is the reference; FLOAT stores the
+// momenta in single precision and computes twice as many pairs per vector,
+// within the errors measured by the precision report of bench.
+enum class PairPrecision { DOUBLE, FLOAT };
+
+// "double" or "float", false for anything else
+bool parsePairPrecision(const char* name, PairPrecision& precision);
+const char* pairPrecisionName(PairPrecision precision);
+
+// Structure-of-arrays copy of the particles of an event. Every property is
+// stored in its own contiguous array so that pair kernels can stream through
+// a block of partners with vector loads. Momenta, energies and squared masses
+// are also kept in single precision for the float pair kernel.
+class ParticleBatch {
+ private:
+  std::vector<double> fPx, fPy, fPz, fE, fM2;
+  std::vector<float> fPxFloat, fPyFloat, fPzFloat, fEFloat, fM2Float;
+  std::vector<TypeId> fType;
+
+ public:
+  void Clear();
+  void Reserve(int n);
+  void Resize(int n);
+  void Push(Particle const& particle);
+  void Set(int index, Particle const& particle);
+  void Set(int index, TypeId type, FourMomentum const& p);
+  int Size() const;
+  const double* Px() const;
+  const double* Py() const;
+  const double* Pz() const;
+  const double* E() const;
+  const double* M2() const;
+  const TypeId* Type() const;
+  const float* PxFloat() const;
+  const float* PyFloat() const;
+  const float* PzFloat() const;
+  const float* EFloat() const;
+  const float* M2Float() const;
+  FourMomentum GetFourMomentum(int index) const;
+};
+
+// Computes the invariant mass of particle i paired with every particle in
+// [begin, end) and stores it in out[0, end - begin), with the arithmetic of
+// precision. Uses AVX-512 or AVX2 when the compiler targets them, scalar
+// code otherwise.
+void invMassRow(ParticleBatch const& batch, int i, int begin, int end,
+                double* out, PairPrecision precision = PairPrecision::DOUBLE);
+// Same as invMassRow, for a particle a paired with the n particles whose
+// momenta, energies and squared masses are in px, py, pz, e and m2. The mass
+// is computed as invMass2 does, from the stored masses.
+void invMassAgainst(FourMomentum const& a, const double* px, const double* py,
+                    const double* pz, const double* e, const double* m2, int n,
+                    double* out);
+// single precision version, a is rounded to float and the masses are
+// widened to double when stored
+void invMassAgainst(FourMomentum const& a, const float* px, const float* py,
+                    const float* pz, const float* e, const float* m2, int n,
+                    double* out);
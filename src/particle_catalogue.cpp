@@ -0,0 +1,90 @@
+#include "particle_catalogue.hpp"
+
+#include <vector>
+
+// A species of the simulation: its type and the fraction of the generated
+// particles it makes up
+struct Species {
+  const char* fName;
+  double fMass;
+  int fCharge;
+  double fWidth;
+  double fAbundance;
+};
+
+static const Species SPECIES[] = {
+    {"pione+", 0.13957, 1, 0., 0.4},       //
+    {"pione-", 0.13957, -1, 0., 0.4},      //
+    {"kaone+", 0.49367, 1, 0., 0.05},      //
+    {"kaone-", 0.49367, -1, 0., 0.05},     //
+    {"protone+", 0.93827, 1, 0., 0.045},   //
+    {"protone-", 0.93827, -1, 0., 0.045},  //
+    {"k*", 0.89166, 0, 0.05, 0.01}};
+
+// A two body decay channel of an unstable species
+struct Decay {
+  const char* fMother;
+  const char* fDau1;
+  const char* fDau2;
+  double fBranchingRatio;
+};
+
+static const Decay DECAYS[] = {{"k*", "kaone-", "pione+", 0.5},
+                               {"k*", "kaone+", "pione-", 0.5}};
+
+ParticleIds addParticleTypes() {
+  for (auto const& species : SPECIES) {
+    Particle::AddParticleType(species.fName, species.fMass, species.fCharge,
+                              species.fWidth);
+  }
+  for (auto const& decay : DECAYS) {
+    Particle::AddDecayChannel(Particle::FindParticle(decay.fMother),
+                              Particle::FindParticle(decay.fDau1),
+                              Particle::FindParticle(decay.fDau2),
+                              decay.fBranchingRatio);
+  }
+  // types registered before keep their abundance of 0
+  std::vector<double> abundances(Particle::GetParticleTable().Size(), 0.);
+  for (auto const& species : SPECIES) {
+    abundances[Particle::FindParticle(species.fName)] = species.fAbundance;
+  }
+  ParticleIds ids;
+  ids.pioneP = Particle::FindParticle("pione+");
+  ids.pioneN = Particle::FindParticle("pione-");
+  ids.kaoneP = Particle::FindParticle("kaone+");
+  ids.kaoneN = Particle::FindParticle("kaone-");
+  ids.protoneP = Particle::FindParticle("protone+");
+  ids.protoneN = Particle::FindParticle("protone-");
+  ids.kStar = Particle::FindParticle("k*");
+  ids.abundances = AliasTable(abundances);
+  return ids;
+}
+
+PairCategoryTable buildPairCategories(ParticleIds const& ids) {
+  ParticleTable const& table = Particle::GetParticleTable();
+  PairCategoryTable categories(table.Size());
+  for (int a = 0; a < table.Size(); a++) {
+    for (int b = a; b < table.Size(); b++) {
+      const bool discordant = table[a].fCharge == -table[b].fCharge;
+      categories.Add(a, b, discordant ? DISCORDANT : CONCORDANT);
+    }
+  }
+  const TypeId pions[] = {ids.pioneP, ids.pioneN};
+  const TypeId kaons[] = {ids.kaoneP, ids.kaoneN};
+  for (TypeId pion : pions) {
+    for (TypeId kaon : kaons) {
+      const bool discordant = table[pion].fCharge == -table[kaon].fCharge;
+      categories.Add(pion, kaon, discordant ? DISCORDANT_PK : CONCORDANT_PK);
+    }
+  }
+  return categories;
+}
+
+double speciesFraction(std::string const& name) {
+  double total = 0., abundance = 0.;
+  for (auto const& species : SPECIES) {
+    total += species.fAbundance;
+    if (name == species.fName) abundance = species.fAbundance;
+  }
+  return abundance / total;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+
+#include "alias_table.hpp"
+#include "pair_categories.hpp"
+#include "particle.hpp"
+#include "rng.hpp"
+
+// Handles of the particle types used by the simulation, and the sampler of
+// the type of every generated particle
+struct ParticleIds {
+  TypeId pioneP, pioneN, kaoneP, kaoneN, protoneP, protoneN, kStar;
+  // abundances of all the registered types, indexed by TypeId
+  AliasTable abundances;
+};
+
+// categories of pairs filled besides inv-mass, one bit each
+enum PairCategory : unsigned {
+  DISCORDANT = 1u << 0,
+  CONCORDANT = 1u << 1,
+  DISCORDANT_PK = 1u << 2,
+  CONCORDANT_PK = 1u << 3
+};
+const int N_PAIR_CATEGORIES = 4;
+
+// Registers the particle types of the simulation and returns their handles.
+// The types and their abundances are listed in particle_catalogue.cpp.
+ParticleIds addParticleTypes();
+PairCategoryTable buildPairCategories(ParticleIds const& ids);
+// fraction of the generated particles that are of the species called name,
+// 0 if it is not generated
+double speciesFraction(std::string const& name);
+
+inline TypeId determineParticleType(ParticleIds const& ids, Rng& rng) {
+  return ids.abundances.Sample(rng);
+}
@@ -0,0 +1,42 @@
+#include "particle_table.hpp"
+
+ParticleTable::ParticleTable(ParticleType const* const* types, int nTypes)
+    : fChannelOffsets{0} {
+  fProperties.reserve(nTypes);
+  for (int i = 0; i < nTypes; i++) {
+    const ParticleType& type = *types[i];
+    const double mass = type.GetMass();
+    fProperties.push_back({mass, mass * mass, type.GetWidth(),
+                           type.GetCharge(), static_cast<int>(fNames.size())});
+    // names are stored back to back, each one null terminated
+    fNames += type.GetName();
+    fNames += '\0';
+
+    double total = 0.;
+    for (auto const& channel : type.GetDecayChannels()) {
+      total += channel.fBranchingRatio;
+    }
+    double cumulative = 0.;
+    for (auto const& channel : type.GetDecayChannels()) {
+      cumulative += channel.fBranchingRatio / total;
+      fChannels.push_back({cumulative, channel.fDau1, channel.fDau2});
+    }
+    if (fChannels.size() > (size_t)fChannelOffsets.back()) {
+      // no rounding left over at the end of the last channel
+      fChannels.back().fCumulative = 1.;
+    }
+    fChannelOffsets.push_back(fChannels.size());
+  }
+}
+
+int ParticleTable::Size() const {
+  return fProperties.size();
+}
+
+ParticleProperties const& ParticleTable::operator[](int index) const {
+  return fProperties[index];
+}
+
+const char* ParticleTable::GetName(int index) const {
+  return fNames.c_str() + fProperties[index].fNameOffset;
+}
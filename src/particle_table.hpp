@@ -0,0 +1,52 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "particle_type.hpp"
+
+// Flattened properties of a particle type. Two entries fit in a cache line.
+struct alignas(32) ParticleProperties {
+  double fMass;
+  double fMass2;
+  double fWidth;
+  int fCharge;
+  int fNameOffset;
+};
+
+// Decay channel of a type in a ParticleTable. Channels of the same type are
+// consecutive and fCumulative is the sum of their normalized branching
+// ratios up to this one, so the last channel of a type has 1.
+struct TableDecayChannel {
+  double fCumulative;
+  int fDau1, fDau2;
+};
+
+// Immutable snapshot of the registered particle types, indexed directly by
+// TypeId. It holds plain data only, so it can be read by any number of threads
+// without locking as long as nobody rebuilds it.
+class ParticleTable {
+ private:
+  std::vector<ParticleProperties> fProperties;
+  std::string fNames;
+  std::vector<TableDecayChannel> fChannels;
+  // the channels of type t are in [fChannelOffsets[t], fChannelOffsets[t + 1])
+  std::vector<int> fChannelOffsets;
+
+ public:
+  ParticleTable() = default;
+  ParticleTable(ParticleType const* const* types, int nTypes);
+  int Size() const;
+  ParticleProperties const& operator[](int index) const;
+  const char* GetName(int index) const;
+  bool IsUnstable(int index) const {
+    return fChannelOffsets[index + 1] > fChannelOffsets[index];
+  }
+  // channel of an unstable type for a uniform number u in [0, 1)
+  TableDecayChannel const& ChooseChannel(int index, double u) const {
+    int c = fChannelOffsets[index];
+    const int last = fChannelOffsets[index + 1] - 1;
+    while (c < last && u >= fChannels[c].fCumulative) c++;
+    return fChannels[c];
+  }
+};
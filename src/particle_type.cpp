@@ -26,7 +26,12 @@ double ParticleType::GetWidth() const {
   return 0;
 }
 
-std::string ParticleType::GetName() const {
+std::vector<DecayChannel> const& ParticleType::GetDecayChannels() const {
+  static const std::vector<DecayChannel> stable;
+  return stable;
+}
+
+std::string const& ParticleType::GetName() const {
   return fName;
 }
 
@@ -1,6 +1,14 @@
 #pragma once
 
 #include <string>
+#include <vector>
+
+// Two body decay into the types fDau1 and fDau2 (indices in the particle
+// registry), chosen with probability proportional to fBranchingRatio
+struct DecayChannel {
+  int fDau1, fDau2;
+  double fBranchingRatio;
+};
 
 class ParticleType {
  private:
@@ -13,7 +21,9 @@ class ParticleType {
   virtual ~ParticleType();
   virtual void Print() const;
   virtual double GetWidth() const;
-  std::string GetName() const;
+  // decay channels, none for stable particles
+  virtual std::vector<DecayChannel> const& GetDecayChannels() const;
+  std::string const& GetName() const;
   double GetMass() const;
   int GetCharge() const;
 };
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "reference_simulation.hpp"
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "constants.hpp"
+#include "decay_arena.hpp"
+#include "event_simulation.hpp"
+#include "particle.hpp"
+#include "rng.hpp"
+
+// decays mother, and its unstable daughters in turn, adding the stable
+// daughters to finals
+static void decayCascade(Particle const& mother, int generation, Rng& rng,
+                         SimulationHistos& histos,
+                         std::vector<Particle>& finals) {
+  ParticleTable const& table = Particle::GetParticleTable();
+  TableDecayChannel const& channel =
+      table.ChooseChannel(mother.GetParticleType(), rng.Rndm());
+  Particle dau1(channel.fDau1), dau2(channel.fDau2);
+  try {
+    mother.Decay2body(dau1, dau2, rng);
+  } catch (std::runtime_error const&) {
+    // below threshold, no daughters
+    return;
+  }
+  histos.invMassSibDecayDist.Fill(dau1.InvMass(dau2));
+  for (Particle const& daughter : {dau1, dau2}) {
+    if (!table.IsUnstable(daughter.GetParticleType())) {
+      finals.push_back(daughter);
+    } else if (generation + 1 < MAX_DECAY_GENERATIONS) {
+      decayCascade(daughter, generation + 1, rng, histos, finals);
+    }
+  }
+}
+
+void simulateEventsReference(int firstEvent, int lastEvent, uint64_t seed,
+                             ParticleIds const& ids,
+                             SimulationHistos& histos) {
+  ParticleTable const& table = Particle::GetParticleTable();
+  std::vector<Particle> eventParticles;
+  for (int event = firstEvent; event < lastEvent; event++) {
+    Rng typeRng(seed, event, TYPE_STREAM);
+    Rng rng(seed, event, KINEMATICS_STREAM);
+    Rng decayRng(seed, event, DECAY_STREAM);
+    eventParticles.clear();
+    histos.eventsHisto.Fill(EVENTS_BIN);
+    histos.eventsHisto.Fill(PARTICLES_BIN, N_PARTICLES);
+    // resonances count as their two daughters
+    int nParticles = 0;
+    while (nParticles <= N_PARTICLES) {
+      const TypeId type = determineParticleType(ids, typeRng);
+      const double phi = rng.Uniform(0., 2 * M_PI);
+      const double theta = rng.Uniform(0., M_PI);
+      const double pulse = rng.Exp(1.);
+
+      // compute pulse components
+      const double px = pulse * std::sin(theta) * std::cos(phi);
+      const double py = pulse * std::sin(theta) * std::sin(phi);
+      const double pz = pulse * std::cos(theta);
+      const Particle particle(type, px, py, pz);
+
+      // fill histos
+      histos.particleTypesHisto.Fill(type);
+      histos.zenithDist.Fill(theta);
+      histos.azimuthDist.Fill(phi);
+      histos.pulseDist.Fill(pulse);
+      histos.traversePulseDist.Fill(std::hypot(px, py));
+      histos.particleEnergyDist.Fill(particle.TotalEnergy());
+
+      if (table.IsUnstable(type)) {
+        nParticles += 2;
+        decayCascade(particle, 0, decayRng, histos, eventParticles);
+      } else {
+        nParticles++;
+        eventParticles.push_back(particle);
+      }
+    }
+
+    const int n = eventParticles.size();
+    for (int i = 0; i < n - 1; i++) {
+      Particle const& a = eventParticles[i];
+      for (int j = i + 1; j < n; j++) {
+        Particle const& b = eventParticles[j];
+
+        // compute invariant mass
+        const double invMass = a.InvMass(b);
+        histos.invMassDist.Fill(invMass);
+
+        // fill inv mass histos based on discordant/concordant charge
+        const bool discordant = a.GetCharge() == -b.GetCharge();
+        if (discordant) {
+          histos.invMassDiffChargeDist.Fill(invMass);
+        } else {
+          histos.invMassSameChargeDist.Fill(invMass);
+        }
+
+        // fill inv mass histos for pione-kaone pairs
+        const TypeId aType = a.GetParticleType(), bType = b.GetParticleType();
+        const bool aPione = aType == ids.pioneP || aType == ids.pioneN;
+        const bool aKaone = aType == ids.kaoneP || aType == ids.kaoneN;
+        const bool bPione = bType == ids.pioneP || bType == ids.pioneN;
+        const bool bKaone = bType == ids.kaoneP || bType == ids.kaoneN;
+        if ((aPione && bKaone) || (aKaone && bPione)) {
+          if (discordant) {
+            histos.invMassPioneKaoneDiscordantDist.Fill(invMass);
+          } else {
+            histos.invMassPioneKaoneConcordantDist.Fill(invMass);
+          }
+        }
+      }
+    }
+  }
+}
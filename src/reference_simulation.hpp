@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+#include "particle_catalogue.hpp"
+#include "simulation_histos.hpp"
+
+// Straightforward version of simulateEvents, written like the first
+// simulation: one particle at a time, libm for the kinematics,
+// Particle::Decay2body for the decays and an if chain per pair instead of
+// the category table. It is slow but easy to check by eye, and is the
+// reference the engine is validated against. It fills the twelve
+// histograms of a plain run: no mixing, event files or configured
+// categories.
+void simulateEventsReference(int firstEvent, int lastEvent, uint64_t seed,
+                             ParticleIds const& ids, SimulationHistos& histos);
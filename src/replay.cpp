@@ -0,0 +1,173 @@
+#include <TFile.h>
+#include <TH1D.h>
+#include <TROOT.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "event_mixing.hpp"
+#include "event_replay.hpp"
+#include "event_store.hpp"
+#include "pair_categories.hpp"
+#include "pair_config.hpp"
+#include "particle.hpp"
+#include "particle_catalogue.hpp"
+#include "simulation_histos.hpp"
+#include "util.hpp"
+
+struct ReplayOptions {
+  std::string inputPath;
+  std::string outputPath = "replay.root";
+  int nThreads = 1;
+  int mixDepth = 0;
+  long mixMemoryMb = 64;
+  std::string pairConfigPath;
+};
+
+bool parseArgs(int argc, char** argv, ReplayOptions& options);
+
+// Refills the simulation histograms from an event file written with
+// simulation --events, without generating the events again
+int main(int argc, char** argv) {
+  ReplayOptions options;
+  if (!parseArgs(argc, argv, options)) {
+    std::cout << "Usage: replay PATH [--output FILE] [--threads N] "
+                 "[--mix-depth K [--mix-memory MB]]\n"
+                 "              [--pair-config PATH]\n";
+    std::cout << "  PATH             event file written by simulation "
+                 "--events\n";
+    std::cout << "  --output FILE    histograms file (default replay.root)\n";
+    std::cout << "  --threads N      threads replaying the blocks of the file, "
+                 "0 to use all cores\n"
+                 "                   (default 1)\n";
+    std::cout << "  --mix-depth K    mix every event with the last K events "
+                 "(default 0, no mixing)\n";
+    std::cout << "  --mix-memory MB  memory of the event pool of every thread "
+                 "(default 64)\n";
+    std::cout << "                   every thread mixes its events with its "
+                 "own pool, so the\n"
+                 "                   mixed histograms depend on --threads\n";
+    std::cout << "  --pair-config PATH  also fill the pair categories declared "
+                 "in PATH\n";
+    return EXIT_FAILURE;
+  }
+
+  section("Initializing");
+  const ParticleIds ids = addParticleTypes();
+  Particle::FreezeParticleTypes();
+  PairCategoryTable categories = buildPairCategories(ids);
+  ROOT::EnableThreadSafety();
+  TH1::AddDirectory(kFALSE);
+  std::vector<PairCategoryConfig> pairCategories;
+  try {
+    if (!options.pairConfigPath.empty()) {
+      pairCategories = readPairConfig(options.pairConfigPath);
+    }
+    compilePairCategories(pairCategories, N_PAIR_CATEGORIES, categories);
+    validatePairCategories(pairCategories);
+  } catch (std::exception const& error) {
+    std::cout << error.what() << "\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    EventStoreReader reader(options.inputPath);
+    if (reader.GetNTypes() != Particle::GetParticleTable().Size()) {
+      std::cout << options.inputPath
+                << " was written with different particle types\n";
+      return EXIT_FAILURE;
+    }
+    std::cout << "Reading " << reader.GetNEvents() << " events in "
+              << reader.NBlocks() << " blocks\n";
+
+    // every thread replays a run of consecutive blocks into its own
+    // histograms, which are added up in thread order
+    int nThreads = options.nThreads;
+    if (nThreads == 0) {
+      nThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    nThreads = std::max(1, std::min(nThreads, reader.NBlocks()));
+    std::vector<std::unique_ptr<SimulationHistos>> histos;
+    std::vector<std::unique_ptr<EventPool>> pools(nThreads);
+    for (int t = 0; t < nThreads; t++) {
+      histos.push_back(std::make_unique<SimulationHistos>(pairCategories));
+      if (options.mixDepth > 0) {
+        pools[t] = std::make_unique<EventPool>(
+            options.mixDepth, reader.GetNTypes(), options.mixMemoryMb << 20);
+      }
+    }
+    std::cout << "Replaying on " << nThreads << " thread(s)\n";
+
+    section("Replay");
+    const auto start = std::chrono::steady_clock::now();
+    const std::vector<int> bounds = splitBlocks(reader, nThreads);
+    auto runWorker = [&](int t) {
+      replayEvents(reader, bounds[t], bounds[t + 1], categories,
+                   pools[t].get(), *histos[t]);
+    };
+    std::vector<std::thread> workers;
+    for (int t = 1; t < nThreads; t++) {
+      workers.emplace_back(runWorker, t);
+    }
+    runWorker(0);
+    for (auto& worker : workers) {
+      worker.join();
+    }
+    for (int t = 1; t < nThreads; t++) {
+      histos[0]->Add(*histos[t]);
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout << "Replayed " << reader.GetNEvents() << " events in "
+              << elapsed.count() << "s ("
+              << reader.GetNEvents() / elapsed.count() << " events/s)\n";
+
+    section("Saving to file");
+    TFile saveFile(options.outputPath.c_str(), "RECREATE");
+    if (!saveFile.IsOpen()) {
+      std::cout << "Unable to open " << options.outputPath << " file\n";
+      return EXIT_FAILURE;
+    }
+    saveFile.Save();
+    histos[0]->Write();
+    saveFile.Close();
+    std::cout << "Saved to " << options.outputPath << "\n";
+  } catch (std::exception const& error) {
+    std::cout << error.what() << "\n";
+    return EXIT_FAILURE;
+  }
+}
+
+bool parseArgs(int argc, char** argv, ReplayOptions& options) {
+  try {
+    for (int i = 1; i < argc; i++) {
+      if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+        options.outputPath = argv[++i];
+      } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+        options.nThreads = std::stoi(argv[++i]);
+        if (options.nThreads < 0) return false;
+      } else if (std::strcmp(argv[i], "--mix-depth") == 0 && i + 1 < argc) {
+        options.mixDepth = std::stoi(argv[++i]);
+        if (options.mixDepth < 0) return false;
+      } else if (std::strcmp(argv[i], "--mix-memory") == 0 && i + 1 < argc) {
+        options.mixMemoryMb = std::stol(argv[++i]);
+        if (options.mixMemoryMb <= 0) return false;
+      } else if (std::strcmp(argv[i], "--pair-config") == 0 && i + 1 < argc) {
+        options.pairConfigPath = argv[++i];
+      } else if (argv[i][0] != '-' && options.inputPath.empty()) {
+        options.inputPath = argv[i];
+      } else {
+        return false;
+      }
+    }
+  } catch (std::exception const&) {
+    return false;
+  }
+  return !options.inputPath.empty();
+}
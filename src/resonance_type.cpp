@@ -18,7 +18,22 @@ double ResonanceType::GetWidth() const {
   return fWidth;
 }
 
+std::vector<DecayChannel> const& ResonanceType::GetDecayChannels() const {
+  return fChannels;
+}
+
+void ResonanceType::AddDecayChannel(DecayChannel const& channel) {
+  if (!(channel.fBranchingRatio > 0.)) {
+    throw std::invalid_argument("branching ratio must be positive");
+  }
+  fChannels.push_back(channel);
+}
+
 void ResonanceType::Print() const {
   ParticleType::Print();
   std::cout << "width: " << fWidth << "\n";
+  for (auto const& channel : fChannels) {
+    std::cout << "channel: " << channel.fDau1 << " " << channel.fDau2
+              << ", branching ratio " << channel.fBranchingRatio << "\n";
+  }
 }
\ No newline at end of file
@@ -5,10 +5,13 @@
 class ResonanceType : public ParticleType {
  private:
   const double fWidth;
+  std::vector<DecayChannel> fChannels;
 
  public:
   ResonanceType(std::string name, double mass, int charge, double width);
   virtual ~ResonanceType();
   virtual void Print() const;
   virtual double GetWidth() const;
+  virtual std::vector<DecayChannel> const& GetDecayChannels() const;
+  void AddDecayChannel(DecayChannel const& channel);
 };
\ No newline at end of file
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+// Philox4x32-10 counter-based generator (Salmon et al., "Parallel random
+// numbers: as easy as 1, 2, 3"). It has no state: every call maps a 128 bit
+// counter and a 64 bit key to 128 random bits.
+struct Philox4x32 {
+  using Counter = std::array<uint32_t, 4>;
+  using Key = std::array<uint32_t, 2>;
+
+  static Counter Generate(Counter ctr, Key key) {
+    for (int round = 0; round < 10; round++) {
+      const uint64_t p0 = static_cast<uint64_t>(0xD2511F53u) * ctr[0];
+      const uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57u) * ctr[2];
+      ctr = {static_cast<uint32_t>(p1 >> 32) ^ ctr[1] ^ key[0],
+             static_cast<uint32_t>(p1),
+             static_cast<uint32_t>(p0 >> 32) ^ ctr[3] ^ key[1],
+             static_cast<uint32_t>(p0)};
+      key[0] += 0x9E3779B9u;
+      key[1] += 0xBB67AE85u;
+    }
+    return ctr;
+  }
+};
+
+// Random stream identified by (run seed, event number, stream). Any event can
+// be regenerated on its own, on any thread, with bit-identical results. The
+// Engine must provide the Counter, Key and Generate of Philox4x32.
+template <class Engine>
+class CounterRng {
+ private:
+  typename Engine::Key fKey;
+  typename Engine::Counter fCounter;
+  typename Engine::Counter fBlock;
+  int fUsed;
+  bool fHasGaus;
+  double fGaus;
+
+  uint32_t Next32() {
+    if (fUsed == 4) {
+      fBlock = Engine::Generate(fCounter, fKey);
+      fCounter[0]++;
+      fUsed = 0;
+    }
+    return fBlock[fUsed++];
+  }
+
+  static double ToDouble(uint32_t high, uint32_t low) {
+    const uint64_t bits = (static_cast<uint64_t>(high) << 32) | low;
+    return (bits >> 11) * 0x1.0p-53;
+  }
+
+ public:
+  CounterRng(uint64_t seed, uint64_t event, uint32_t stream = 0)
+      : fKey{static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32)},
+        fCounter{0u, stream, static_cast<uint32_t>(event),
+                 static_cast<uint32_t>(event >> 32)},
+        fBlock{},
+        fUsed{4},
+        fHasGaus{false},
+        fGaus{0.} {
+  }
+
+  // uniform in [0, 1) with 53 random bits
+  double Rndm() {
+    const uint32_t high = Next32();
+    return ToDouble(high, Next32());
+  }
+
+  // n values of Rndm() at once, the same sequence as n calls. Whole blocks
+  // are generated from independent counters, so the rounds of consecutive
+  // blocks can overlap in the pipeline.
+  void Rndm(double* out, int n) {
+    int i = 0;
+    for (; i < n && fUsed < 4; i++) {
+      out[i] = Rndm();
+    }
+    for (; i + 2 <= n; i += 2) {
+      const auto block = Engine::Generate(fCounter, fKey);
+      fCounter[0]++;
+      out[i] = ToDouble(block[0], block[1]);
+      out[i + 1] = ToDouble(block[2], block[3]);
+    }
+    for (; i < n; i++) {
+      out[i] = Rndm();
+    }
+  }
+
+  double Uniform(double a, double b) {
+    return a + (b - a) * Rndm();
+  }
+
+  double Exp(double tau) {
+    // 1 - Rndm() is in (0, 1], so the logarithm is always finite
+    return -tau * std::log(1. - Rndm());
+  }
+
+  // Box-Muller, the second value of every pair is kept for the next call
+  double Gaus(double mean = 0., double sigma = 1.) {
+    if (fHasGaus) {
+      fHasGaus = false;
+      return mean + sigma * fGaus;
+    }
+    const double r = std::sqrt(-2. * std::log(1. - Rndm()));
+    const double phi = 2. * M_PI * Rndm();
+    fGaus = r * std::sin(phi);
+    fHasGaus = true;
+    return mean + sigma * r * std::cos(phi);
+  }
+
+  // multiplication method for small means, transformed rejection (Hormann,
+  // "The transformed rejection method for generating Poisson random
+  // variables") for large ones
+  long Poisson(double mean) {
+    if (mean <= 0.) return 0;
+    if (mean < 10.) {
+      const double limit = std::exp(-mean);
+      long k = 0;
+      double product = Rndm();
+      while (product > limit) {
+        k++;
+        product *= Rndm();
+      }
+      return k;
+    }
+    const double smu = std::sqrt(mean);
+    const double b = 0.931 + 2.53 * smu;
+    const double a = -0.059 + 0.02483 * b;
+    const double invAlpha = 1.1239 + 1.1328 / (b - 3.4);
+    const double vr = 0.9277 - 3.6224 / (b - 2.);
+    while (true) {
+      const double u = Rndm() - 0.5;
+      const double v = Rndm();
+      const double us = 0.5 - std::abs(u);
+      const long k = std::floor((2. * a / us + b) * u + mean + 0.43);
+      if (us >= 0.07 && v <= vr) return k;
+      if (k < 0 || (us < 0.013 && v > us)) continue;
+      if (std::log(v) + std::log(invAlpha) - std::log(a / (us * us) + b) <=
+          -mean + k * std::log(mean) - std::lgamma(k + 1.)) {
+        return k;
+      }
+    }
+  }
+
+  void Uniform(double* out, int n, double a = 0., double b = 1.) {
+    Rndm(out, n);
+    for (int i = 0; i < n; i++) {
+      out[i] = a + (b - a) * out[i];
+    }
+  }
+
+  void Exp(double* out, int n, double tau) {
+    Rndm(out, n);
+    for (int i = 0; i < n; i++) {
+      out[i] = -tau * std::log(1. - out[i]);
+    }
+  }
+
+  void Gaus(double* out, int n, double mean = 0., double sigma = 1.) {
+    for (int i = 0; i < n; i++) {
+      out[i] = Gaus(mean, sigma);
+    }
+  }
+};
+
+using Rng = CounterRng<Philox4x32>;
+
+// Standard normal from two uniforms in [0, 1) by Box-Muller, cosine branch
+// only. It depends on its arguments alone, so that loops over arrays of
+// uniforms drawn beforehand can be vectorized.
+inline double boxMuller(double u1, double u2) {
+  return std::sqrt(-2. * std::log(1. - u1)) * std::cos(2. * M_PI * u2);
+}
@@ -1,234 +1,463 @@
 #include <TFile.h>
 #include <TH1D.h>
-#include <TRandom.h>
+#include <TROOT.h>
 #include <TStopwatch.h>
 
-#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <random>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "constants.hpp"
+#include "checkpoint.hpp"
+#include "event_mixing.hpp"
+#include "event_simulation.hpp"
+#include "instrumentation.hpp"
+#include "pair_categories.hpp"
+#include "pair_config.hpp"
 #include "particle.hpp"
-#include "particle_type.hpp"
-#include "resonance_type.hpp"
+#include "particle_catalogue.hpp"
+#include "simulation_histos.hpp"
 #include "util.hpp"
 
-const double PI2 = 2 * M_PI;
+struct SimulationOptions {
+  int nThreads = 1;
+  uint64_t seed = 0;
+  bool hasSeed = false;
+  std::string reportPath;
+  std::string eventsPath;
+  std::string checkpointPath;
+  int checkpointInterval = 60;
+  bool resume = false;
+  int mixDepth = 0;
+  long mixMemoryMb = 64;
+  int nEvents = static_cast<int>(N_EVENTS);
+  int shard = 0;
+  int nShards = 1;
+  std::string outputPath;
+  std::string pairConfigPath;
+  int nParticles = N_PARTICLES;
+  PairLoopOptions pairLoop;
+};
 
-inline const char* determineParticleType();
+bool parseArgs(int argc, char** argv, SimulationOptions& options);
 
-int main() {
+int main(int argc, char** argv) {
   TStopwatch timer;
 
+  SimulationOptions options;
+  if (!parseArgs(argc, argv, options)) {
+    std::cout
+        << "Usage: simulation [--threads N] [--seed S] [--report PATH] "
+           "[--events PATH]\n"
+           "                  [--checkpoint PATH [--checkpoint-interval S] "
+           "[--resume]]\n"
+           "                  [--mix-depth K [--mix-memory MB]]\n"
+           "                  [--n-events N] [--shard I/N --seed S] "
+           "[--output FILE]\n"
+           "                  [--pair-config PATH] [--pair-precision P]\n"
+           "                  [--pair-fraction F] [--pair-threads N] "
+           "[--particles N]\n";
+    std::cout << "  --threads N    number of worker threads, 0 to use all "
+                 "cores (default 1)\n";
+    std::cout << "  --seed S       run seed, random if not given\n";
+    std::cout << "  --report PATH  also write the run summary as JSON\n";
+    std::cout << "  --events PATH  also write the particles of every event to "
+                 "an event file\n";
+    std::cout << "  --checkpoint PATH        save the run state to PATH "
+                 "periodically\n";
+    std::cout << "  --checkpoint-interval S  seconds between checkpoints "
+                 "(default 60)\n";
+    std::cout << "  --resume                 continue the run saved in the "
+                 "checkpoint\n";
+    std::cout << "  --mix-depth K            mix every event with the last K "
+                 "events of its\n"
+                 "                           thread (default 0, none); mixed "
+                 "histograms change\n"
+                 "                           with --threads, --shard and "
+                 "--resume\n";
+    std::cout << "  --mix-memory MB          event pool memory of every thread "
+                 "(default 64)\n";
+    std::cout << "  --n-events N   events of the whole run (default "
+              << N_EVENTS << ")\n";
+    std::cout << "  --shard I/N    simulate only the I-th of N parts of the "
+                 "run, from 0\n";
+    std::cout << "  --output FILE  histograms file (default " << SAVE_FILE
+              << ", histos-shard-I.root for shards)\n";
+    std::cout << "  --pair-config PATH  also fill the pair categories declared "
+                 "in PATH\n";
+    std::cout << "  --pair-precision P  arithmetic of the pair invariant "
+                 "masses, double or float\n"
+                 "                      (default double)\n";
+    std::cout << "  --pair-fraction F   fill a random fraction F of the pairs "
+                 "of every event,\n"
+                 "                      weighted to keep the histograms "
+                 "unbiased (default 1)\n";
+    std::cout << "  --pair-threads N    threads sharing the pairs of every "
+                 "event, 0 to share the\n"
+                 "                      cores among the worker threads, for "
+                 "events of thousands\n"
+                 "                      of particles (default 1)\n";
+    std::cout << "  --particles N  particles of every event (default "
+              << N_PARTICLES << ")\n";
+    return EXIT_FAILURE;
+  }
+  int nThreads = options.nThreads;
+  if (nThreads == 0) {
+    nThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  // events are generated from (seed, event number), so the same seed gives
+  // the same histograms whatever the number of threads
+  uint64_t seed =
+      options.hasSeed ? options.seed
+                      : (static_cast<uint64_t>(std::random_device{}()) << 32) |
+                            std::random_device{}();
+
   section("Initializing");
   // create particle types and cache their index/id localy
-  const int pioneP = Particle::AddParticleType("pione+", 0.13957, 1);
-  const int pioneN = Particle::AddParticleType("pione-", 0.13957, -1);
-  const int kaoneP = Particle::AddParticleType("kaone+", 0.49367, 1);
-  const int kaoneN = Particle::AddParticleType("kaone-", 0.49367, -1);
-  const int protoneP = Particle::AddParticleType("protone+", 0.93827, 1);
-  const int protoneN = Particle::AddParticleType("protone-", 0.93827, -1);
-  const int kStar = Particle::AddParticleType("k*", 0.89166, 0, 0.05);
-
-  // get rid of unused variable warning
-  (void)protoneP;
-  (void)protoneN;
-
-  gRandom->SetSeed();
-
-  std::vector<Particle> eventParticles;
-  double phi, theta, pulse;
-  double px, py, pz;
-  Double_t edgesParticleTypesHisto[8] = {0, 1, 2, 3, 4, 5, 6, 7};
-  TH1D particleTypesHisto(                                                   //
-      "particle-types",                                                      //
-      "Particle types;Type;Entries",                                         //
-      7, edgesParticleTypesHisto),                                           //
-      zenithDist(                                                            //
-          "zenith",                                                          //
-          "Zenith;Radians;Entries",                                          //
-          1000, 0., M_PI),                                                   //
-      azimuthDist(                                                           //
-          "azimuth",                                                         //
-          "Azimuth;Radians;Entries",                                         //
-          1000, 0., PI2),                                                    //
-      pulseDist(                                                             //
-          "pulse",                                                           //
-          "Pulse;Pulse;Entries",                                             //
-          1000, 0, 11),                                                      //
-      traversePulseDist(                                                     //
-          "traverse-pulse",                                                  //
-          "Traverse pulse;Traverse pulse;Entries",                           //
-          1000, 0., 10.),                                                    //
-      particleEnergyDist(                                                    //
-          "particle-energy",                                                 //
-          "Particle energy;Total energy;Entries",                            //
-          1000, 0., 10.),                                                    //
-      invMassDist(                                                           //
-          "inv-mass",                                                        //
-          "Inv. mass;Invariant mass;Entries",                                //
-          1000, 0, 10),                                                      //
-      invMassDiffChargeDist(                                                 //
-          "inv-mass-discordant",                                             //
-          "Inv. mass discrodant charge;Invariant mass;Entries",              //
-          1000, 0, 10),                                                      //
-      invMassSameChargeDist(                                                 //
-          "inv-mass-concordant",                                             //
-          "Inv. mass concordant charge;Invariant mass;Entries",              //
-          1000, 0, 10),                                                      //
-      invMassPioneKaoneDiscordantDist(                                       //
-          "inv-mass-discordant-pk",                                          //
-          "Inv. mass pione kaone discordant charge;Invariant mass;Entries",  //
-          1000, 0, 10),                                                      //
-      invMassPioneKaoneConcordantDist(                                       //
-          "inv-mass-concordant-pk",                                          //
-          "Inv. mass pione kaone concordant charge;Invariant mass;Entries",  //
-          1000, 0, 10),                                                      //
-      invMassSibDecayDist(                                                   //
-          "inv-mass-siblings",                                               //
-          "Inv. mass siblings;Invariant mass;Entries",                       //
-          1000, 0, 2);
-  auto* typesXAxis = particleTypesHisto.GetXaxis();
-  typesXAxis->SetBinLabel(1, "pione+");
-  typesXAxis->SetBinLabel(2, "pione-");
-  typesXAxis->SetBinLabel(3, "kaone+");
-  typesXAxis->SetBinLabel(4, "kaone-");
-  typesXAxis->SetBinLabel(5, "protone+");
-  typesXAxis->SetBinLabel(6, "protone-");
-  typesXAxis->SetBinLabel(7, "K*");
-
-  // init histos' weights
-  invMassDist.Sumw2();
-  invMassDiffChargeDist.Sumw2();
-  invMassSameChargeDist.Sumw2();
-  invMassPioneKaoneDiscordantDist.Sumw2();
-  invMassPioneKaoneConcordantDist.Sumw2();
-  invMassSibDecayDist.Sumw2();
-
-  section("Simulation");
-  timer.Start();
-  double completion = 0.0;
-  for (int i = 1; i <= N_EVENTS; i++) {
-    while (eventParticles.size() <= N_PARTICLES) {
-      phi = gRandom->Uniform(0., PI2);
-      theta = gRandom->Uniform(0., M_PI);
-      pulse = gRandom->Exp(1);
-
-      // compute pulse components
-      px = pulse * sin(theta) * cos(phi);
-      py = pulse * sin(theta) * sin(phi);
-      pz = pulse * cos(theta);
-
-      Particle particle(determineParticleType(), px, py, pz);
+  const ParticleIds ids = addParticleTypes();
+  Particle::FreezeParticleTypes();
+  PairCategoryTable categories = buildPairCategories(ids);
+  std::vector<PairCategoryConfig> pairCategories;
+  try {
+    if (!options.pairConfigPath.empty()) {
+      pairCategories = readPairConfig(options.pairConfigPath);
+    }
+    compilePairCategories(pairCategories, N_PAIR_CATEGORIES, categories);
+    validatePairCategories(pairCategories);
+  } catch (std::exception const& error) {
+    std::cout << error.what() << "\n";
+    return EXIT_FAILURE;
+  }
+  if (!pairCategories.empty()) {
+    std::cout << "Filling " << pairCategories.size()
+              << " configured pair categories\n";
+  }
 
-      // fill histos
-      particleTypesHisto.Fill(particle.GetParticleType());
-      zenithDist.Fill(theta);
-      azimuthDist.Fill(phi);
-      pulseDist.Fill(pulse);
-      traversePulseDist.Fill(hypot(px, py));
-      particleEnergyDist.Fill(particle.TotalEnergy());
+  // every worker owns its histograms, so they must not be registered in
+  // (and shared through) the current ROOT directory
+  ROOT::EnableThreadSafety();
+  TH1::AddDirectory(kFALSE);
 
-      // handle eventual decay and add particle(s) to vector
-      if (particle.GetParticleType() == kStar) {
-        if (gRandom->Rndm() < 0.5) {
-          eventParticles.push_back(Particle("pione+", px, py, pz));
-          eventParticles.push_back(Particle("kaone-", px, py, pz));
-        } else {
-          eventParticles.push_back(Particle("pione-", px, py, pz));
-          eventParticles.push_back(Particle("kaone+", px, py, pz));
-        }
-        auto& a = eventParticles[eventParticles.size() - 1];
-        auto& b = eventParticles[eventParticles.size() - 2];
-        particle.Decay2body(a, b);
-        invMassSibDecayDist.Fill(a.InvMass(b));
-      } else {
-        eventParticles.push_back(particle);
+  const int nEvents = options.nEvents;
+  // event numbers are global, so the shards of a run together generate
+  // exactly the events of the whole run
+  const EventRange shard =
+      shardEventRange(nEvents, options.shard, options.nShards);
+  const int nShardEvents = shard.fLast - shard.fFirst;
+  std::string outputPath = options.outputPath;
+  if (outputPath.empty() && options.nShards > 1) {
+    outputPath = concat("histos-shard-", options.shard, ".root");
+  } else if (outputPath.empty()) {
+    outputPath = SAVE_FILE;
+  }
+  std::vector<std::unique_ptr<SimulationHistos>> histos;
+  for (int t = 0; t < nThreads; t++) {
+    histos.push_back(std::make_unique<SimulationHistos>(pairCategories));
+  }
+  // contents of the checkpoint the run is resumed from
+  SimulationHistos resumed(pairCategories);
+  std::vector<EventRange> remaining{shard};
+  if (options.resume) {
+    try {
+      const Checkpoint checkpoint =
+          readCheckpoint(options.checkpointPath, resumed);
+      const bool inShard = std::all_of(
+          checkpoint.fRemaining.begin(), checkpoint.fRemaining.end(),
+          [&](EventRange const& range) {
+            return range.fFirst >= shard.fFirst && range.fLast <= shard.fLast;
+          });
+      PairLoopOptions const& pairLoop = options.pairLoop;
+      if (checkpoint.fNEvents != nEvents || !inShard ||
+          (options.hasSeed && checkpoint.fSeed != seed) ||
+          checkpoint.fNParticles != options.nParticles ||
+          checkpoint.fPairPrecision != pairLoop.fPrecision ||
+          checkpoint.fPairFraction != pairLoop.fFraction ||
+          checkpoint.fMixDepth != options.mixDepth ||
+          checkpoint.fMixMemoryMb != options.mixMemoryMb) {
+        std::cout << options.checkpointPath
+                  << " was saved by a run with other settings\n";
+        return EXIT_FAILURE;
       }
+      seed = checkpoint.fSeed;
+      remaining = checkpoint.fRemaining;
+    } catch (std::runtime_error const& error) {
+      std::cout << error.what() << "\n";
+      return EXIT_FAILURE;
     }
-
-    // fill histos
-    const int n = eventParticles.size();
-    for (int i = 0; i < n - 1; i++) {
-      const auto& a = eventParticles[i];
-      for (int j = i + 1; j < n; j++) {
-        const auto& b = eventParticles[j];
-
-        // compute invariant mass
-        const double invMass = a.InvMass(b);
-        invMassDist.Fill(invMass);
-
-        // fill inv mass histos based on discordant/concordant charge
-        if (a.GetCharge() == -b.GetCharge()) {
-          invMassDiffChargeDist.Fill(invMass);
-        } else {
-          invMassSameChargeDist.Fill(invMass);
-        }
-
-        // fill inv mass histos for pione-kaone pairs
-        const int aType = a.GetParticleType(), bType = b.GetParticleType();
-        if ((aType == pioneP && bType == kaoneN) ||
-            (aType == pioneN && bType == kaoneP) ||
-            (aType == kaoneP && bType == pioneN) ||
-            (aType == kaoneN && bType == pioneP)) {
-          invMassPioneKaoneDiscordantDist.Fill(invMass);
-        } else if ((aType == pioneP && bType == kaoneP) ||
-                   (aType == pioneN && bType == kaoneN) ||
-                   (aType == kaoneP && bType == pioneP) ||
-                   (aType == kaoneN && bType == pioneN)) {
-          invMassPioneKaoneConcordantDist.Fill(invMass);
-        }
+    std::cout << "Resuming with " << countEvents(remaining) << " of "
+              << nShardEvents << " events left\n";
+  }
+  const std::vector<std::vector<EventRange>> workerRanges =
+      splitEventRanges(remaining, nThreads);
+  std::vector<StageTimers> timers(nThreads);
+  std::unique_ptr<EventStoreWriter> store;
+  if (!options.eventsPath.empty()) {
+    try {
+      store = std::make_unique<EventStoreWriter>(
+          options.eventsPath, Particle::GetParticleTable().Size(),
+          options.nParticles, seed);
+    } catch (std::runtime_error const& error) {
+      std::cout << error.what() << "\n";
+      return EXIT_FAILURE;
+    }
+  }
+  // every worker mixes its events with its own pool
+  std::vector<std::unique_ptr<EventPool>> pools(nThreads);
+  if (options.mixDepth > 0) {
+    try {
+      for (auto& pool : pools) {
+        pool = std::make_unique<EventPool>(options.mixDepth,
+                                           Particle::GetParticleTable().Size(),
+                                           options.mixMemoryMb << 20);
       }
+    } catch (std::invalid_argument const& error) {
+      std::cout << error.what() << "\n";
+      return EXIT_FAILURE;
     }
+    std::cout << "Mixing every event with the last " << options.mixDepth
+              << " events, up to " << pools[0]->GetCapacity()
+              << " particles each\n";
+  }
+  if (options.nShards > 1) {
+    std::cout << "Shard " << options.shard << " of " << options.nShards
+              << ": events " << shard.fFirst << " to " << shard.fLast - 1
+              << " of " << nEvents << "\n";
+  }
+  std::cout << "Running on " << nThreads << " thread(s) with seed " << seed
+            << "\n";
+  PairLoopOptions& pairLoop = options.pairLoop;
+  if (pairLoop.fNThreads == 0) {
+    // every worker has its own pair threads: share the cores among them
+    const int nCores = std::max(1u, std::thread::hardware_concurrency());
+    pairLoop.fNThreads = std::max(1, nCores / nThreads);
+  }
+  if (options.nParticles != N_PARTICLES) {
+    std::cout << options.nParticles << " particles per event\n";
+  }
+  if (pairLoop.fPrecision != PairPrecision::DOUBLE) {
+    std::cout << "Pair invariant masses in "
+              << pairPrecisionName(pairLoop.fPrecision) << " precision\n";
+  }
+  if (pairLoop.fFraction < 1.) {
+    std::cout << "Sampling " << pairLoop.fFraction * 100.
+              << "% of the pairs of every event\n";
+  }
+  if (pairLoop.fNThreads > 1) {
+    std::cout << "Pairs of every event shared by " << pairLoop.fNThreads
+              << " threads\n";
+  }
 
-    eventParticles.clear();
-
-    completion = i / N_EVENTS * 100.;
-    printf("\r%.0f%% completed in %.3fs", completion, timer.RealTime());
+  section("Simulation");
+  timer.Start();
+  std::atomic<int> completed{nShardEvents - countEvents(remaining)};
+  std::unique_ptr<CheckpointWriter> checkpoints;
+  if (!options.checkpointPath.empty()) {
+    const Checkpoint run{seed,
+                         nEvents,
+                         options.nParticles,
+                         pairLoop.fPrecision,
+                         pairLoop.fFraction,
+                         options.mixDepth,
+                         options.mixMemoryMb,
+                         {}};
+    checkpoints = std::make_unique<CheckpointWriter>(
+        options.checkpointPath, run, resumed, workerRanges);
+  }
+  const auto checkpointInterval =
+      std::chrono::seconds(options.checkpointInterval);
+  auto runWorker = [&](int t) {
+    auto const& ranges = workerRanges[t];
+    auto lastCheckpoint = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < ranges.size(); r++) {
+      // hands a copy of the histograms to the checkpoint thread now and then
+      auto onFlush = [&](int next) {
+        if (!checkpoints) return;
+        const auto now = std::chrono::steady_clock::now();
+        if (now - lastCheckpoint < checkpointInterval) return;
+        lastCheckpoint = now;
+        std::vector<EventRange> left{{next, ranges[r].fLast}};
+        left.insert(left.end(), ranges.begin() + r + 1, ranges.end());
+        checkpoints->Submit(t, *histos[t], std::move(left));
+      };
+      simulateEvents(ranges[r].fFirst, ranges[r].fLast, seed, ids,
+                     options.nParticles, categories, pairLoop, *histos[t],
+                     timers[t], store.get(), pools[t].get(), completed,
+                     onFlush);
+    }
+  };
+  std::vector<std::thread> workers;
+  for (int t = 0; t < nThreads; t++) {
+    workers.emplace_back(runWorker, t);
+  }
+  // poll often enough to notice the end of the run quickly, but print the
+  // progress at most every PROGRESS_INTERVAL
+  const auto PROGRESS_INTERVAL = std::chrono::milliseconds(250);
+  auto lastPrint = std::chrono::steady_clock::now();
+  while (completed.load(std::memory_order_relaxed) < nShardEvents) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    const auto now = std::chrono::steady_clock::now();
+    if (now - lastPrint < PROGRESS_INTERVAL) continue;
+    lastPrint = now;
+    printf("\r%.0f%% completed in %.3fs",
+           completed.load(std::memory_order_relaxed) * 100. / nShardEvents,
+           timer.RealTime());
+    fflush(stdout);
     timer.Continue();
   }
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  // throughput is measured on the event loop only
+  const double wallSeconds = timer.RealTime();
+  printf("\r100%% completed in %.3fs", wallSeconds);
   std::cout << "\n";
 
+  // writes the last pending snapshots and stops the checkpoint thread
+  checkpoints.reset();
+
+  // merge workers' histos and timers into the first ones
+  StageTimers mainTimers;
+  mainTimers.Start();
+  histos[0]->Add(resumed);
+  for (int t = 1; t < nThreads; t++) {
+    histos[0]->Add(*histos[t]);
+    timers[0].Add(timers[t]);
+  }
+  mainTimers.Lap(HISTO_FILL);
+
   // save histos to file
   section("Saving to file");
-  TFile saveFile(SAVE_FILE, "RECREATE");
+  TFile saveFile(outputPath.c_str(), "RECREATE");
   if (!saveFile.IsOpen()) {
-    std::cout << "Unable to open " << SAVE_FILE << " file\n";
+    std::cout << "Unable to open " << outputPath << " file\n";
     return EXIT_FAILURE;
   }
   saveFile.Save();
-  particleTypesHisto.Write();
-  zenithDist.Write();
-  azimuthDist.Write();
-  pulseDist.Write();
-  traversePulseDist.Write();
-  particleEnergyDist.Write();
-  invMassDist.Write();
-  invMassDiffChargeDist.Write();
-  invMassSameChargeDist.Write();
-  invMassPioneKaoneDiscordantDist.Write();
-  invMassPioneKaoneConcordantDist.Write();
-  invMassSibDecayDist.Write();
+  histos[0]->Write();
+  // merge checks that it gets every shard of a single run
+  writeShardInfo({seed, nEvents, options.shard, options.nShards});
   saveFile.Close();
-  std::cout << "Saved to " << SAVE_FILE << "\n";
+  mainTimers.Lap(FILE_WRITE);
+  std::cout << "Saved to " << outputPath << "\n";
+  if (!options.checkpointPath.empty()) {
+    // the final file supersedes the checkpoint
+    std::remove(options.checkpointPath.c_str());
+    std::remove((options.checkpointPath + ".root").c_str());
+  }
+  if (store) {
+    if (!store->Close()) {
+      std::cout << "Unable to write " << options.eventsPath << " file\n";
+      return EXIT_FAILURE;
+    }
+    std::cout << "Saved to " << options.eventsPath << "\n";
+  }
+
+  section("Summary");
+  long nTruncated = 0;
+  for (auto const& pool : pools) {
+    if (pool) nTruncated += pool->GetNTruncated();
+  }
+  if (nTruncated > 0) {
+    std::cout << nTruncated << " events did not fit in the mixing pool and "
+              << "were kept without some of their particles\n";
+  }
+  timers[0].Add(mainTimers);
+  printReport(timers[0], wallSeconds, nThreads);
+  if (!options.reportPath.empty()) {
+    if (!writeReportJson(options.reportPath, timers[0], wallSeconds,
+                         nThreads)) {
+      std::cout << "Unable to open " << options.reportPath << " file\n";
+      return EXIT_FAILURE;
+    }
+    std::cout << "Saved to " << options.reportPath << "\n";
+  }
 }
 
-inline const char* determineParticleType() {
-  double particleTypeProbability = gRandom->Rndm();
-  if (particleTypeProbability < 0.4) {
-    return "pione+";
-  } else if (particleTypeProbability < 0.8) {
-    return "pione-";
-  } else if (particleTypeProbability < 0.85) {
-    return "kaone+";
-  } else if (particleTypeProbability < 0.9) {
-    return "kaone-";
-  } else if (particleTypeProbability < 0.945) {
-    return "protone+";
-  } else if (particleTypeProbability < 0.99) {
-    return "protone-";
-  } else {
-    return "k*";
-  }
-}
\ No newline at end of file
+bool parseArgs(int argc, char** argv, SimulationOptions& options) {
+  try {
+    for (int i = 1; i < argc; i++) {
+      if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+        options.nThreads = std::stoi(argv[++i]);
+        if (options.nThreads < 0) {
+          return false;
+        }
+      } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+        options.seed = std::stoull(argv[++i]);
+        options.hasSeed = true;
+      } else if (std::strcmp(argv[i], "--report") == 0 && i + 1 < argc) {
+        options.reportPath = argv[++i];
+      } else if (std::strcmp(argv[i], "--events") == 0 && i + 1 < argc) {
+        options.eventsPath = argv[++i];
+      } else if (std::strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+        options.checkpointPath = argv[++i];
+      } else if (std::strcmp(argv[i], "--checkpoint-interval") == 0 &&
+                 i + 1 < argc) {
+        options.checkpointInterval = std::stoi(argv[++i]);
+        if (options.checkpointInterval < 0) return false;
+      } else if (std::strcmp(argv[i], "--resume") == 0) {
+        options.resume = true;
+      } else if (std::strcmp(argv[i], "--mix-depth") == 0 && i + 1 < argc) {
+        options.mixDepth = std::stoi(argv[++i]);
+        if (options.mixDepth < 0) return false;
+      } else if (std::strcmp(argv[i], "--mix-memory") == 0 && i + 1 < argc) {
+        options.mixMemoryMb = std::stol(argv[++i]);
+        if (options.mixMemoryMb <= 0) return false;
+      } else if (std::strcmp(argv[i], "--n-events") == 0 && i + 1 < argc) {
+        options.nEvents = std::stoi(argv[++i]);
+        if (options.nEvents <= 0) return false;
+      } else if (std::strcmp(argv[i], "--shard") == 0 && i + 1 < argc) {
+        // I/N
+        const std::string shard = argv[++i];
+        const size_t slash = shard.find('/');
+        if (slash == std::string::npos) return false;
+        options.shard = std::stoi(shard.substr(0, slash));
+        options.nShards = std::stoi(shard.substr(slash + 1));
+        if (options.nShards <= 0 || options.shard < 0 ||
+            options.shard >= options.nShards) {
+          return false;
+        }
+      } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+        options.outputPath = argv[++i];
+      } else if (std::strcmp(argv[i], "--pair-config") == 0 && i + 1 < argc) {
+        options.pairConfigPath = argv[++i];
+      } else if (std::strcmp(argv[i], "--pair-precision") == 0 &&
+                 i + 1 < argc) {
+        if (!parsePairPrecision(argv[++i], options.pairLoop.fPrecision)) {
+          return false;
+        }
+      } else if (std::strcmp(argv[i], "--pair-fraction") == 0 &&
+                 i + 1 < argc) {
+        const double fraction = std::stod(argv[++i]);
+        if (!(fraction > 0. && fraction <= 1.)) return false;
+        options.pairLoop.fFraction = fraction;
+      } else if (std::strcmp(argv[i], "--pair-threads") == 0 &&
+                 i + 1 < argc) {
+        options.pairLoop.fNThreads = std::stoi(argv[++i]);
+        if (options.pairLoop.fNThreads < 0) return false;
+      } else if (std::strcmp(argv[i], "--particles") == 0 && i + 1 < argc) {
+        options.nParticles = std::stoi(argv[++i]);
+        if (options.nParticles <= 0) return false;
+      } else {
+        return false;
+      }
+    }
+  } catch (std::exception const&) {
+    return false;
+  }
+  // a resumed run would write its events file again from the start
+  if (options.resume &&
+      (options.checkpointPath.empty() || !options.eventsPath.empty())) {
+    return false;
+  }
+  // shards with random seeds would be parts of different runs
+  return options.nShards == 1 || options.hasSeed || options.resume;
+}
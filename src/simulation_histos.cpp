@@ -0,0 +1,336 @@
+#include "simulation_histos.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+
+#include "particle.hpp"
+#include "util.hpp"
+
+// one bin per registered particle type, type t in [t, t + 1)
+static int particleTypeBins() {
+  return std::max(1, Particle::GetParticleTable().Size());
+}
+
+// throws if a category has the name of one of the histograms builtIn
+static void checkPairCategoryNames(
+    std::vector<TH1D*> const& builtIn,
+    std::vector<PairCategoryConfig> const& pairCategories) {
+  for (auto const& category : pairCategories) {
+    if (category.fName == SHARD_HISTO) {
+      throw std::invalid_argument(category.fName + " is already a histogram");
+    }
+    for (TH1D const* histo : builtIn) {
+      if (category.fName == histo->GetName()) {
+        throw std::invalid_argument(category.fName + " is already a histogram");
+      }
+    }
+  }
+}
+
+void validatePairCategories(
+    std::vector<PairCategoryConfig> const& pairCategories) {
+  SimulationHistos builtIn;
+  checkPairCategoryNames(builtIn.All(), pairCategories);
+}
+
+SimulationHistos::SimulationHistos(
+    std::vector<PairCategoryConfig> const& pairCategories)
+    : particleTypesHisto(                                                    //
+          "particle-types",                                                  //
+          "Particle types;Type;Entries",                                     //
+          particleTypeBins(), 0., particleTypeBins()),                       //
+      zenithDist(                                                            //
+          "zenith",                                                          //
+          "Zenith;Radians;Entries",                                          //
+          1000, 0., M_PI),                                                   //
+      azimuthDist(                                                           //
+          "azimuth",                                                         //
+          "Azimuth;Radians;Entries",                                         //
+          1000, 0., 2 * M_PI),                                               //
+      pulseDist(                                                             //
+          "pulse",                                                           //
+          "Pulse;Pulse;Entries",                                             //
+          1000, 0, 11),                                                      //
+      traversePulseDist(                                                     //
+          "traverse-pulse",                                                  //
+          "Traverse pulse;Traverse pulse;Entries",                           //
+          1000, 0., 10.),                                                    //
+      particleEnergyDist(                                                    //
+          "particle-energy",                                                 //
+          "Particle energy;Total energy;Entries",                            //
+          1000, 0., 10.),                                                    //
+      invMassDist(                                                           //
+          "inv-mass",                                                        //
+          "Inv. mass;Invariant mass;Entries",                                //
+          1000, 0, 10),                                                      //
+      invMassDiffChargeDist(                                                 //
+          "inv-mass-discordant",                                             //
+          "Inv. mass discrodant charge;Invariant mass;Entries",              //
+          1000, 0, 10),                                                      //
+      invMassSameChargeDist(                                                 //
+          "inv-mass-concordant",                                             //
+          "Inv. mass concordant charge;Invariant mass;Entries",              //
+          1000, 0, 10),                                                      //
+      invMassPioneKaoneDiscordantDist(                                       //
+          "inv-mass-discordant-pk",                                          //
+          "Inv. mass pione kaone discordant charge;Invariant mass;Entries",  //
+          1000, 0, 10),                                                      //
+      invMassPioneKaoneConcordantDist(                                       //
+          "inv-mass-concordant-pk",                                          //
+          "Inv. mass pione kaone concordant charge;Invariant mass;Entries",  //
+          1000, 0, 10),                                                      //
+      invMassSibDecayDist(                                                   //
+          "inv-mass-siblings",                                               //
+          "Inv. mass siblings;Invariant mass;Entries",                       //
+          1000, 0, 2),                                                       //
+      invMassMixedDiscordantDist(                                            //
+          "inv-mass-mixed-discordant",                                       //
+          "Inv. mass mixed discordant charge;Invariant mass;Entries",        //
+          1000, 0, 10),                                                      //
+      invMassMixedPioneKaoneDiscordantDist(                                  //
+          "inv-mass-mixed-discordant-pk",                                    //
+          "Inv. mass mixed pione kaone discordant charge;Invariant mass;"    //
+          "Entries",                                                         //
+          1000, 0, 10),                                                      //
+      eventsHisto(                                                           //
+          "events",                                                          //
+          "Events;;Entries",                                                 //
+          2, 0., 2.) {
+  ParticleTable const& table = Particle::GetParticleTable();
+  auto* typesXAxis = particleTypesHisto.GetXaxis();
+  for (int type = 0; type < table.Size(); type++) {
+    typesXAxis->SetBinLabel(type + 1, table.GetName(type));
+  }
+
+  eventsHisto.GetXaxis()->SetBinLabel(1, "events");
+  eventsHisto.GetXaxis()->SetBinLabel(2, "particles");
+
+  // init histos' weights
+  invMassDist.Sumw2();
+  invMassDiffChargeDist.Sumw2();
+  invMassSameChargeDist.Sumw2();
+  invMassPioneKaoneDiscordantDist.Sumw2();
+  invMassPioneKaoneConcordantDist.Sumw2();
+  invMassSibDecayDist.Sumw2();
+  invMassMixedDiscordantDist.Sumw2();
+  invMassMixedPioneKaoneDiscordantDist.Sumw2();
+
+  checkPairCategoryNames(All(), pairCategories);
+  pairCategoryDists.reserve(pairCategories.size());
+  for (auto const& category : pairCategories) {
+    const std::string title = category.fName + ";Invariant mass;Entries";
+    pairCategoryDists.emplace_back(category.fName.c_str(), title.c_str(),
+                                   category.fNBins, category.fXMin,
+                                   category.fXMax);
+    pairCategoryDists.back().Sumw2();
+  }
+}
+
+void SimulationHistos::Add(SimulationHistos const& other) {
+  particleTypesHisto.Add(&other.particleTypesHisto);
+  zenithDist.Add(&other.zenithDist);
+  azimuthDist.Add(&other.azimuthDist);
+  pulseDist.Add(&other.pulseDist);
+  traversePulseDist.Add(&other.traversePulseDist);
+  particleEnergyDist.Add(&other.particleEnergyDist);
+  invMassDist.Add(&other.invMassDist);
+  invMassDiffChargeDist.Add(&other.invMassDiffChargeDist);
+  invMassSameChargeDist.Add(&other.invMassSameChargeDist);
+  invMassPioneKaoneDiscordantDist.Add(&other.invMassPioneKaoneDiscordantDist);
+  invMassPioneKaoneConcordantDist.Add(&other.invMassPioneKaoneConcordantDist);
+  invMassSibDecayDist.Add(&other.invMassSibDecayDist);
+  invMassMixedDiscordantDist.Add(&other.invMassMixedDiscordantDist);
+  invMassMixedPioneKaoneDiscordantDist.Add(
+      &other.invMassMixedPioneKaoneDiscordantDist);
+  eventsHisto.Add(&other.eventsHisto);
+  for (size_t c = 0; c < pairCategoryDists.size(); c++) {
+    pairCategoryDists[c].Add(&other.pairCategoryDists[c]);
+  }
+}
+
+void SimulationHistos::AddFile(TFile& file) {
+  for (TH1D* histo : All()) {
+    auto* saved = dynamic_cast<TH1D*>(file.Get(histo->GetName()));
+    if (!saved) {
+      throw std::runtime_error(std::string(file.GetName()) + " has no " +
+                               histo->GetName() + " histogram");
+    }
+    if (saved->GetNbinsX() != histo->GetNbinsX()) {
+      throw std::runtime_error(std::string(file.GetName()) + " has a " +
+                               "different binning of " + histo->GetName());
+    }
+    histo->Add(saved);
+  }
+}
+
+void SimulationHistos::Write() {
+  particleTypesHisto.Write();
+  zenithDist.Write();
+  azimuthDist.Write();
+  pulseDist.Write();
+  traversePulseDist.Write();
+  particleEnergyDist.Write();
+  invMassDist.Write();
+  invMassDiffChargeDist.Write();
+  invMassSameChargeDist.Write();
+  invMassPioneKaoneDiscordantDist.Write();
+  invMassPioneKaoneConcordantDist.Write();
+  invMassSibDecayDist.Write();
+  invMassMixedDiscordantDist.Write();
+  invMassMixedPioneKaoneDiscordantDist.Write();
+  eventsHisto.Write();
+  for (auto& histo : pairCategoryDists) {
+    histo.Write();
+  }
+}
+
+std::vector<TH1D*> SimulationHistos::All() {
+  std::vector<TH1D*> histos{&particleTypesHisto,
+                            &zenithDist,
+                            &azimuthDist,
+                            &pulseDist,
+                            &traversePulseDist,
+                            &particleEnergyDist,
+                            &invMassDist,
+                            &invMassDiffChargeDist,
+                            &invMassSameChargeDist,
+                            &invMassPioneKaoneDiscordantDist,
+                            &invMassPioneKaoneConcordantDist,
+                            &invMassSibDecayDist,
+                            &invMassMixedDiscordantDist,
+                            &invMassMixedPioneKaoneDiscordantDist,
+                            &eventsHisto};
+  for (auto& histo : pairCategoryDists) {
+    histos.push_back(&histo);
+  }
+  return histos;
+}
+
+std::vector<TH1D const*> SimulationHistos::All() const {
+  auto histos = const_cast<SimulationHistos*>(this)->All();
+  return {histos.begin(), histos.end()};
+}
+
+SimulationAccumulators::SimulationAccumulators(SimulationHistos const& histos)
+    : particleTypesHisto(histos.particleTypesHisto),
+      zenithDist(histos.zenithDist),
+      azimuthDist(histos.azimuthDist),
+      pulseDist(histos.pulseDist),
+      traversePulseDist(histos.traversePulseDist),
+      particleEnergyDist(histos.particleEnergyDist),
+      invMassDist(histos.invMassDist),
+      invMassDiffChargeDist(histos.invMassDiffChargeDist),
+      invMassSameChargeDist(histos.invMassSameChargeDist),
+      invMassPioneKaoneDiscordantDist(histos.invMassPioneKaoneDiscordantDist),
+      invMassPioneKaoneConcordantDist(histos.invMassPioneKaoneConcordantDist),
+      invMassSibDecayDist(histos.invMassSibDecayDist),
+      invMassMixedDiscordantDist(histos.invMassMixedDiscordantDist),
+      invMassMixedPioneKaoneDiscordantDist(
+          histos.invMassMixedPioneKaoneDiscordantDist),
+      eventsHisto(histos.eventsHisto) {
+  pairCategoryDists.reserve(histos.pairCategoryDists.size());
+  for (auto const& histo : histos.pairCategoryDists) {
+    pairCategoryDists.emplace_back(histo);
+  }
+}
+
+void SimulationAccumulators::FlushInto(SimulationHistos& histos) {
+  particleTypesHisto.FlushInto(histos.particleTypesHisto);
+  zenithDist.FlushInto(histos.zenithDist);
+  azimuthDist.FlushInto(histos.azimuthDist);
+  pulseDist.FlushInto(histos.pulseDist);
+  traversePulseDist.FlushInto(histos.traversePulseDist);
+  particleEnergyDist.FlushInto(histos.particleEnergyDist);
+  invMassDist.FlushInto(histos.invMassDist);
+  invMassDiffChargeDist.FlushInto(histos.invMassDiffChargeDist);
+  invMassSameChargeDist.FlushInto(histos.invMassSameChargeDist);
+  invMassPioneKaoneDiscordantDist.FlushInto(
+      histos.invMassPioneKaoneDiscordantDist);
+  invMassPioneKaoneConcordantDist.FlushInto(
+      histos.invMassPioneKaoneConcordantDist);
+  invMassSibDecayDist.FlushInto(histos.invMassSibDecayDist);
+  invMassMixedDiscordantDist.FlushInto(histos.invMassMixedDiscordantDist);
+  invMassMixedPioneKaoneDiscordantDist.FlushInto(
+      histos.invMassMixedPioneKaoneDiscordantDist);
+  eventsHisto.FlushInto(histos.eventsHisto);
+  for (size_t c = 0; c < pairCategoryDists.size(); c++) {
+    pairCategoryDists[c].FlushInto(histos.pairCategoryDists[c]);
+  }
+}
+
+std::vector<HistoAccumulator*> SimulationAccumulators::PairCategoryHistos() {
+  // same order as the bits of PairCategory
+  std::vector<HistoAccumulator*> histos{
+      &invMassDiffChargeDist, &invMassSameChargeDist,
+      &invMassPioneKaoneDiscordantDist, &invMassPioneKaoneConcordantDist};
+  for (auto& histo : pairCategoryDists) {
+    histos.push_back(&histo);
+  }
+  return histos;
+}
+
+// the seed is split in two halves, which doubles hold exactly
+static const char* const SHARD_LABELS[] = {"seed-high", "seed-low", "events",
+                                           "shard", "shards"};
+static const int N_SHARD_BINS = 5;
+
+void writeShardInfo(ShardInfo const& info) {
+  TH1D histo(SHARD_HISTO, "Shard;;Value", N_SHARD_BINS, 0., N_SHARD_BINS);
+  const double values[] = {static_cast<double>(info.fSeed >> 32),
+                           static_cast<double>(info.fSeed & 0xFFFFFFFFu),
+                           static_cast<double>(info.fNEvents),
+                           static_cast<double>(info.fShard),
+                           static_cast<double>(info.fNShards)};
+  for (int bin = 0; bin < N_SHARD_BINS; bin++) {
+    histo.GetXaxis()->SetBinLabel(bin + 1, SHARD_LABELS[bin]);
+    histo.SetBinContent(bin + 1, values[bin]);
+  }
+  histo.Write();
+}
+
+ShardInfo readShardInfo(TFile& file) {
+  auto* histo = dynamic_cast<TH1D*>(file.Get(SHARD_HISTO));
+  if (!histo || histo->GetNbinsX() != N_SHARD_BINS) {
+    throw std::runtime_error(std::string(file.GetName()) +
+                             " has no shard information");
+  }
+  ShardInfo info;
+  info.fSeed = (static_cast<uint64_t>(histo->GetBinContent(1)) << 32) |
+               static_cast<uint64_t>(histo->GetBinContent(2));
+  info.fNEvents = histo->GetBinContent(3);
+  info.fShard = histo->GetBinContent(4);
+  info.fNShards = histo->GetBinContent(5);
+  if (info.fNShards <= 0 || info.fShard < 0 || info.fShard >= info.fNShards) {
+    throw std::runtime_error(std::string(file.GetName()) +
+                             " has invalid shard information");
+  }
+  return info;
+}
+
+void checkShards(std::vector<ShardInfo> const& infos,
+                 std::vector<std::string> const& paths) {
+  ShardInfo const& first = infos.front();
+  std::vector<int> owners(first.fNShards, -1);
+  for (size_t i = 0; i < infos.size(); i++) {
+    ShardInfo const& info = infos[i];
+    if (info.fSeed != first.fSeed || info.fNEvents != first.fNEvents ||
+        info.fNShards != first.fNShards) {
+      throw std::runtime_error(paths[i] + " is a shard of another run than " +
+                               paths[0]);
+    }
+    if (owners[info.fShard] >= 0) {
+      throw std::runtime_error(concat(paths[i], " and ",
+                                      paths[owners[info.fShard]],
+                                      " are both shard ", info.fShard));
+    }
+    owners[info.fShard] = i;
+  }
+  for (int shard = 0; shard < first.fNShards; shard++) {
+    if (owners[shard] < 0) {
+      throw std::runtime_error(concat("Shard ", shard, " of ", first.fNShards,
+                                      " is missing"));
+    }
+  }
+}
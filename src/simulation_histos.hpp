@@ -0,0 +1,113 @@
+#pragma once
+
+#include <TFile.h>
+#include <TH1D.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "histo_accumulator.hpp"
+#include "pair_config.hpp"
+
+// centers of the bins of the events histogram
+const double EVENTS_BIN = 0.5;
+const double PARTICLES_BIN = 1.5;
+
+// Set of histograms filled by the simulation. Every worker thread owns one
+// instance; they are merged together with Add before being written to file.
+// The particle types histogram has a bin for every type registered when the
+// set is built, labelled with its name.
+struct SimulationHistos {
+  TH1D particleTypesHisto;
+  TH1D zenithDist;
+  TH1D azimuthDist;
+  TH1D pulseDist;
+  TH1D traversePulseDist;
+  TH1D particleEnergyDist;
+  TH1D invMassDist;
+  TH1D invMassDiffChargeDist;
+  TH1D invMassSameChargeDist;
+  TH1D invMassPioneKaoneDiscordantDist;
+  TH1D invMassPioneKaoneConcordantDist;
+  TH1D invMassSibDecayDist;
+  // mixed-event background, empty unless event mixing is enabled
+  TH1D invMassMixedDiscordantDist;
+  TH1D invMassMixedPioneKaoneDiscordantDist;
+  // events in the first bin and the sum of their configured multiplicity
+  // in the second, so that both survive merges
+  TH1D eventsHisto;
+  // one per category of the pair configuration, in its order
+  std::vector<TH1D> pairCategoryDists;
+
+  // throws std::invalid_argument if a category has the name of another
+  // histogram
+  explicit SimulationHistos(
+      std::vector<PairCategoryConfig> const& pairCategories = {});
+  void Add(SimulationHistos const& other);
+  // adds the histograms saved in file by Write, throws std::runtime_error if
+  // one is missing or has another binning
+  void AddFile(TFile& file);
+  void Write();
+  // every histogram of the set, in declaration order
+  std::vector<TH1D*> All();
+  std::vector<TH1D const*> All() const;
+};
+
+// Throws std::invalid_argument if a category has the name of one of the
+// histograms of SimulationHistos, which could not be told apart in a file
+void validatePairCategories(
+    std::vector<PairCategoryConfig> const& pairCategories);
+
+// Part of a run held by a histograms file. The shards of one run share the
+// seed, the events and the number of shards, and have every index once.
+struct ShardInfo {
+  uint64_t fSeed;
+  int fNEvents;
+  int fShard;
+  int fNShards;
+};
+
+// name of the histogram that holds the ShardInfo of a histograms file
+const char* const SHARD_HISTO = "shard";
+
+// writes info to the current directory as the SHARD_HISTO histogram
+void writeShardInfo(ShardInfo const& info);
+// throws std::runtime_error if file has no valid SHARD_HISTO histogram
+ShardInfo readShardInfo(TFile& file);
+// Throws std::runtime_error unless the infos, read from paths, are all the
+// shards of a single run, each one once
+void checkShards(std::vector<ShardInfo> const& infos,
+                 std::vector<std::string> const& paths);
+
+// Accumulators mirroring a SimulationHistos set. Workers fill these in the
+// event loop and flush them into their histograms at chunk boundaries.
+struct SimulationAccumulators {
+  HistoAccumulator particleTypesHisto;
+  HistoAccumulator zenithDist;
+  HistoAccumulator azimuthDist;
+  HistoAccumulator pulseDist;
+  HistoAccumulator traversePulseDist;
+  HistoAccumulator particleEnergyDist;
+  HistoAccumulator invMassDist;
+  HistoAccumulator invMassDiffChargeDist;
+  HistoAccumulator invMassSameChargeDist;
+  HistoAccumulator invMassPioneKaoneDiscordantDist;
+  HistoAccumulator invMassPioneKaoneConcordantDist;
+  HistoAccumulator invMassSibDecayDist;
+  HistoAccumulator invMassMixedDiscordantDist;
+  HistoAccumulator invMassMixedPioneKaoneDiscordantDist;
+  HistoAccumulator eventsHisto;
+  std::vector<HistoAccumulator> pairCategoryDists;
+
+  explicit SimulationAccumulators(SimulationHistos const& histos);
+  void FlushInto(SimulationHistos& histos);
+  // accumulators of the pair categories, indexed by category bit: the ones
+  // of PairCategory first, then the configured ones
+  std::vector<HistoAccumulator*> PairCategoryHistos();
+  // counts an event of a run of nParticles particles per event
+  void CountEvent(int nParticles) {
+    eventsHisto.Fill(EVENTS_BIN);
+    eventsHisto.Fill(PARTICLES_BIN, nParticles);
+  }
+};
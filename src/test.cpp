@@ -1,11 +1,42 @@
 #define PRINT_TEST_TITLE(text) \
   std::cout << "\n------------------\n" << text << "\n------------------\n";
 
+#include <TH1D.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
 
+#include "alias_table.hpp"
+#include "checkpoint.hpp"
+#include "decay_arena.hpp"
+#include "decay_batch.hpp"
+#include "event_mixing.hpp"
+#include "event_replay.hpp"
+#include "event_store.hpp"
+#include "fast_math.hpp"
+#include "histo_accumulator.hpp"
+#include "histo_comparison.hpp"
+#include "histo_store.hpp"
+#include "kinematics.hpp"
+#include "least_squares.hpp"
+#include "pair_categories.hpp"
+#include "pair_config.hpp"
+#include "pair_filler.hpp"
+#include "instrumentation.hpp"
 #include "particle.hpp"
+#include "particle_batch.hpp"
+#include "particle_catalogue.hpp"
 #include "particle_type.hpp"
 #include "resonance_type.hpp"
+#include "rng.hpp"
+#include "util.hpp"
 
 int main() {
   PRINT_TEST_TITLE("Test getters, const correctness and Print")
@@ -37,4 +68,799 @@ int main() {
   Particle j("J", 12, 33, 55);
   Particle m("M", 67, 99, 77);
   Particle invalid("PIPPO", 22, 22, 22);
-}
\ No newline at end of file
+  const TypeId jId = Particle::FindParticle("J");
+  Particle jById(jId, 12, 33, 55);
+  std::cout << "Same type by id and by name: "
+            << boolToString(jById.GetParticleType() == j.GetParticleType())
+            << "\n";
+  std::cout << "PIPPO is valid: " << boolToString(invalid.IsOfValidType())
+            << "\n";
+  try {
+    Particle pastTable(jId + 1000, 1, 2, 3);
+    std::cout << "Unregistered id accepted\n";
+  } catch (std::invalid_argument const& error) {
+    std::cout << "Unregistered id: " << error.what();
+  }
+
+  PRINT_TEST_TITLE("Test invMassRow against InvMass");
+  ParticleBatch batch;
+  std::vector<Particle> particles;
+  for (int i = 0; i < 13; i++) {
+    particles.push_back(Particle(i % 2 ? "J" : "M", i * 0.3, -i * 0.7, i));
+    batch.Push(particles.back());
+  }
+  std::vector<double> invMasses(batch.Size());
+  double maxDiff = 0.;
+  for (int i = 0; i < batch.Size() - 1; i++) {
+    invMassRow(batch, i, i + 1, batch.Size(), invMasses.data());
+    for (int j = i + 1; j < batch.Size(); j++) {
+      const double diff =
+          std::abs(invMasses[j - i - 1] - particles[i].InvMass(particles[j]));
+      maxDiff = std::max(maxDiff, diff);
+    }
+  }
+  std::cout << "Max difference: " << maxDiff << "\n";
+  std::cout << "Equal: " << boolToString(maxDiff < 1e-9) << "\n";
+  // float only differs by its rounding
+  std::vector<double> floatMasses(batch.Size());
+  double maxRelativeDiff = 0.;
+  for (int i = 0; i < batch.Size() - 1; i++) {
+    invMassRow(batch, i, i + 1, batch.Size(), invMasses.data());
+    invMassRow(batch, i, i + 1, batch.Size(), floatMasses.data(),
+               PairPrecision::FLOAT);
+    for (int j = 0; j < batch.Size() - i - 1; j++) {
+      maxRelativeDiff = std::max(
+          maxRelativeDiff, std::abs(floatMasses[j] / invMasses[j] - 1.));
+    }
+  }
+  std::cout << "Float close: " << boolToString(maxRelativeDiff < 1e-5)
+            << "\n";
+
+  PRINT_TEST_TITLE("Test particle table and freezing");
+  ParticleTable const& table = Particle::GetParticleTable();
+  for (int i = 0; i < table.Size(); i++) {
+    std::cout << table.GetName(i) << ": mass " << table[i].fMass << ", mass2 "
+              << table[i].fMass2 << ", charge " << table[i].fCharge
+              << ", width " << table[i].fWidth << "\n";
+  }
+  Particle::FreezeParticleTypes();
+  try {
+    Particle::AddParticleType("K", 1, 0);
+    std::cout << "Added type while frozen\n";
+  } catch (std::runtime_error const& e) {
+    std::cout << "Caught: " << e.what();
+  }
+  Particle::UnfreezeParticleTypes();
+
+  PRINT_TEST_TITLE("Test HistoAccumulator against TH1D");
+  TH1D direct("direct", "", 10, 0., 5.), flushed("flushed", "", 10, 0., 5.);
+  direct.Sumw2();
+  flushed.Sumw2();
+  HistoAccumulator accumulator(flushed);
+  const double values[] = {-1., 0., 0.49, 0.5, 2.5, 4.99, 5., 7., 3.3, 3.3};
+  for (double value : values) {
+    direct.Fill(value, 0.5);
+    accumulator.Fill(value, 0.5);
+  }
+  direct.Fill(1.2);
+  flushed.Fill(1.2);
+  accumulator.FlushInto(flushed);
+  bool sameBins = true;
+  for (int bin = 0; bin <= 11; bin++) {
+    sameBins = sameBins &&
+               direct.GetBinContent(bin) == flushed.GetBinContent(bin) &&
+               direct.GetBinError(bin) == flushed.GetBinError(bin);
+  }
+  std::cout << "Same bins and errors: " << boolToString(sameBins) << "\n";
+  std::cout << "Entries: " << direct.GetEntries() << " "
+            << flushed.GetEntries() << "\n";
+  std::cout << "Mean: " << direct.GetMean() << " " << flushed.GetMean()
+            << "\n";
+
+  PRINT_TEST_TITLE("Test counter-based Rng");
+  const auto block = Philox4x32::Generate({0, 0, 0, 0}, {0, 0});
+  std::cout << "Philox4x32-10 known answer: "
+            << boolToString(block[0] == 0x6627e8d5 && block[1] == 0xe169c58d &&
+                            block[2] == 0xbc57ac4c && block[3] == 0x9b00dbd8)
+            << "\n";
+  Rng first(42, 7, 1), again(42, 7, 1), otherEvent(42, 8, 1);
+  bool reproducible = true, independent = true;
+  for (int i = 0; i < 100; i++) {
+    const double x = first.Gaus();
+    reproducible = reproducible && x == again.Gaus();
+    independent = independent && x != otherEvent.Gaus();
+  }
+  std::cout << "Same key reproduces the stream: " << boolToString(reproducible)
+            << "\n";
+  std::cout << "Different events differ: " << boolToString(independent)
+            << "\n";
+  double uniforms[1000];
+  Rng bulk(42, 7, 2);
+  bulk.Uniform(uniforms, 1000);
+  double mean = 0.;
+  for (double u : uniforms) mean += u / 1000.;
+  std::cout << "Mean of 1000 uniforms: " << mean << "\n";
+  Rng scalarRng(42, 7, 2), blockRng(42, 7, 2);
+  double bulk37[37];
+  scalarRng.Rndm();
+  blockRng.Rndm();
+  blockRng.Rndm(bulk37, 37);
+  bool sameSequence = true;
+  for (double u : bulk37) sameSequence = sameSequence && u == scalarRng.Rndm();
+  std::cout << "Bulk Rndm gives the scalar sequence: "
+            << boolToString(sameSequence) << "\n";
+
+  PRINT_TEST_TITLE("Test DecayBatch against Decay2body");
+  const TypeId resonance = Particle::AddParticleType("R", 2, 0, 0.1);
+  const TypeId light = Particle::AddParticleType("l", 0.3, 1);
+  const TypeId heavy = Particle::AddParticleType("h", 0.6, -1);
+  DecayBatch decays;
+  std::vector<Rng> batchRngs, scalarRngs;
+  std::vector<Particle> mothers;
+  for (int i = 0; i < 20; i++) {
+    batchRngs.emplace_back(1, i);
+    scalarRngs.emplace_back(1, i);
+  }
+  for (int i = 0; i < 20; i++) {
+    mothers.push_back(Particle(resonance, 0.1 * i, 1 - 0.2 * i, 0.5));
+    decays.Add(mothers.back(), light, heavy, batchRngs[i]);
+  }
+  decays.Decay();
+  double maxDecayDiff = 0.;
+  for (int i = 0; i < decays.Size(); i++) {
+    Particle dau1(light), dau2(heavy);
+    mothers[i].Decay2body(dau1, dau2, scalarRngs[i]);
+    maxDecayDiff = std::max(
+        {maxDecayDiff, std::abs(dau1.GetPulseX() - decays.GetDau1(i).fPx),
+         std::abs(dau1.GetPulseY() - decays.GetDau1(i).fPy),
+         std::abs(dau2.GetPulseZ() - decays.GetDau2(i).fPz)});
+  }
+  std::cout << "Max difference: " << maxDecayDiff << "\n";
+  std::cout << "Equal: " << boolToString(maxDecayDiff < 1e-9) << "\n";
+
+  DecayBatch belowThreshold(5);
+  Rng thresholdRng(1, 0);
+  belowThreshold.Add(Particle(light), light, heavy, thresholdRng);
+  belowThreshold.Decay();
+  std::cout << "Below threshold reported: "
+            << boolToString(belowThreshold.GetStatus(0) ==
+                            DecayStatus::BELOW_THRESHOLD)
+            << "\n";
+  // a third of the smeared masses start below the 0.9 threshold
+  const TypeId wide = Particle::AddParticleType("w", 1., 0, 0.3);
+  DecayBatch resampled;
+  std::vector<Rng> resampleRngs;
+  for (int i = 0; i < 1000; i++) resampleRngs.emplace_back(2, i);
+  for (int i = 0; i < 1000; i++) {
+    resampled.Add(Particle(wide, 0.2, 0., 0.1 * i), light, heavy,
+                  resampleRngs[i]);
+  }
+  resampled.Decay();
+  bool allResampled = true;
+  double minResampledMass = 10.;
+  for (int i = 0; i < resampled.Size(); i++) {
+    allResampled =
+        allResampled && resampled.GetStatus(i) == DecayStatus::OK;
+    minResampledMass =
+        std::min(minResampledMass,
+                 invMass(resampled.GetDau1(i), resampled.GetDau2(i)));
+  }
+  std::cout << "Resampled: " << boolToString(allResampled)
+            << ", above threshold: "
+            << boolToString(minResampledMass >= 0.9 - 1e-9) << "\n";
+
+  PRINT_TEST_TITLE("Test StageTimers");
+  StageTimers workerTimers, otherTimers;
+  workerTimers.Start();
+  workerTimers.AddEvent(10, 4);
+  workerTimers.Lap(PAIR_LOOP);
+  otherTimers.AddEvent(5, 5);
+  workerTimers.Add(otherTimers);
+  std::cout << "Events: " << workerTimers.GetEvents() << " (2)\n";
+  std::cout << "Pairs: " << workerTimers.GetPairs() << " (15)\n";
+  std::cout << "Sampled pairs: " << workerTimers.GetSampledPairs()
+            << " (9)\n";
+  std::cout << "Stage time not negative: "
+            << boolToString(workerTimers.GetSeconds(PAIR_LOOP) >= 0.) << "\n";
+
+  PRINT_TEST_TITLE("Test event store round trip");
+  {
+    EventStoreWriter writer("test-events.evs",
+                            Particle::GetParticleTable().Size(), 2, 42);
+    EventBlock block;
+    block.Clear(7);
+    block.BeginEvent();
+    block.Add(Particle(light, 1., 2., 3.), -1, true);
+    const int mother = block.Add(Particle(resonance, 0.5, 0., 0.), -1, false);
+    block.Add(Particle(heavy, 0.1, 0.2, 0.3), mother, true);
+    block.BeginEvent();
+    writer.Write(block);
+    std::cout << "Closed: " << boolToString(writer.Close()) << " (true)\n";
+  }
+  EventStoreReader reader("test-events.evs");
+  const EventView stored = reader.GetEvent(0, 0);
+  std::cout << "Events: " << reader.GetNEvents() << " (2), multiplicity "
+            << reader.GetNParticles() << " (2), seed " << reader.GetSeed()
+            << " (42)\n";
+  std::cout << "First event: " << stored.GetNumber() << " (7)\n";
+  std::cout << "Particles: " << stored.Size() << " (3), "
+            << reader.GetEvent(0, 1).Size() << " (0)\n";
+  std::cout << "Same values: "
+            << boolToString(stored.GetType(2) == heavy &&
+                            stored.GetParent(2) == 1 && !stored.IsFinal(1) &&
+                            stored.GetPz(0) == 3.)
+            << "\n";
+  {
+    // damaged copies of the file are refused before any event is read
+    std::ifstream in("test-events.evs", std::ios::binary);
+    const std::string bytes((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+    auto readDamaged = [](std::string const& damaged) {
+      {
+        std::ofstream out("test-damaged.evs", std::ios::binary);
+        out << damaged;
+      }
+      try {
+        EventStoreReader damagedReader("test-damaged.evs");
+        return std::string("accepted");
+      } catch (std::runtime_error const& error) {
+        return std::string(error.what()).substr(sizeof "test-damaged.evs");
+      }
+    };
+    // the type column of the block follows its header and offsets
+    std::string badType = bytes;
+    const size_t typeColumn =
+        sizeof(EventStoreHeader) + sizeof(EventBlockHeader) + 16;
+    badType[typeColumn] = 100;
+    std::cout << "Cut file: " << readDamaged(bytes.substr(0, bytes.size() - 4))
+              << " (is truncated)\n";
+    std::cout << "Extra bytes: " << readDamaged(bytes + "xyz")
+              << " (is truncated)\n";
+    std::cout << "Bad type: " << readDamaged(badType)
+              << " (has an invalid block at event 7)\n";
+    std::remove("test-damaged.evs");
+  }
+  std::remove("test-events.evs");
+  {
+    // the writes only reach the full device when the buffer is flushed
+    EventStoreWriter fullWriter("/dev/full", 1, 1, 0);
+    EventBlock block;
+    block.Clear(0);
+    block.BeginEvent();
+    block.Add(Particle(light, 1., 2., 3.), -1, true);
+    fullWriter.Write(block);
+    std::cout << "Full disk reported: " << boolToString(!fullWriter.Close())
+              << " (true)\n";
+  }
+
+  PRINT_TEST_TITLE("Test least squares fits");
+  std::vector<double> fitX, fitY, fitE;
+  Rng fitRng(3, 0);
+  for (int i = 0; i < 100; i++) {
+    const double x = 0.05 + 0.1 * i;
+    const double t = (x - 4.) / 0.7;
+    const double expected = 1000. * std::exp(-0.5 * t * t);
+    fitX.push_back(x);
+    fitY.push_back(fitRng.Poisson(expected));
+    fitE.push_back(std::sqrt(std::max(fitY.back(), 1.)));
+  }
+  const FitResult gausFit = fitLeastSquares(
+      FitModel::GAUS, fitX.size(), fitX.data(), fitY.data(), fitE.data());
+  std::cout << "Gaus mean: " << gausFit.fParameters[1] << " (4), sigma: "
+            << gausFit.fParameters[2] << " (0.7)\n";
+  std::cout << "Converged: " << boolToString(gausFit.fValid) << "\n";
+  const std::vector<double> flat(fitX.size(), 50.), flatE(fitX.size(), 7.);
+  const FitResult pol0Fit = fitLeastSquares(
+      FitModel::POL0, fitX.size(), fitX.data(), flat.data(), flatE.data());
+  std::cout << "Pol0: " << pol0Fit.fParameters[0] << " (50), chi2: "
+            << pol0Fit.fChi2 << " (0)\n";
+
+  PRINT_TEST_TITLE("Test checkpoint round trip");
+  TH1::AddDirectory(kFALSE);
+  SimulationHistos saved, restored;
+  saved.zenithDist.Fill(1.);
+  saved.invMassDist.Fill(2., 0.5);
+  writeCheckpoint("test-checkpoint",
+                  {42, 100, 500, PairPrecision::FLOAT, 0.25, 10, 32,
+                   {{10, 20}, {50, 100}}},
+                  saved);
+  const Checkpoint checkpoint = readCheckpoint("test-checkpoint", restored);
+  std::remove("test-checkpoint");
+  std::cout << "Seed: " << checkpoint.fSeed << " (42), events left: "
+            << countEvents(checkpoint.fRemaining) << " (60)\n";
+  std::cout << "Particles: " << checkpoint.fNParticles << " (500), precision: "
+            << pairPrecisionName(checkpoint.fPairPrecision)
+            << " (float), fraction: " << checkpoint.fPairFraction
+            << " (0.25)\n";
+  std::cout << "Mix depth: " << checkpoint.fMixDepth << " (10), memory: "
+            << checkpoint.fMixMemoryMb << " (32)\n";
+  std::cout << "Same contents: "
+            << boolToString(restored.zenithDist.GetEntries() == 1 &&
+                            restored.invMassDist.GetBinContent(
+                                restored.invMassDist.FindBin(2.)) == 0.5)
+            << "\n";
+  const auto parts = splitEventRanges(checkpoint.fRemaining, 4);
+  std::cout << "Split sizes:";
+  for (auto const& part : parts) {
+    std::cout << " " << countEvents(part);
+  }
+  std::cout << " (15 15 15 15)\n";
+  std::cout << "Shards of 10 events in 4:";
+  for (int i = 0; i < 4; i++) {
+    const EventRange range = shardEventRange(10, i, 4);
+    std::cout << " [" << range.fFirst << ", " << range.fLast << ")";
+  }
+  std::cout << " ([0, 2) [2, 5) [5, 7) [7, 10))\n";
+
+  PRINT_TEST_TITLE("Test event mixing");
+  const TypeId mId = Particle::FindParticle("M");
+  PairCategoryTable mixCategories(table.Size());
+  mixCategories.Add(jId, mId, 1u);
+  HistoAccumulator mixAccumulator(100, 0., 1000.);
+  EventMixer mixer(mixCategories, {&mixAccumulator});
+  EventPool pool(2, table.Size(), 1 << 20);
+  std::vector<std::vector<Particle>> mixEvents(3);
+  for (int i = 0; i < 12; i++) {
+    mixEvents[i % 3].push_back(
+        Particle(i % 2 ? jId : mId, i * 0.5, 1. - i, 0.2 * i));
+  }
+  long nMixed = 0;
+  TH1D mixHisto("mix", "", 100, 0., 1000.);
+  Rng mixRng(3, 0);
+  for (int e = 0; e < 3; e++) {
+    nMixed += mixer.Fill(mixEvents[e], pool, mixRng);
+    for (int other = 0; other < e; other++) {
+      for (auto const& a : mixEvents[e]) {
+        for (auto const& b : mixEvents[other]) {
+          if (a.GetParticleType() != b.GetParticleType()) {
+            mixHisto.Fill(a.InvMass(b));
+          }
+        }
+      }
+    }
+  }
+  std::cout << "Pool size: " << pool.Size() << " (2), mixed pairs: "
+            << nMixed << " (" << mixHisto.GetEntries() << ")\n";
+  TH1D mixFilled("mix-filled", "", 100, 0., 1000.);
+  mixAccumulator.FlushInto(mixFilled);
+  std::cout << "Same mean: "
+            << boolToString(std::abs(mixFilled.GetMean() -
+                                     mixHisto.GetMean()) < 1e-9)
+            << "\n";
+  EventPool smallPool(1, table.Size(), 2 * POOL_PARTICLE_BYTES);
+  smallPool.Push(particles, mixRng);
+  std::cout << "Capacity: " << smallPool.GetCapacity()
+            << " (2), truncated: " << smallPool.GetNTruncated() << " (1)\n";
+  // the last of four particles, like a decay daughter, is kept half the time
+  const std::vector<Particle> daughterLast{
+      Particle(mId, 1., 0., 0.), Particle(mId, 0., 1., 0.),
+      Particle(mId, 0., 0., 1.), Particle(jId, 1., 1., 0.)};
+  long nDaughterKept = 0;
+  const int nSubsamples = 100000;
+  for (int e = 0; e < nSubsamples; e++) {
+    Rng subsampleRng(3, e);
+    smallPool.Push(daughterLast, subsampleRng);
+    const int* buckets = smallPool.Buckets(0);
+    nDaughterKept += buckets[jId + 1] - buckets[jId];
+  }
+  std::cout << "Last particle kept: "
+            << static_cast<double>(nDaughterKept) / nSubsamples << " (0.5)\n";
+
+  PRINT_TEST_TITLE("Test alias table");
+  const std::vector<double> abundances{40, 40, 5, 5, 4.5, 4.5, 1, 0};
+  const AliasTable alias(abundances);
+  std::vector<int> counts(abundances.size(), 0);
+  Rng aliasRng(11, 0);
+  const int nDraws = 1000000;
+  for (int i = 0; i < nDraws; i++) {
+    counts[alias.Sample(aliasRng)]++;
+  }
+  double maxTableDiff = 0., maxSampleDiff = 0.;
+  for (int i = 0; i < alias.Size(); i++) {
+    const double expected = abundances[i] / 100.;
+    maxTableDiff =
+        std::max(maxTableDiff, std::abs(alias.Probability(i) - expected));
+    maxSampleDiff = std::max(
+        maxSampleDiff, std::abs(counts[i] / double(nDraws) - expected));
+  }
+  std::cout << "Table probabilities exact: "
+            << boolToString(maxTableDiff < 1e-12) << "\n";
+  std::cout << "Sampled within 0.002: " << boolToString(maxSampleDiff < 0.002)
+            << ", never sampled weight 0: " << boolToString(counts[7] == 0)
+            << "\n";
+
+  PRINT_TEST_TITLE("Test fast log and sincos");
+  const int nMath = 100000;
+  std::vector<double> mathX(nMath), mathLog(nMath), mathSin(nMath),
+      mathCos(nMath);
+  Rng mathRng(5, 0);
+  for (int i = 0; i < nMath; i++) {
+    // (0, 1] as in the simulation, then magnitudes up to 1e300
+    mathX[i] =
+        i % 2 ? 1. - mathRng.Rndm() : std::pow(10., 300. * mathRng.Rndm());
+  }
+  fastLogN(mathX.data(), nMath, mathLog.data());
+  double maxLogError = 0.;
+  for (int i = 0; i < nMath; i++) {
+    const double exact = std::log(mathX[i]);
+    if (exact != 0.) {
+      maxLogError =
+          std::max(maxLogError, std::abs((mathLog[i] - exact) / exact));
+    }
+  }
+  for (int i = 0; i < nMath; i++) {
+    mathX[i] = mathRng.Uniform(-1000., 1000.);
+  }
+  fastSinCosN(mathX.data(), nMath, mathSin.data(), mathCos.data());
+  double maxSinCosError = 0.;
+  for (int i = 0; i < nMath; i++) {
+    maxSinCosError = std::max({maxSinCosError,
+                               std::abs(mathSin[i] - std::sin(mathX[i])),
+                               std::abs(mathCos[i] - std::cos(mathX[i]))});
+  }
+  std::cout << "Log relative error below 4e-16: "
+            << boolToString(maxLogError < 4e-16) << "\n";
+  std::cout << "Sincos error below 4e-16: "
+            << boolToString(maxSinCosError < 4e-16) << "\n";
+  KinematicsBatch kinematics;
+  const TypeId kinematicsTypes[] = {resonance, light, heavy};
+  Rng kinematicsRng(5, 1);
+  kinematics.Add(kinematicsRng, kinematicsTypes, 3);
+  kinematics.Generate(Particle::GetParticleTable());
+  double maxKinematicsDiff = 0.;
+  for (int i = 0; i < kinematics.Size(); i++) {
+    const FourMomentum p = kinematics.GetFourMomentum(i);
+    const FourMomentum check = makeFourMomentum(p.fPx, p.fPy, p.fPz, p.fM2);
+    maxKinematicsDiff = std::max(
+        {maxKinematicsDiff, std::abs(p.fE - check.fE),
+         std::abs(std::hypot(p.fPx, p.fPy, p.fPz) - kinematics.Pulse()[i])});
+  }
+  std::cout << "Kinematics consistent: "
+            << boolToString(maxKinematicsDiff < 1e-12) << "\n";
+
+  PRINT_TEST_TITLE("Test many particle types");
+  const int nTypesBefore = Particle::GetParticleTable().Size();
+  for (int i = 0; i < 40; i++) {
+    Particle::AddParticleType(concat("species-", i), 1. + i, i % 3 - 1);
+  }
+  std::cout << "New types: "
+            << Particle::GetParticleTable().Size() - nTypesBefore << " (40)\n";
+  std::cout << "Found species-39: "
+            << boolToString(Particle::FindParticle("species-39") ==
+                            nTypesBefore + 39)
+            << "\n";
+
+  PRINT_TEST_TITLE("Test particle types histogram");
+  const TypeId extraType = Particle::AddParticleType("extra-species", 2.5, 1);
+  SimulationHistos typeHistos;
+  typeHistos.particleTypesHisto.Fill(extraType);
+  TH1D const& typesHisto = typeHistos.particleTypesHisto;
+  std::cout << "Bins: " << typesHisto.GetNbinsX() << " ("
+            << Particle::GetParticleTable().Size() << "), last bin "
+            << typesHisto.GetXaxis()->GetBinLabel(typesHisto.GetNbinsX())
+            << " (extra-species)\n";
+  std::cout << "Own bin: " << typesHisto.GetBinContent(extraType + 1)
+            << " (1), overflow: "
+            << typesHisto.GetBinContent(typesHisto.GetNbinsX() + 1) << " (0)\n";
+  std::cout << "Fractions: pione+ " << speciesFraction("pione+")
+            << " (0.4), k* " << speciesFraction("k*")
+            << " (0.01), extra-species " << speciesFraction("extra-species")
+            << " (0)\n";
+
+  PRINT_TEST_TITLE("Test cascade decays");
+  const TypeId lightType = Particle::AddParticleType("cascade-light", 0.1, 1);
+  const TypeId middleType =
+      Particle::AddParticleType("cascade-middle", 0.8, 0, 0.01);
+  const TypeId topType = Particle::AddParticleType("cascade-top", 3., 0, 0.02);
+  Particle::AddDecayChannel(middleType, lightType, lightType, 1.);
+  Particle::AddDecayChannel(topType, middleType, middleType, 3.);
+  Particle::AddDecayChannel(topType, lightType, lightType, 1.);
+  ParticleTable const& cascadeTable = Particle::GetParticleTable();
+  std::cout << "Unstable: " << boolToString(cascadeTable.IsUnstable(topType))
+            << " (true), " << boolToString(cascadeTable.IsUnstable(lightType))
+            << " (false)\n";
+  std::cout << "Channels: " << cascadeTable.ChooseChannel(topType, 0.7).fDau1
+            << " (" << middleType << "), "
+            << cascadeTable.ChooseChannel(topType, 0.8).fDau1 << " ("
+            << lightType << ")\n";
+  std::vector<Rng> cascadeRngs{Rng(5, 0), Rng(5, 1)};
+  DecayArena arena;
+  CascadeDecayer decayer;
+  std::vector<double> cascadeMasses;
+  for (int round = 0; round < 2; round++) {
+    arena.Clear();
+    cascadeMasses.clear();
+    arena.Add(Particle(topType, 1., 0., 0.), 1, -1);
+    arena.Add(Particle(middleType, 0., 1., 0.), 0, -1);
+    decayer.Decay(arena, cascadeRngs.data(), cascadeMasses);
+  }
+  arena.SortByEvent(2);
+  int nLight = 0, nChained = 0;
+  for (int node = 0; node < arena.Size(); node++) {
+    if (arena.Get(node).GetParticleType() == lightType) nLight++;
+    const int parent = arena.GetParent(node);
+    if (parent >= 0 && arena.GetParent(parent) >= 0) nChained++;
+  }
+  // with this seed top decays into two middle, which decay in turn
+  std::cout << "Decays: " << cascadeMasses.size()
+            << " (4), final particles: " << nLight
+            << " (6), granddaughters: " << nChained << " (4)\n";
+  std::cout << "Event 0 nodes: " << arena.EventEnd(0) - arena.EventBegin(0)
+            << " (3), first node of event 1: "
+            << arena.Node(arena.EventBegin(1)) << " (0)\n";
+
+  PRINT_TEST_TITLE("Test replay of cascade decays");
+  {
+    // the rows of every event are laid out like the simulation does
+    EventStoreWriter writer("test-cascade.evs", cascadeTable.Size(), 1,
+                            0);
+    EventBlock block;
+    block.Clear(0);
+    std::vector<int> rows(arena.Size());
+    for (int e = 0; e < 2; e++) {
+      block.BeginEvent();
+      for (int k = arena.EventBegin(e); k < arena.EventEnd(e); k++) {
+        const int node = arena.Node(k);
+        Particle const& particle = arena.Get(node);
+        const int parent = arena.GetParent(node);
+        rows[node] =
+            block.Add(particle, parent < 0 ? -1 : rows[parent],
+                      !cascadeTable.IsUnstable(particle.GetParticleType()));
+      }
+    }
+    writer.Write(block);
+  }
+  SimulationHistos replayHistos;
+  SimulationAccumulators replayAccumulators(replayHistos);
+  HistoAccumulator cascadeSiblings = replayAccumulators.invMassSibDecayDist;
+  cascadeSiblings.FillN(cascadeMasses.size(), cascadeMasses.data());
+  EventStoreReader cascadeReader("test-cascade.evs");
+  // the pairs read from the columns against the same particles as objects
+  const PairCategoryTable noCategories(cascadeTable.Size());
+  HistoAccumulator rowPairs(100, 0., 10.), particlePairs(100, 0., 10.);
+  PairFiller rowFiller(noCategories, rowPairs, {});
+  PairFiller particleFiller(noCategories, particlePairs, {});
+  for (int e = 0; e < 2; e++) {
+    const EventView cascadeEvent = cascadeReader.GetEvent(0, e);
+    replayEvent(cascadeEvent, 1, replayAccumulators);
+    rowFiller.Fill(cascadeEvent);
+    std::vector<Particle> finalParticles;
+    for (int k = arena.EventBegin(e); k < arena.EventEnd(e); k++) {
+      Particle const& particle = arena.Get(arena.Node(k));
+      if (!cascadeTable.IsUnstable(particle.GetParticleType())) {
+        finalParticles.push_back(particle);
+      }
+    }
+    particleFiller.Fill(finalParticles);
+  }
+  bool sameSiblings = true, samePairs = true;
+  for (int bin = 0; bin <= replayHistos.invMassSibDecayDist.GetNbinsX() + 1;
+       bin++) {
+    sameSiblings = sameSiblings && cascadeSiblings.GetBinContent(bin) ==
+                                       replayAccumulators.invMassSibDecayDist
+                                           .GetBinContent(bin);
+  }
+  for (int bin = 0; bin <= 101; bin++) {
+    samePairs = samePairs &&
+                rowPairs.GetBinContent(bin) == particlePairs.GetBinContent(bin);
+  }
+  std::cout << "Siblings: "
+            << replayAccumulators.invMassSibDecayDist.GetEntries() << " ("
+            << cascadeMasses.size() << "), pairs from the columns: "
+            << rowPairs.GetEntries() << " (" << particlePairs.GetEntries()
+            << ")\n";
+  std::cout << "Same sibling masses: " << boolToString(sameSiblings)
+            << " (true), same pairs: " << boolToString(samePairs)
+            << " (true)\n";
+  std::remove("test-cascade.evs");
+
+  PRINT_TEST_TITLE("Test pair config");
+  std::istringstream configText(
+      "# light against anything\n"
+      "light cascade-light * 10 0 5 pt>0.5 angle<1\n"
+      "\n"
+      "neutral 0 0 20 0 10\n");
+  const auto pairConfigs = parsePairConfig(configText, "test");
+  PairCategoryTable configTable(cascadeTable.Size());
+  compilePairCategories(pairConfigs, 1, configTable);
+  std::cout << "Categories: " << pairConfigs.size()
+            << " (2), masks: " << configTable.Get(topType, lightType) << " "
+            << configTable.Get(lightType, lightType) << " "
+            << configTable.Get(topType, middleType) << " (2 2 4)\n";
+  std::cout << "Cuts: " << configTable.GetCutsIndex(1) << " "
+            << configTable.GetCutsIndex(2) << " (0 -1), min pt "
+            << configTable.GetCuts()[0].fMinPt << " (0.5)\n";
+  // partners on all sides of a, more than a vector of them
+  PairCuts const& lightCuts = configTable.GetCuts()[0];
+  const FourMomentum cutA = makeFourMomentum(1., 0.5, 0.2, 0.01);
+  std::vector<double> cutPx, cutPy, cutPz, cutXs, expected;
+  for (int i = 0; i < 21; i++) {
+    cutPx.push_back(std::cos(i) * (0.1 + 0.1 * i));
+    cutPy.push_back(std::sin(i) * (0.1 + 0.1 * i));
+    cutPz.push_back(0.3 * (i % 5) - 0.6);
+    cutXs.push_back(i);
+    const double pt = std::hypot(cutPx[i], cutPy[i]);
+    const double angle = std::acos(
+        (cutA.fPx * cutPx[i] + cutA.fPy * cutPy[i] + cutA.fPz * cutPz[i]) /
+        std::hypot(cutA.fPx, cutA.fPy, cutA.fPz) /
+        std::hypot(cutPx[i], cutPy[i], cutPz[i]));
+    if (pt >= 0.5 && angle < 1.) expected.push_back(i);
+  }
+  std::vector<double> cutSelected(cutXs.size());
+  const int nCutSelected =
+      selectPairs(lightCuts, cutA, cutPx.data(), cutPy.data(), cutPz.data(),
+                  cutXs.data(), cutXs.size(), cutSelected.data());
+  cutSelected.resize(nCutSelected);
+  std::cout << "Selected: " << nCutSelected << " (" << expected.size()
+            << "), same pairs: " << boolToString(cutSelected == expected)
+            << "\n";
+  std::istringstream badConfig("bad cascade-light * 10 0 5 eta>2\n");
+  try {
+    parsePairConfig(badConfig, "bad");
+    std::cout << "Bad cut accepted\n";
+  } catch (std::runtime_error const& error) {
+    std::cout << error.what() << " (bad:1: invalid cut eta>2)\n";
+  }
+
+  PRINT_TEST_TITLE("Test histogram comparison");
+  const double histoA[] = {0., 10., 20., 10.};
+  const double histoB[] = {0., 20., 40., 20.};
+  const double histoC[] = {0., 40., 20., 0.};
+  int compareNdf;
+  std::cout << "Same shape: distance " << kolmogorovDistance(4, histoA, histoB)
+            << " (0), chi2 " << chi2Homogeneity(4, histoA, histoB, compareNdf)
+            << " (0), ndf " << compareNdf << " (2)\n";
+  std::cout << "Other shape: distance "
+            << kolmogorovDistance(4, histoA, histoC) << " (0.416667)\n";
+  // 16 batches of 4 bins, then the same with the last bin of b shifted
+  const int compareBatchCount = 16;
+  std::vector<double> batchesA, batchesB, batchesShifted;
+  Rng compareRng(7, 0);
+  for (int k = 0; k < compareBatchCount; k++) {
+    for (int i = 0; i < 4; i++) {
+      batchesA.push_back(compareRng.Uniform(100., 110.));
+      batchesB.push_back(compareRng.Uniform(100., 110.));
+      batchesShifted.push_back(batchesB.back() + (i == 3 ? 30. : 0.));
+    }
+  }
+  const BatchComparison sameRuns = compareBatches(
+      compareBatchCount, 4, batchesA.data(), batchesB.data(), 999, 1);
+  const BatchComparison shiftedRuns = compareBatches(
+      compareBatchCount, 4, batchesA.data(), batchesShifted.data(), 999, 1);
+  std::cout << "Same runs: KS p " << sameRuns.fKolmogorovP << ", chi2 p "
+            << sameRuns.fChi2P << " (not small)\n";
+  std::cout << "Shifted runs: KS p " << shiftedRuns.fKolmogorovP
+            << ", chi2 p " << shiftedRuns.fChi2P << " (0.001 0.001)\n";
+
+  PRINT_TEST_TITLE("Test histogram store");
+  {
+    TFile storeFile("test-histos.root", "RECREATE");
+    saved.Write();
+    storeFile.Close();
+  }
+  {
+    TFile storeFile("test-histos.root");
+    HistoStore store(storeFile);
+    const bool loadedNone = store.NLoaded() == 0;
+    TH1D* zenith = store.Get("zenith");
+    std::cout << "Histograms: " << store.Names().size() << " ("
+              << saved.All().size() << "), lazy: " << boolToString(loadedNone)
+              << ", loaded: " << store.NLoaded() << " (1), zenith entries "
+              << zenith->GetEntries() << " (1)\n";
+    std::cout << "Missing found: "
+              << boolToString(store.Find("missing") != nullptr) << " (false)\n";
+    try {
+      store.Get("missing");
+      std::cout << "Missing histogram returned\n";
+    } catch (std::runtime_error const& error) {
+      std::cout << error.what() << " (test-histos.root has no missing "
+                << "histogram)\n";
+    }
+  }
+  std::remove("test-histos.root");
+
+  PRINT_TEST_TITLE("Test shard information");
+  const uint64_t shardSeed = 0x123456789ABCDEFull;
+  {
+    TFile shardFile("test-shard.root", "RECREATE");
+    writeShardInfo({shardSeed, 1000, 2, 3});
+    shardFile.Close();
+  }
+  {
+    TFile shardFile("test-shard.root");
+    const ShardInfo info = readShardInfo(shardFile);
+    std::cout << "Same seed: " << boolToString(info.fSeed == shardSeed)
+              << ", events " << info.fNEvents << " (1000), shard "
+              << info.fShard << "/" << info.fNShards << " (2/3)\n";
+  }
+  std::remove("test-shard.root");
+  const std::vector<std::string> shardPaths{"a", "b", "c"};
+  auto shardError = [&](std::vector<ShardInfo> const& infos) {
+    try {
+      checkShards(infos, shardPaths);
+      return std::string("accepted");
+    } catch (std::runtime_error const& error) {
+      return std::string(error.what());
+    }
+  };
+  std::cout << shardError({{9, 10, 1, 3}, {9, 10, 2, 3}, {9, 10, 0, 3}})
+            << " (accepted)\n";
+  std::cout << shardError({{9, 10, 0, 3}, {9, 10, 1, 3}})
+            << " (Shard 2 of 3 is missing)\n";
+  std::cout << shardError({{9, 10, 0, 3}, {9, 10, 1, 3}, {9, 10, 1, 3}})
+            << " (c and b are both shard 1)\n";
+  std::cout << shardError({{9, 10, 0, 2}, {8, 10, 1, 2}})
+            << " (b is a shard of another run than a)\n";
+
+  PRINT_TEST_TITLE("Test pair sampling");
+  std::vector<Particle> sampledEvent;
+  for (int i = 0; i < 40; i++) {
+    sampledEvent.push_back(
+        Particle(i % 4 ? jId : mId, 0.1 * i, 0.3 - 0.05 * i, 0.02 * i));
+  }
+  HistoAccumulator fullAll(100, 0., 10.), fullJM(100, 0., 10.);
+  HistoAccumulator sampledAll(100, 0., 10.), sampledJM(100, 0., 10.);
+  PairFiller fullPairs(mixCategories, fullAll, {&fullJM});
+  PairFiller sampledPairs(mixCategories, sampledAll, {&sampledJM},
+                          {PairPrecision::DOUBLE, 0.25});
+  Rng sampleRng(9, 0);
+  const long nFull = fullPairs.Fill(sampledEvent);
+  const long nSampled = sampledPairs.Fill(sampledEvent, &sampleRng);
+  TH1D fullAllHisto("full-all", "", 100, 0., 10.);
+  TH1D fullJMHisto("full-jm", "", 100, 0., 10.);
+  TH1D sampledAllHisto("sampled-all", "", 100, 0., 10.);
+  TH1D sampledJMHisto("sampled-jm", "", 100, 0., 10.);
+  fullAll.FlushInto(fullAllHisto);
+  fullJM.FlushInto(fullJMHisto);
+  sampledAll.FlushInto(sampledAllHisto);
+  sampledJM.FlushInto(sampledJMHisto);
+  std::cout << "Pairs filled: " << nFull << " (780), sampled " << nSampled
+            << " (at least 195)\n";
+  // the weights of every stratum add up to its pairs
+  std::cout << "Sum of weights: " << sampledAllHisto.Integral(0, 101) << " ("
+            << fullAllHisto.Integral(0, 101) << "), j-m pairs "
+            << sampledJMHisto.Integral(0, 101) << " ("
+            << fullJMHisto.Integral(0, 101) << ")\n";
+  try {
+    sampledPairs.Fill(sampledEvent);
+    std::cout << "Sampled without a generator\n";
+  } catch (std::invalid_argument const& error) {
+    std::cout << error.what() << " (sampling pairs needs a random "
+              << "generator)\n";
+  }
+
+  PRINT_TEST_TITLE("Test tiled pair loop");
+  std::vector<Particle> largeEvent;
+  Rng largeRng(13, 0);
+  for (int i = 0; i < 3 * PAIR_TILE_PARTICLES / 2; i++) {
+    largeEvent.push_back(Particle(largeRng.Rndm() < 0.3 ? mId : jId,
+                                  largeRng.Uniform(-1., 1.),
+                                  largeRng.Uniform(-1., 1.),
+                                  largeRng.Uniform(-1., 1.)));
+  }
+  long nJM = 0;
+  for (size_t i = 0; i < largeEvent.size(); i++) {
+    for (size_t j = i + 1; j < largeEvent.size(); j++) {
+      nJM += largeEvent[i].GetParticleType() != largeEvent[j].GetParticleType();
+    }
+  }
+  HistoAccumulator tiledAll(100, 0., 10.), tiledJM(100, 0., 10.);
+  HistoAccumulator threadedAll(100, 0., 10.), threadedJM(100, 0., 10.);
+  PairFiller tiledPairs(mixCategories, tiledAll, {&tiledJM});
+  PairFiller threadedPairs(mixCategories, threadedAll, {&threadedJM},
+                           {PairPrecision::DOUBLE, 1., 3});
+  const long nLarge = tiledPairs.Fill(largeEvent);
+  threadedPairs.Fill(largeEvent);
+  bool sameTiles = true;
+  for (int bin = 0; bin <= 101; bin++) {
+    sameTiles = sameTiles &&
+               tiledAll.GetBinContent(bin) == threadedAll.GetBinContent(bin) &&
+               tiledJM.GetBinContent(bin) == threadedJM.GetBinContent(bin);
+  }
+  std::cout << "Pairs: " << nLarge << " (" << 767 * 768 / 2 << "), entries "
+            << tiledAll.GetEntries() << " " << threadedAll.GetEntries()
+            << ", j-m " << tiledJM.GetEntries() << " "
+            << threadedJM.GetEntries() << " (" << nJM << ")\n";
+  std::cout << "Same bins with 3 threads: " << boolToString(sameTiles)
+            << " (true)\n";
+}
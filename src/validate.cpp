@@ -0,0 +1,384 @@
+#include <TH1D.h>
+#include <TROOT.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "constants.hpp"
+#include "event_simulation.hpp"
+#include "histo_comparison.hpp"
+#include "instrumentation.hpp"
+#include "least_squares.hpp"
+#include "parallel_for.hpp"
+#include "particle.hpp"
+#include "particle_catalogue.hpp"
+#include "reference_simulation.hpp"
+#include "simulation_histos.hpp"
+#include "table.hpp"
+#include "util.hpp"
+
+// every run is split in batches of events, which are independent even if
+// the pairs of an event are not: the p-values of the histogram tests come
+// from permutations of the batches between the two runs
+const int N_BATCHES = 32;
+const int MIN_PERMUTATIONS = 999;
+// entries may differ from the rough expectations of analysis.cpp by this
+// fraction
+const double ENTRIES_TOLERANCE = 0.05;
+// K* parameters of the two paths may differ by this many standard errors
+const double K_STAR_SIGMAS = 5.;
+const double K_STAR_MASS = 0.89166;
+const double K_STAR_WIDTH = 0.05;
+// the fit only sees the masses around the K*, away from the noise of the
+// rest of the spectrum
+const double K_STAR_WINDOW = 0.3;
+
+struct ValidateOptions {
+  int nEvents = 10000;
+  uint64_t seed = 1;
+  int nThreads = 1;
+  double alpha = 0.01;
+  PairPrecision pairPrecision = PairPrecision::DOUBLE;
+};
+
+// histograms of every batch of events of a run
+using Batches = std::vector<std::unique_ptr<SimulationHistos>>;
+
+struct KStarFit {
+  double fMass, fMassError;
+  double fWidth, fWidthError;
+};
+
+bool parseArgs(int argc, char** argv, ValidateOptions& options);
+Batches makeBatches(int nBatches);
+double runReference(ValidateOptions const& options, ParticleIds const& ids,
+                    Batches& batches);
+double runCandidate(ValidateOptions const& options, ParticleIds const& ids,
+                    PairCategoryTable const& categories, Batches& batches);
+void addBatches(Batches const& batches, SimulationHistos& histos);
+bool compareHistos(Batches const& reference, Batches const& candidate,
+                   ValidateOptions const& options);
+bool checkEntries(SimulationHistos const& reference,
+                  SimulationHistos const& candidate, int nEvents);
+bool checkKStar(SimulationHistos const& reference,
+                SimulationHistos const& candidate);
+KStarFit fitKStar(SimulationHistos const& histos);
+void appendBinContents(TH1D const& histo, std::vector<double>& contents);
+
+// Runs the reference path and the optimized engine on the same number of
+// events and checks that they fill the same distributions. The two runs use
+// different seeds, so that they are independent samples and the p-values
+// of the tests hold. Exits with an error if any check fails.
+int main(int argc, char** argv) {
+  ValidateOptions options;
+  if (!parseArgs(argc, argv, options)) {
+    std::cout << "Usage: validate [--n-events N] [--seed S] [--threads N] "
+                 "[--alpha A]\n"
+                 "                [--pair-precision P]\n";
+    std::cout << "  --n-events N  events of each run (default 10000)\n";
+    std::cout << "  --seed S      seed of the candidate run, the reference "
+                 "uses S + 1 (default 1)\n";
+    std::cout << "  --threads N   threads of the candidate run, 0 to use all "
+                 "cores (default 1)\n";
+    std::cout << "  --alpha A     probability of a false alarm over all the "
+                 "histogram tests (default 0.01)\n";
+    std::cout << "  --pair-precision P  pair arithmetic of the candidate, "
+                 "double or float (default\n"
+                 "                      double)\n";
+    return EXIT_FAILURE;
+  }
+  if (options.nThreads == 0) {
+    options.nThreads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  section("Initializing");
+  ROOT::EnableThreadSafety();
+  TH1::AddDirectory(kFALSE);
+  const ParticleIds ids = addParticleTypes();
+  Particle::FreezeParticleTypes();
+  const PairCategoryTable categories = buildPairCategories(ids);
+  std::cout << "Validating on " << options.nEvents << " events, pairs of the "
+            << "candidate in " << pairPrecisionName(options.pairPrecision)
+            << " precision\n";
+
+  const int nBatches = std::min(N_BATCHES, options.nEvents);
+
+  section("Reference");
+  Batches referenceBatches = makeBatches(nBatches);
+  const double referenceSeconds = runReference(options, ids, referenceBatches);
+  std::cout << "Simulated in " << referenceSeconds << "s on 1 thread\n";
+
+  section("Candidate");
+  Batches candidateBatches = makeBatches(nBatches);
+  const double candidateSeconds =
+      runCandidate(options, ids, categories, candidateBatches);
+  std::cout << "Simulated in " << candidateSeconds << "s on "
+            << options.nThreads << " thread(s)\n";
+
+  SimulationHistos reference, candidate;
+  addBatches(referenceBatches, reference);
+  addBatches(candidateBatches, candidate);
+  bool passed = compareHistos(referenceBatches, candidateBatches, options);
+  passed &= checkEntries(reference, candidate, options.nEvents);
+  passed &= checkKStar(reference, candidate);
+
+  section("Speed");
+  Table<const char*, double, double>()
+      .headers({"PATH", "SECONDS", "EVENTS/S"})
+      .row("reference", referenceSeconds, options.nEvents / referenceSeconds)
+      .row("candidate", candidateSeconds, options.nEvents / candidateSeconds)
+      .spacing(7)
+      .print();
+  std::cout << "Speedup: " << referenceSeconds / candidateSeconds << "x\n";
+
+  section("Result");
+  if (!passed) {
+    std::cout << "The candidate disagrees with the reference\n";
+    return EXIT_FAILURE;
+  }
+  std::cout << "The candidate agrees with the reference\n";
+}
+
+bool parseArgs(int argc, char** argv, ValidateOptions& options) {
+  try {
+    for (int i = 1; i < argc; i++) {
+      if (std::strcmp(argv[i], "--n-events") == 0 && i + 1 < argc) {
+        options.nEvents = std::stoi(argv[++i]);
+        if (options.nEvents <= 0) return false;
+      } else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+        options.seed = std::stoull(argv[++i]);
+      } else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+        options.nThreads = std::stoi(argv[++i]);
+        if (options.nThreads < 0) return false;
+      } else if (std::strcmp(argv[i], "--alpha") == 0 && i + 1 < argc) {
+        options.alpha = std::stod(argv[++i]);
+        if (!(options.alpha > 0. && options.alpha < 1.)) return false;
+      } else if (std::strcmp(argv[i], "--pair-precision") == 0 &&
+                 i + 1 < argc) {
+        if (!parsePairPrecision(argv[++i], options.pairPrecision)) {
+          return false;
+        }
+      } else {
+        return false;
+      }
+    }
+  } catch (std::exception const&) {
+    return false;
+  }
+  return true;
+}
+
+Batches makeBatches(int nBatches) {
+  Batches batches;
+  for (int k = 0; k < nBatches; k++) {
+    batches.push_back(std::make_unique<SimulationHistos>());
+  }
+  return batches;
+}
+
+// simulates the batches one after the other with the reference path and
+// returns the seconds taken
+double runReference(ValidateOptions const& options, ParticleIds const& ids,
+                    Batches& batches) {
+  const int nBatches = batches.size();
+  const auto start = std::chrono::steady_clock::now();
+  for (int k = 0; k < nBatches; k++) {
+    const EventRange range = shardEventRange(options.nEvents, k, nBatches);
+    simulateEventsReference(range.fFirst, range.fLast, options.seed + 1, ids,
+                            *batches[k]);
+  }
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+// simulates the batches with the engine, shared between the threads, and
+// returns the seconds taken
+double runCandidate(ValidateOptions const& options, ParticleIds const& ids,
+                    PairCategoryTable const& categories, Batches& batches) {
+  const int nBatches = batches.size();
+  std::vector<StageTimers> timers(nBatches);
+  std::atomic<int> completed{0};
+  const auto start = std::chrono::steady_clock::now();
+  parallelFor(nBatches, options.nThreads, [&](int k) {
+    const EventRange range = shardEventRange(options.nEvents, k, nBatches);
+    simulateEvents(range.fFirst, range.fLast, options.seed, ids, N_PARTICLES,
+                   categories, PairLoopOptions{options.pairPrecision},
+                   *batches[k], timers[k], nullptr, nullptr, completed);
+  });
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       start)
+      .count();
+}
+
+void addBatches(Batches const& batches, SimulationHistos& histos) {
+  for (auto const& batch : batches) {
+    histos.Add(*batch);
+  }
+}
+
+bool compareHistos(Batches const& reference, Batches const& candidate,
+                   ValidateOptions const& options) {
+  section("Histogram tests");
+  const int nBatches = reference.size();
+  const int nHistos = reference[0]->All().size();
+  // histograms left empty by both runs, like the mixed ones, are not tested
+  std::vector<int> tested;
+  for (int h = 0; h < nHistos; h++) {
+    double entries = 0.;
+    for (int k = 0; k < nBatches; k++) {
+      entries += reference[k]->All()[h]->GetEntries() +
+                 candidate[k]->All()[h]->GetEntries();
+    }
+    if (entries > 0.) tested.push_back(h);
+  }
+  // two tests per histogram share alpha, and there are enough permutations
+  // to resolve p-values below the threshold of every test
+  const double testAlpha = options.alpha / (2 * tested.size());
+  const int nPermutations =
+      std::max(MIN_PERMUTATIONS, static_cast<int>(std::ceil(2. / testAlpha)));
+  std::cout << "Every test fails below p = " << testAlpha << ", "
+            << nPermutations << " permutations of " << 2 * nBatches
+            << " batches\n";
+  std::vector<BatchComparison> results(tested.size());
+  parallelFor(tested.size(), options.nThreads, [&](int t) {
+    std::vector<double> a, b;
+    for (int k = 0; k < nBatches; k++) {
+      appendBinContents(*reference[k]->All()[tested[t]], a);
+      appendBinContents(*candidate[k]->All()[tested[t]], b);
+    }
+    results[t] = compareBatches(nBatches, a.size() / nBatches, a.data(),
+                                b.data(), nPermutations, options.seed);
+  });
+
+  bool passed = true;
+  Table<std::string, double, double, double, double, const char*> table{};
+  table.headers(
+      {"HISTOGRAM", "KS DISTANCE", "KS P", "CHI2/NDF", "CHI2 P", "RESULT"});
+  for (size_t t = 0; t < tested.size(); t++) {
+    BatchComparison const& result = results[t];
+    const bool same =
+        result.fKolmogorovP >= testAlpha && result.fChi2P >= testAlpha;
+    passed &= same;
+    table.row(reference[0]->All()[tested[t]]->GetName(), result.fDistance,
+              result.fKolmogorovP,
+              result.fNdf > 0 ? result.fChi2 / result.fNdf : 0.,
+              result.fChi2P, same ? "ok" : "FAILED");
+  }
+  table.spacing(7).print();
+  return passed;
+}
+
+// Checks the entries of the candidate against the expectations tabulated by
+// analysis.cpp, scaled to the events of the run
+bool checkEntries(SimulationHistos const& reference,
+                  SimulationHistos const& candidate, int nEvents) {
+  section("Histograms entries");
+  const double particles = static_cast<double>(nEvents) * N_PARTICLES;
+  const double pairs =
+      static_cast<double>(nEvents) * N_PARTICLES * (N_PARTICLES + 1) / 2;
+  const double pkPairs =
+      (N_PARTICLES * N_PARTICLES / 2) * (0.8 + 0.01) * (0.1 + 0.01) * nEvents;
+  auto const& r = reference;
+  auto const& c = candidate;
+  struct EntriesCheck {
+    const char* fName;
+    double fExpected;
+    TH1D const& fReference;
+    TH1D const& fCandidate;
+  };
+  const EntriesCheck checks[] = {
+      {"particle-types", particles, r.particleTypesHisto,
+       c.particleTypesHisto},
+      {"zenith", particles, r.zenithDist, c.zenithDist},
+      {"azimuth", particles, r.azimuthDist, c.azimuthDist},
+      {"pulse", particles, r.pulseDist, c.pulseDist},
+      {"traverse-pulse", particles, r.traversePulseDist, c.traversePulseDist},
+      {"particle-energy", particles, r.particleEnergyDist,
+       c.particleEnergyDist},
+      {"inv-mass", pairs, r.invMassDist, c.invMassDist},
+      {"inv-mass-discordant", pairs / 2, r.invMassDiffChargeDist,
+       c.invMassDiffChargeDist},
+      {"inv-mass-concordant", pairs / 2, r.invMassSameChargeDist,
+       c.invMassSameChargeDist},
+      {"inv-mass-discordant-pk", pkPairs, r.invMassPioneKaoneDiscordantDist,
+       c.invMassPioneKaoneDiscordantDist},
+      {"inv-mass-concordant-pk", pkPairs, r.invMassPioneKaoneConcordantDist,
+       c.invMassPioneKaoneConcordantDist},
+      {"inv-mass-siblings", particles * 0.01, r.invMassSibDecayDist,
+       c.invMassSibDecayDist}};
+  bool passed = true;
+  Table<const char*, double, double, double, const char*> table{};
+  table.headers({"HISTOGRAM", "EXPECTED", "REFERENCE", "CANDIDATE", "RESULT"});
+  for (auto const& check : checks) {
+    const double entries = check.fCandidate.GetEntries();
+    const bool close = std::abs(entries - check.fExpected) <=
+                       ENTRIES_TOLERANCE * check.fExpected;
+    passed &= close;
+    table.row(check.fName, check.fExpected, check.fReference.GetEntries(),
+              entries, close ? "ok" : "FAILED");
+  }
+  table.spacing(7).print();
+  return passed;
+}
+
+// Checks that both paths find the same K* in the difference of discordant
+// and concordant pion-kaon pairs, like analysis.cpp
+bool checkKStar(SimulationHistos const& reference,
+                SimulationHistos const& candidate) {
+  section("K*");
+  const KStarFit r = fitKStar(reference);
+  const KStarFit c = fitKStar(candidate);
+  const bool sameMass = std::abs(r.fMass - c.fMass) <=
+                        K_STAR_SIGMAS * std::hypot(r.fMassError, c.fMassError);
+  const bool sameWidth =
+      std::abs(r.fWidth - c.fWidth) <=
+      K_STAR_SIGMAS * std::hypot(r.fWidthError, c.fWidthError);
+  Table<const char*, double, double, double, double, double, const char*>()
+      .headers({"", "EXPECTED", "REFERENCE", "ERROR", "CANDIDATE", "ERROR",
+                "RESULT"})
+      .row("Mass", K_STAR_MASS, r.fMass, r.fMassError, c.fMass, c.fMassError,
+           sameMass ? "ok" : "FAILED")
+      .row("Width", K_STAR_WIDTH, r.fWidth, r.fWidthError, c.fWidth,
+           c.fWidthError, sameWidth ? "ok" : "FAILED")
+      .spacing(7)
+      .print();
+  return sameMass && sameWidth;
+}
+
+KStarFit fitKStar(SimulationHistos const& histos) {
+  const int MEAN = 1, SIGMA = 2;
+  TH1D const& disc = histos.invMassPioneKaoneDiscordantDist;
+  TH1D const& conc = histos.invMassPioneKaoneConcordantDist;
+  std::vector<double> x, y, e;
+  for (int bin = 1; bin <= disc.GetNbinsX(); bin++) {
+    if (std::abs(disc.GetBinCenter(bin) - K_STAR_MASS) > K_STAR_WINDOW) {
+      continue;
+    }
+    x.push_back(disc.GetBinCenter(bin));
+    y.push_back(disc.GetBinContent(bin) - conc.GetBinContent(bin));
+    e.push_back(std::hypot(disc.GetBinError(bin), conc.GetBinError(bin)));
+  }
+  const FitResult fit =
+      fitLeastSquares(FitModel::GAUS, x.size(), x.data(), y.data(), e.data());
+  return {fit.fParameters[MEAN], fit.fErrors[MEAN], fit.fParameters[SIGMA],
+          fit.fErrors[SIGMA]};
+}
+
+// appends the bin contents, underflow and overflow included
+void appendBinContents(TH1D const& histo, std::vector<double>& contents) {
+  for (int bin = 0; bin <= histo.GetNbinsX() + 1; bin++) {
+    contents.push_back(histo.GetBinContent(bin));
+  }
+}